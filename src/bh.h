@@ -85,6 +85,29 @@ GNU General Public License for more details.
 #if defined(__APPLE__)
 	typedef void (* PFNGLLOCKARRAYSEXTPROC) (GLint first, GLsizei count);
 	typedef void (* PFNGLUNLOCKARRAYSEXTPROC) (void);
+	typedef void (* PFNGLGENBUFFERSPROC) (GLsizei n, GLuint *buffers);
+	typedef void (* PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint *buffers);
+	typedef void (* PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
+	typedef void (* PFNGLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+	typedef void (* PFNGLBUFFERSUBDATAPROC) (GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+	typedef GLuint (* PFNGLCREATESHADERPROC) (GLenum type);
+	typedef void (* PFNGLDELETESHADERPROC) (GLuint shader);
+	typedef void (* PFNGLSHADERSOURCEPROC) (GLuint shader, GLsizei count, const GLchar *const*string, const GLint *length);
+	typedef void (* PFNGLCOMPILESHADERPROC) (GLuint shader);
+	typedef void (* PFNGLGETSHADERIVPROC) (GLuint shader, GLenum pname, GLint *params);
+	typedef void (* PFNGLGETSHADERINFOLOGPROC) (GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
+	typedef GLuint (* PFNGLCREATEPROGRAMPROC) (void);
+	typedef void (* PFNGLDELETEPROGRAMPROC) (GLuint program);
+	typedef void (* PFNGLATTACHSHADERPROC) (GLuint program, GLuint shader);
+	typedef void (* PFNGLLINKPROGRAMPROC) (GLuint program);
+	typedef void (* PFNGLGETPROGRAMIVPROC) (GLuint program, GLenum pname, GLint *params);
+	typedef void (* PFNGLGETPROGRAMINFOLOGPROC) (GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
+	typedef void (* PFNGLUSEPROGRAMPROC) (GLuint program);
+	typedef GLint (* PFNGLGETUNIFORMLOCATIONPROC) (GLuint program, const GLchar *name);
+	typedef void (* PFNGLUNIFORM1IPROC) (GLint location, GLint v0);
+	typedef void (* PFNGLUNIFORM1FPROC) (GLint location, GLfloat v0);
+	typedef void (* PFNGLUNIFORM2FPROC) (GLint location, GLfloat v0, GLfloat v1);
+	typedef void (* PFNGLACTIVETEXTUREPROC) (GLenum texture);
 #endif
 #	define SEP "/"
 #endif
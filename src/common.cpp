@@ -22,9 +22,14 @@ GNU General Public License for more details.
 #include "common.h"
 #include "spx.h"
 #include <sys/stat.h>
+#if defined (OS_WIN32_MINGW) || defined (OS_WIN32_MSC)
+#include <direct.h>
+#endif
 #include <iostream>
 #include <cerrno>
 #include <ctime>
+#include <mutex>
+#include <algorithm>
 
 // --------------------------------------------------------------------
 //				color utils
@@ -127,8 +132,10 @@ void PrintQuaternion(const TQuaternion& q) {
 // --------------------------------------------------------------------
 
 static CSPList msg_list;
+static std::mutex msg_mutex;	// messages come from the loader and simulation threads as well
 
 void SaveMessages() {
+	std::lock_guard<std::mutex> lock(msg_mutex);
 	msg_list.Save(param.config_dir, "messages");
 }
 
@@ -140,22 +147,26 @@ void Message(const char *msg, const char *desc) {
 
 	std::string aa = msg;
 	std::string bb = desc;
+	std::lock_guard<std::mutex> lock(msg_mutex);
 	std::cout << aa << "  " << bb << '\n';
 	msg_list.Add(aa + bb);
 }
 
 void Message(const char *msg) {
+	std::lock_guard<std::mutex> lock(msg_mutex);
 	std::cout << msg << '\n';
 	if (*msg != 0)
 		msg_list.Add(msg);
 }
 
 void Message(const std::string& a, const std::string& b) {
+	std::lock_guard<std::mutex> lock(msg_mutex);
 	std::cout << a << ' ' << b << std::endl;
 	msg_list.Add(a + b);
 }
 
 void Message(const std::string& msg) {
+	std::lock_guard<std::mutex> lock(msg_mutex);
 	std::cout << msg << std::endl;
 	msg_list.Add(msg);
 }
@@ -181,6 +192,13 @@ bool FileExists(const std::string& dir, const std::string& filename) {
 	return FileExists(MakePathStr(dir, filename));
 }
 
+std::time_t FileModTime(const std::string& filename) {
+	struct stat stat_info;
+	if (stat(filename.c_str(), &stat_info) != 0)
+		return 0;
+	return stat_info.st_mtime;
+}
+
 #ifndef OS_WIN32_MSC
 bool DirExists(const char *dirname) {
 #ifdef ANDROID
@@ -202,6 +220,55 @@ bool DirExists(const char *dirname) {
 }
 #endif
 
+bool MakeDir(const std::string& dirname) {
+	if (DirExists(dirname.c_str()))
+		return true;
+#if defined (OS_WIN32_MINGW) || defined (OS_WIN32_MSC)
+	return _mkdir(dirname.c_str()) == 0;
+#else
+	return mkdir(dirname.c_str(), 0775) == 0;
+#endif
+}
+
+// Adds the names of the files in dir ending with ext to files, sorted
+#ifndef OS_WIN32_MSC
+bool ListFiles(const std::string& dir, const std::string& ext, std::vector<std::string>& files) {
+	DIR *xdir = opendir(dir.c_str());
+	if (xdir == 0) {
+		Message("couldn't open directory", dir);
+		return false;
+	}
+	std::size_t first = files.size();
+	while (struct dirent* entry = readdir(xdir)) {
+		std::string name = entry->d_name;
+		if (name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0)
+			files.push_back(name);
+	}
+	closedir(xdir);
+	std::sort(files.begin() + first, files.end());
+	return true;
+}
+#else
+bool ListFiles(const std::string& dir, const std::string& ext, std::vector<std::string>& files) {
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((dir + "\\*" + ext).c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE) {
+		if (GetLastError() == ERROR_FILE_NOT_FOUND)
+			return true;	// no matching files
+		Message("couldn't open directory", dir);
+		return false;
+	}
+	std::size_t first = files.size();
+	do {
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+			files.push_back(data.cFileName);
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+	std::sort(files.begin() + first, files.end());
+	return true;
+}
+#endif
+
 // --------------------------------------------------------------------
 //				date and time
 // --------------------------------------------------------------------
@@ -20,6 +20,8 @@ GNU General Public License for more details.
 
 #include "bh.h"
 #include "matrices.h"
+#include <ctime>
+#include <vector>
 
 
 #define clamp(minimum, x, maximum) (std::max(std::min(x, maximum), minimum))
@@ -99,6 +101,9 @@ void	PrintQuaternion(const TQuaternion& q);
 bool	FileExists(const std::string& filename);
 bool	FileExists(const std::string& dir, const std::string& filename);
 bool	DirExists(const char *dirname);
+bool	MakeDir(const std::string& dirname);	// true if it exists afterwards
+std::time_t	FileModTime(const std::string& filename);  // 0 if not existing
+bool	ListFiles(const std::string& dir, const std::string& ext, std::vector<std::string>& files);
 
 // --------------------------------------------------------------------
 //				message utils
@@ -19,6 +19,7 @@ GNU General Public License for more details.
 #include <etr_config.h>
 #endif
 
+#include <sys/stat.h>
 #include "bh.h"
 #include "course.h"
 #include "textures.h"
@@ -33,9 +34,13 @@ GNU General Public License for more details.
 #include "physics.h"
 #include "winsys.h"
 #include "translation.h"
+#include "course_render.h"
+#include "thread_pool.h"
 #include <cmath>
 #include <algorithm>
 #include <iterator>
+#include <fstream>
+#include <cstring>
 
 
 void TCourse::SetDescription(const std::string& description) {
@@ -62,13 +67,18 @@ void TCourse::SetTranslatedData(const std::string& line2) {
 CCourse Course;
 
 
-CCourse::CCourse()
+CCourse::CCourse(bool headless)
 	: curr_course(nullptr)
 	, nx(0), ny(0)
 	, base_height_value(0)
+	, tree_size(3)
+	, tree_var(3)
 	, mirrored(false)
-	, currentCourseList(nullptr)
-	, vnc_array(nullptr) {
+	, headless(headless)
+	, vn_buffer(0)
+	, vn_buffer_valid(false)
+	, prepare_step(0)
+	, currentCourseList(nullptr) {
 }
 
 CCourse::~CCourse() {
@@ -103,139 +113,198 @@ std::size_t CCourse::GetCourseIdx(const TCourse* course) const {
 	return idx;
 }
 
-void CCourse::CalcNormals() {
-	for (unsigned int y = 0; y < ny; y++) {
-		for (unsigned int x = 0; x < nx; x++) {
-			TVector3d nml(0.0, 0.0, 0.0);
-			TVector3d p0 = NMLPOINT(x,y);
-
-			if ((x + y) % 2 == 0) {
-				if (x > 0 && y > 0) {
-					TVector3d p1 = NMLPOINT(x,  y-1);
-					TVector3d p2 = NMLPOINT(x-1,y-1);
-					TVector3d v1 = p1 - p0;
-					TVector3d v2 = p2 - p0;
-					TVector3d n = CrossProduct(v2, v1);
+// --------------------------------------------------------------------
+//					course fields
+// --------------------------------------------------------------------
 
-					n.Norm();
-					nml += n;
+void CourseFields::resize(std::size_t n) {
+	elevation.resize(n);
+	normals.resize(3 * n);
+	terrain.resize(n);
+}
 
-					p1 = NMLPOINT(x-1, y-1);
-					p2 = NMLPOINT(x-1, y);
-					v1 = p1 - p0;
-					v2 = p2 - p0;
-					n = CrossProduct(v2, v1);
+void CourseFields::clear() {
+	// release the memory, a course can take several megabytes
+	std::vector<float>().swap(elevation);
+	std::vector<float>().swap(normals);
+	std::vector<uint8_t>().swap(terrain);
+}
 
-					n.Norm();
-					nml += n;
-				}
-				if (x > 0 && y < ny-1) {
-					TVector3d p1 = NMLPOINT(x-1,y);
-					TVector3d p2 = NMLPOINT(x-1,y+1);
-					TVector3d v1 = p1 - p0;
-					TVector3d v2 = p2 - p0;
-					TVector3d n = CrossProduct(v2, v1);
+std::size_t CourseFields::Bytes() const {
+	return elevation.size() * sizeof(float) + normals.size() * sizeof(float)
+	       + terrain.size() * sizeof(uint8_t);
+}
 
-					n.Norm();
-					nml += n;
+static double SignNotZero(double x) {
+	return x < 0.0 ? -1.0 : 1.0;
+}
 
-					p1 = NMLPOINT(x-1,y+1);
-					p2 = NMLPOINT(x,y+1);
-					v1 = p1 - p0;
-					v2 = p2 - p0;
-					n = CrossProduct(v2, v1);
+static TVector3d DecodeNormal(uint32_t packed) {
+	double u = (int16_t)(packed & 0xffff) / 32767.0;
+	double v = (int16_t)(packed >> 16) / 32767.0;
+	double y = 1.0 - std::fabs(u) - std::fabs(v);
+	if (y < 0.0) {
+		double fu = (1.0 - std::fabs(v)) * SignNotZero(u);
+		v = (1.0 - std::fabs(u)) * SignNotZero(v);
+		u = fu;
+	}
+	TVector3d n(u, y, v);
+	n.Norm();
+	return n;
+}
 
-					n.Norm();
-					nml += n;
-				}
-				if (x < nx-1 && y > 0) {
-					TVector3d p1 = NMLPOINT(x+1,y);
-					TVector3d p2 = NMLPOINT(x+1,y-1);
-					TVector3d v1 = p1 - p0;
-					TVector3d v2 = p2 - p0;
-					TVector3d n = CrossProduct(v2, v1);
+static void StoreNormal(float* out, const TVector3d& n) {
+	out[0] = (float)n.x;
+	out[1] = (float)n.y;
+	out[2] = (float)n.z;
+}
 
-					n.Norm();
-					nml += n;
+// Octahedron encoding: the normal is projected onto the octahedron
+// |x|+|y|+|z| = 1, the lower half is folded over the upper one, and the x
+// and z coordinates of the result are stored as signed 16 bit values
+static uint32_t EncodeNormal(const TVector3d& n) {
+	double sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	double u = 0.0;
+	double v = 0.0;
+	if (sum > 0.0) {
+		u = n.x / sum;
+		v = n.z / sum;
+		if (n.y < 0.0) {
+			double fu = (1.0 - std::fabs(v)) * SignNotZero(u);
+			v = (1.0 - std::fabs(u)) * SignNotZero(v);
+			u = fu;
+		}
+	}
+	int16_t qu = (int16_t)std::lround(std::min(std::max(u, -1.0), 1.0) * 32767.0);
+	int16_t qv = (int16_t)std::lround(std::min(std::max(v, -1.0), 1.0) * 32767.0);
+	return (uint32_t)(uint16_t)qu | ((uint32_t)(uint16_t)qv << 16);
+}
 
-					p1 = NMLPOINT(x+1,y-1);
-					p2 = NMLPOINT(x,y-1);
-					v1 = p1 - p0;
-					v2 = p2 - p0;
-					n = CrossProduct(v2, v1);
+// The normal is kept as the course cache holds it, so a course computed
+// from its maps and one loaded from the cache are the same. Encoding a
+// decoded normal again gives the same 16 bit values, the rounding errors
+// are far below half a step.
+void CourseFields::SetNormal(std::size_t i, const TVector3d& n) {
+	StoreNormal(&normals[3*i], DecodeNormal(EncodeNormal(n)));
+}
 
-					n.Norm();
-					nml += n;
-				}
-				if (x < nx-1 && y < ny-1) {
-					TVector3d p1 = NMLPOINT(x+1,y);
-					TVector3d p2 = NMLPOINT(x+1,y+1);
-					TVector3d v1 = p1 - p0;
-					TVector3d v2 = p2 - p0;
-					TVector3d n = CrossProduct(v1, v2);
+void CourseFields::PackNormals(std::vector<uint32_t>& packed) const {
+	std::size_t n = size();
+	packed.resize(n);
+	std::size_t blocks = std::min<std::size_t>(n, ParallelThreads() * 4);
+	ParallelFor(blocks, [&](std::size_t b) {
+		for (std::size_t i = b * n / blocks; i < (b + 1) * n / blocks; i++)
+			packed[i] = EncodeNormal(Normal(i));
+	});
+}
 
-					n.Norm();
-					nml += n;
+void CourseFields::UnpackNormals(const std::vector<uint32_t>& packed) {
+	std::size_t n = packed.size();
+	std::size_t blocks = std::min<std::size_t>(n, ParallelThreads() * 4);
+	ParallelFor(blocks, [&](std::size_t b) {
+		for (std::size_t i = b * n / blocks; i < (b + 1) * n / blocks; i++)
+			StoreNormal(&normals[3*i], DecodeNormal(packed[i]));
+	});
+}
 
-					p1 = NMLPOINT(x+1,y+1);
-					p2 = NMLPOINT(x,y+1);
-					v1 = p1 - p0;
-					v2 = p2 - p0;
-					n = CrossProduct(v1, v2);
+// Negates the x component of a normal. The quantisation is symmetric, so
+// the result is a decoded normal again and mirroring twice restores the
+// original value.
+void CourseFields::MirrorNormal(std::size_t i) {
+	normals[3*i] = -normals[3*i];
+}
 
-					n.Norm();
-					nml += n;
-				}
-			} else {
-				if (x > 0 && y > 0) {
-					TVector3d p1 = NMLPOINT(x,  y-1);
-					TVector3d p2 = NMLPOINT(x-1,y);
-					TVector3d v1 = p1 - p0;
-					TVector3d v2 = p2 - p0;
-					TVector3d n = CrossProduct(v2, v1);
+void CourseFields::SwapNormals(std::size_t i, std::size_t j) {
+	std::swap_ranges(&normals[3*i], &normals[3*i+3], &normals[3*j]);
+}
 
-					n.Norm();
-					nml += n;
-				}
-				if (x > 0 && y < ny-1) {
-					TVector3d p1 = NMLPOINT(x-1,y);
-					TVector3d p2 = NMLPOINT(x,y+1);
-					TVector3d v1 = p1 - p0;
-					TVector3d v2 = p2 - p0;
-					TVector3d n = CrossProduct(v2, v1);
+// The grid is split into triangles along alternating diagonals. A vertex
+// with even x+y touches up to eight triangles, the others up to four. The
+// triangles are given by the offsets of their two other corners, grouped
+// by the quadrant they lie in and listed in the order the normals are
+// summed. The corners are ordered so that CrossProduct(v2, v1) points up.
+struct TNmlTri {
+	int dx1, dy1;
+	int dx2, dy2;
+};
+
+static const TNmlTri even_tris[4][2] = {
+	{ {  0, -1, -1, -1 }, { -1, -1, -1,  0 } },
+	{ { -1,  0, -1,  1 }, { -1,  1,  0,  1 } },
+	{ {  1,  0,  1, -1 }, {  1, -1,  0, -1 } },
+	{ {  1,  1,  1,  0 }, {  0,  1,  1,  1 } }
+};
+
+static const TNmlTri odd_tris[4] = {
+	{  0, -1, -1,  0 },
+	{ -1,  0,  0,  1 },
+	{  1,  0,  0, -1 },
+	{  0,  1,  1,  0 }
+};
+
+// Computes the normals of the rows [y0, y1). The arithmetic is the same as
+// that of the former per vertex code, so the results are bit identical;
+// that is why the rows are computed in doubles, not in floats.
+void CCourse::CalcNormalRows(unsigned int y0, unsigned int y1, const std::vector<double>& xcd) {
+	for (unsigned int y = y0; y < y1; y++) {
+		const double z0 = ZCD(y);
+		const double zcd[3] = { y > 0 ? ZCD(y-1) : 0.0, z0, ZCD(y+1) };
 
-					n.Norm();
-					nml += n;
-				}
-				if (x < nx-1 && y > 0) {
-					TVector3d p1 = NMLPOINT(x+1,y);
-					TVector3d p2 = NMLPOINT(x,y-1);
-					TVector3d v1 = p1 - p0;
-					TVector3d v2 = p2 - p0;
-					TVector3d n = CrossProduct(v2, v1);
+		for (unsigned int x = 0; x < nx; x++) {
+			// quadrants 0: x-,y-  1: x-,y+  2: x+,y-  3: x+,y+
+			bool quadrant[4] = {
+				x > 0 && y > 0,
+				x > 0 && y < ny-1,
+				x < nx-1 && y > 0,
+				x < nx-1 && y < ny-1
+			};
+			const double x0 = xcd[x];
+			const double e0 = ELEV(x, y);
+			int tris_per_quadrant = ((x + y) & 1) ? 1 : 2;
+			const TNmlTri* tris = ((x + y) & 1) ? odd_tris : &even_tris[0][0];
 
-					n.Norm();
-					nml += n;
-				}
-				if (x < nx-1 && y < ny-1) {
-					TVector3d p1 = NMLPOINT(x+1,y);
-					TVector3d p2 = NMLPOINT(x,y+1);
-					TVector3d v1 = p1 - p0;
-					TVector3d v2 = p2 - p0;
-					TVector3d n = CrossProduct(v1, v2);
+			TVector3d nml(0.0, 0.0, 0.0);
+			for (int q = 0; q < 4; q++) {
+				if (!quadrant[q]) continue;
+				for (int t = 0; t < tris_per_quadrant; t++) {
+					const TNmlTri& tri = tris[q * tris_per_quadrant + t];
+					TVector3d v1(xcd[x + tri.dx1] - x0,
+					             ELEV(x + tri.dx1, y + tri.dy1) - e0,
+					             zcd[1 + tri.dy1] - z0);
+					TVector3d v2(xcd[x + tri.dx2] - x0,
+					             ELEV(x + tri.dx2, y + tri.dy2) - e0,
+					             zcd[1 + tri.dy2] - z0);
+					TVector3d n = CrossProduct(v2, v1);
 
 					n.Norm();
 					nml += n;
 				}
 			}
 			nml.Norm();
-			Fields[x + nx * y].nml = nml;
-			continue;
-
+			Fields.SetNormal(x + nx * y, nml);
 		}
 	}
 }
 
+// Splits the rows into more blocks than threads, so the work stays
+// balanced when a thread is delayed
+static std::size_t RowBlocks(unsigned int rows) {
+	return std::min<std::size_t>(rows, ParallelThreads() * 4);
+}
+
+void CCourse::CalcNormals() {
+	if (nx == 0 || ny == 0) return;
+
+	std::vector<double> xcd(nx);
+	for (unsigned int x = 0; x < nx; x++)
+		xcd[x] = XCD(x);
+
+	std::size_t blocks = RowBlocks(ny);
+	ParallelFor(blocks, [&](std::size_t b) {
+		CalcNormalRows((unsigned int)(b * ny / blocks), (unsigned int)((b + 1) * ny / blocks), xcd);
+	});
+}
+
 void CCourse::MakeCourseNormals() {
 	CalcNormals();
 }
@@ -244,30 +313,63 @@ void CCourse::MakeCourseNormals() {
 //					FillGlArrays
 // --------------------------------------------------------------------
 
+// The positions and normals are derived from the fields whenever they are
+// needed, the fields stay the only copy kept in memory. Only the colours,
+// which are rewritten for every terrain pass, have an array of their own.
 void CCourse::FillGlArrays() {
-	if (vnc_array == nullptr)
-		vnc_array = new GLubyte[STRIDE_GL_ARRAY * nx * ny];
-
-	for (unsigned int x = 0; x < nx; x++) {
-		for (unsigned int y = 0; y < ny; y++) {
-			int idx = STRIDE_GL_ARRAY * (y * nx + x);
-
-			FLOATVAL(0) = (GLfloat)x / (nx-1.f) * curr_course->size.x;
-			FLOATVAL(1) = Fields[x + nx*y].elevation;
-			FLOATVAL(2) = -(GLfloat)y / (ny-1.f) * curr_course->size.y;
-
-			const TVector3d& nml = Fields[ x + y * nx ].nml;
-			FLOATVAL(4) = nml.x;
-			FLOATVAL(5) = nml.y;
-			FLOATVAL(6) = nml.z;
-			FLOATVAL(7) = 1.0f;
-
-			BYTEVAL(0) = 255;
-			BYTEVAL(1) = 255;
-			BYTEVAL(2) = 255;
-			BYTEVAL(3) = 255;
+	col_array.assign(4 * nx * ny, 255);
+	std::vector<GLfloat>().swap(vn_array);
+	vn_buffer_valid = false;
+}
+
+void CCourse::FillVertexArray(GLfloat* out) const {
+	std::size_t blocks = RowBlocks(ny);
+	ParallelFor(blocks, [&](std::size_t b) {
+		unsigned int y1 = (unsigned int)((b + 1) * ny / blocks);
+		for (unsigned int y = (unsigned int)(b * ny / blocks); y < y1; y++) {
+			const GLfloat z = -(GLfloat)y / (ny-1.f) * curr_course->size.y;
+			GLfloat* vtx = out + 6 * nx * y;
+
+			for (unsigned int x = 0; x < nx; x++, vtx += 6) {
+				std::size_t idx = x + nx * y;
+				TVector3d nml = Fields.Normal(idx);
+				vtx[0] = (GLfloat)x / (nx-1.f) * curr_course->size.x;
+				vtx[1] = Fields.elevation[idx];
+				vtx[2] = z;
+				vtx[3] = (GLfloat)nml.x;
+				vtx[4] = (GLfloat)nml.y;
+				vtx[5] = (GLfloat)nml.z;
+			}
 		}
+	});
+}
+
+// Client side positions and normals, for drivers without buffer objects
+const GLfloat* CCourse::GetVertexArray() {
+	if (vn_array.empty() && nx > 0 && ny > 0) {
+		vn_array.resize(6 * nx * ny);
+		FillVertexArray(&vn_array[0]);
 	}
+	return vn_array.empty() ? nullptr : &vn_array[0];
+}
+
+// Binds the buffer object holding the positions and normals, (re)uploading
+// it if the fields changed. The data is generated for the upload only.
+// Returns false if buffer objects are not available.
+bool CCourse::BindGLBuffer() {
+	if (!HaveBufferObjects() || nx == 0 || ny == 0)
+		return false;
+
+	if (vn_buffer == 0)
+		glGenBuffers_p(1, &vn_buffer);
+	glBindBuffer_p(GL_ARRAY_BUFFER, vn_buffer);
+	if (!vn_buffer_valid) {
+		std::vector<GLfloat> data(6 * nx * ny);
+		FillVertexArray(&data[0]);
+		glBufferData_p(GL_ARRAY_BUFFER, STRIDE_GL_ARRAY * nx * ny, &data[0], GL_STATIC_DRAW);
+		vn_buffer_valid = true;
+	}
+	return true;
 }
 
 void CCourse::MakeStandardPolyhedrons() {
@@ -297,6 +399,22 @@ void CCourse::MakeStandardPolyhedrons() {
 	};
 }
 
+// The textures are only queued here and loaded by TexQueue, which
+// allows the images to be decoded on a loader thread
+void CCourse::RequestTerrainTexture(std::size_t idx) {
+	if (TerrList[idx].texture == nullptr && !headless) {
+		TerrList[idx].texture = new TTexture();
+		TexQueue.Add(TerrList[idx].texture, MakePathStr(param.terr_dir, TerrList[idx].textureFile), true);
+	}
+}
+
+void CCourse::RequestObjectTexture(std::size_t type) {
+	if (ObjTypes[type].texture == nullptr && ObjTypes[type].drawable && !headless) {
+		ObjTypes[type].texture = new TTexture();
+		TexQueue.Add(ObjTypes[type].texture, MakePathStr(param.obj_dir, ObjTypes[type].textureFile), false);
+	}
+}
+
 void CCourse::FreeTerrainTextures() {
 	if (!g_game.active)
 		return;
@@ -339,10 +457,10 @@ bool CCourse::LoadElevMap() {
 	const uint8_t* data = img.getPixelsPtr();
 	for (unsigned int y = 0; y < ny; y++) {
 		for (unsigned int x = 0; x < nx; x++) {
-			Fields[(nx - 1 - x) + nx * (ny - 1 - y)].elevation =
+			Fields.elevation[(nx - 1 - x) + nx * (ny - 1 - y)] = (float)(
 			    ((data[(x + nx*y) * depth + pad]
 			      - base_height_value) / 255.0) * curr_course->scale
-			    - (double)(ny-1-y) / ny * curr_course->size.y * slope;
+			    - (double)(ny-1-y) / ny * curr_course->size.y * slope);
 		}
 		pad += (nx * depth) % 4;
 	}
@@ -378,10 +496,7 @@ void CCourse::LoadItemList() {
 
 		std::string name = SPStrN(*line, "name");
 		std::size_t type = ObjectIndex[name];
-		if (ObjTypes[type].texture == nullptr && ObjTypes[type].drawable) {
-			ObjTypes[type].texture = new TTexture();
-			ObjTypes[type].texture->Load(MakePathStr(param.obj_dir, ObjTypes[type].textureFile), false);
-		}
+		RequestObjectTexture(type);
 
 		if (ObjTypes[type].collidable)
 			CollArr.emplace_back(xx, FindYCoord(xx, zz), zz, height, diam, type);
@@ -391,27 +506,71 @@ void CCourse::LoadItemList() {
 	std::sort(CollArr.begin(), CollArr.end(), [](const TCollidable& l, const TCollidable& r) -> bool {
 		return l.tree_type < r.tree_type;
 	});
+	BuildObjectGrids();
+}
+
+void CCourse::BuildObjectGrids() {
+	CollGrid.Build(CollArr, curr_course->size);
+	ItemGrid.Build(NocollArr, curr_course->size, [](const TItem& item) {
+		return item.collectable != 0 && item.type.drawable;
+	});
+	CollectGrid.Build(NocollArr, curr_course->size, [](const TItem& item) {
+		return item.collectable == 1;
+	});
+}
+
+void CCourse::ResetItems() {
+	for (std::size_t i = 0; i < NocollArr.size(); i++) {
+		if (NocollArr[i].collectable != -1)
+			NocollArr[i].collectable = 1;
+	}
+	if (curr_course != nullptr)
+		BuildObjectGrids();
+}
+
+void CCourse::CollectItem(std::size_t idx) {
+	NocollArr[idx].collectable = 0;
+	ItemGrid.Remove((uint32_t)idx, NocollArr[idx].pt);
+	CollectGrid.Remove((uint32_t)idx, NocollArr[idx].pt);
 }
 
 // --------------------	LoadObjectMap ---------------------------------
 
+void TColorLookup::Clear() {
+	std::memset(chan, 0, sizeof(chan));
+}
 
-static int GetObject(const unsigned char* pixel) {
-	int r = pixel[0];
-	int g = pixel[1];
-	int b = pixel[2];
+void TColorLookup::AddRange(std::size_t entry, int channel, int min, int max) {
+	min = std::max(min, 0);
+	max = std::min(max, 255);
+	for (int v = min; v <= max; v++)
+		chan[channel][v] |= (uint64_t)1 << entry;
+}
 
-	if (r<150 && b>200) return 0;
-	if (std::abs(r-194)<10 && std::abs(g-40)<10 && std::abs(b-40)<10) return 1;
-	if (std::abs(r-128)<10 && std::abs(g-128)<10 && b<10) return 2;
-	if (r>220 && g>220 && b<20) return 3;
-	if (r>220 && std::abs(g-128)<10 && b>220) return 4;
-	if (r>220 && g>220 && b>220) return 5;
-	if (r>220 && std::abs(g-96)<10 && b<40) return 6;
-	if (r<40 && g >220 && b<80) return 7;
-	return -1;
+int TColorLookup::Find(const unsigned char* pixel) const {
+	uint64_t match = chan[0][pixel[0]] & chan[1][pixel[1]] & chan[2][pixel[2]];
+	if (match == 0) return -1;
+	int idx = 0;
+	while ((match & 1) == 0) {
+		match >>= 1;
+		idx++;
+	}
+	return idx;
 }
 
+// The colours of the object types in trees.png, as inclusive ranges of
+// red, green and blue. The first matching entry wins.
+static const int ObjectColors[][6] = {
+	{   0, 149,   0, 255, 201, 255 },
+	{ 185, 203,  31,  49,  31,  49 },
+	{ 119, 137, 119, 137,   0,   9 },
+	{ 221, 255, 221, 255,   0,  19 },
+	{ 221, 255, 119, 137, 221, 255 },
+	{ 221, 255, 221, 255, 221, 255 },
+	{ 221, 255,  87, 105,   0,  39 },
+	{   0,  39, 221, 255,   0,  79 }
+};
+
 #define TREE_MIN 2.0
 #define TREE_MAX 5.0
 #define BARREN_MIN 4.0
@@ -423,55 +582,41 @@ const double sizefact[6] = {0.5, 0.5, 0.7, 1.0, 1.4, 2.0};
 const double varfact[6] = {1.0, 1.0, 1.22, 1.41, 1.73, 2.0};
 const double diamfact = 1.4;
 
-static void CalcRandomTrees(double baseheight, double basediam, double &height, double &diam) {
-	double hhh = baseheight * sizefact[g_game.treesize];
-	double minsiz = hhh / varfact[g_game.treevar];
-	double maxsiz = hhh * varfact[g_game.treevar];
-	height = XRandom(minsiz, maxsiz);
-	diam = XRandom(height/diamfact, height);
+static void CalcRandomTrees(CRandom& rand_gen, int size, int var, double baseheight, double &height, double &diam) {
+	double hhh = baseheight * sizefact[size];
+	double minsiz = hhh / varfact[var];
+	double maxsiz = hhh * varfact[var];
+	height = rand_gen.Range(minsiz, maxsiz);
+	diam = rand_gen.Range(height/diamfact, height);
 }
 
-bool CCourse::LoadAndConvertObjectMap() {
-	sf::Image treeImg;
-
-	if (!treeImg.loadFromFile(CourseDir + SEP "trees.png")) {
-		Message("unable to open trees.png");
-		return false;
-	}
-	treeImg.flipVertically();
-
-	int pad = 0;
-	int cnt = 0;
-	int depth = 4;
-	const unsigned char* data = (unsigned char*)treeImg.getPixelsPtr();
+// Creates the items of the object types found in trees.png, given as one
+// type index (or -1) per pixel in image order
+void CCourse::ConvertObjectMap(const std::vector<int8_t>& objects) {
 	double height, diam;
 	CSPList savelist;
+	CRandom rand_gen;	// the same trees for the same map and settings
 
 	CollArr.clear();
 	NocollArr.clear();
 	for (unsigned int y = 0; y < ny; y++) {
 		for (unsigned int x = 0; x < nx; x++) {
-			int imgidx = (x + nx * y) * depth + pad;
-			int type = GetObject(&data[imgidx]);
+			int type = objects[x + nx * y];
 			if (type >= 0) {
-				cnt++;
 				double xx = (nx - x) / (double)((double)nx - 1.0) * curr_course->size.x;
 				double zz = -(int)(ny - y) / (double)((double)ny - 1.0) * curr_course->size.y;
-				if (ObjTypes[type].texture == nullptr && ObjTypes[type].drawable) {
-					ObjTypes[type].texture = new TTexture();
-					ObjTypes[type].texture->Load(MakePathStr(param.obj_dir, ObjTypes[type].textureFile), false);
-				}
+				RequestObjectTexture(type);
 
 				// set random height and diam - see constants above
 				switch (type) {
 					case 5:
-						CalcRandomTrees(2.5, 2.5, height, diam);
+						CalcRandomTrees(rand_gen, tree_size, tree_var, 2.5, height, diam);
 						break;
 					case 6:
-						CalcRandomTrees(3, 3, height, diam);
+						CalcRandomTrees(rand_gen, tree_size, tree_var, 3, height, diam);
 						break;
 					case 7:
-						CalcRandomTrees(1.2, 1.2, height, diam);
+						CalcRandomTrees(rand_gen, tree_size, tree_var, 1.2, height, diam);
 						break;
 
 					case 2:
@@ -500,11 +645,12 @@ bool CCourse::LoadAndConvertObjectMap() {
 				savelist.Add(line);
 			}
 		}
-		pad += (nx * depth) % 4;
 	}
+	BuildObjectGrids();
+
 	std::string itemfile = CourseDir + SEP "items.lst";
-	savelist.Save(itemfile);  // Convert trees.png to items.lst
-	return true;
+	if (!headless)
+		savelist.Save(itemfile);  // Convert trees.png to items.lst
 }
 
 // --------------------------------------------------------------------
@@ -546,6 +692,12 @@ bool CCourse::LoadObjectTypes() {
 		ObjTypes[i].poly = 1;
 	}
 	list.MakeIndex(ObjectIndex, "name");
+
+	ObjLookup.Clear();
+	for (std::size_t k = 0; k < sizeof(ObjectColors) / sizeof(ObjectColors[0]); k++) {
+		for (int c = 0; c < 3; c++)
+			ObjLookup.AddRange(k, c, ObjectColors[k][2*c], ObjectColors[k][2*c+1]);
+	}
 	return true;
 }
 
@@ -554,7 +706,12 @@ bool CCourse::LoadObjectTypes() {
 // ====================================================================
 
 int CCourse::GetTerrain(const unsigned char* pixel) const {
-	for (std::size_t i=0; i<TerrList.size(); i++) {
+	int terr = TerrLookup.Find(pixel);
+	if (terr >= 0)
+		return terr;
+
+	// terrains beyond the size of the lookup table
+	for (std::size_t i=64; i<TerrList.size(); i++) {
 		if (std::abs(pixel[0]-TerrList[i].col.r) < 30
 		        && std::abs(pixel[1]-TerrList[i].col.g) < 30
 		        && std::abs(pixel[2]-TerrList[i].col.b) < 30) {
@@ -593,14 +750,25 @@ bool CCourse::LoadTerrainTypes() {
 		TerrList[i].shiny = SPBoolN(*line, "shiny", false);
 		TerrList[i].vol_type = SPIntN(*line, "vol_type", 1);
 	}
+
+	// a pixel belongs to a terrain if all channels differ by less than 30
+	TerrLookup.Clear();
+	for (std::size_t k = 0; k < TerrList.size() && k < 64; k++) {
+		const sf::Color& col = TerrList[k].col;
+		TerrLookup.AddRange(k, 0, col.r - 29, col.r + 29);
+		TerrLookup.AddRange(k, 1, col.g - 29, col.g + 29);
+		TerrLookup.AddRange(k, 2, col.b - 29, col.b + 29);
+	}
 	return true;
 }
 
 // --------------------------------------------------------------------
-//					LoadTerrainMap
+//					LoadCourseMaps
 // --------------------------------------------------------------------
 
-bool CCourse::LoadTerrainMap() {
+// Decodes terrain.png and, if convert_objects is set, trees.png. Both maps
+// are decoded in the same pass over the rows, which runs in parallel.
+bool CCourse::LoadCourseMaps(bool convert_objects) {
 	sf::Image terrImage;
 
 	if (!terrImage.loadFromFile(CourseDir + SEP "terrain.png")) {
@@ -612,22 +780,46 @@ bool CCourse::LoadTerrainMap() {
 		Message("wrong terrain size");
 	}
 
+	sf::Image treeImg;
+	if (convert_objects) {
+		if (treeImg.loadFromFile(CourseDir + SEP "trees.png"))
+			treeImg.flipVertically();
+		else {
+			Message("unable to open trees.png");
+			convert_objects = false;
+		}
+	}
+
 	int depth = 4;
+	int rowpad = (nx * depth) % 4;
 	const unsigned char* data = (const unsigned char*) terrImage.getPixelsPtr();
-	int pad = 0;
-	for (unsigned int y = 0; y < ny; y++) {
-		for (unsigned int x = 0; x < nx; x++) {
-			int imgidx = (x+nx*y) * depth + pad;
-			int arridx = (nx-1-x) + nx * (ny-1-y);
-			int terr = GetTerrain(&data[imgidx]);
-			Fields[arridx].terrain = terr;
-			if (TerrList[terr].texture == nullptr) {
-				TerrList[terr].texture = new TTexture();
-				TerrList[terr].texture->Load(param.terr_dir, TerrList[terr].textureFile, true);
+	const unsigned char* objdata = convert_objects ? (const unsigned char*) treeImg.getPixelsPtr() : nullptr;
+	std::vector<int8_t> objects(convert_objects ? nx * ny : 0);
+
+	std::size_t blocks = RowBlocks(ny);
+	ParallelFor(blocks, [&](std::size_t b) {
+		unsigned int y1 = (unsigned int)((b + 1) * ny / blocks);
+		for (unsigned int y = (unsigned int)(b * ny / blocks); y < y1; y++) {
+			int pad = y * rowpad;
+			for (unsigned int x = 0; x < nx; x++) {
+				int imgidx = (x+nx*y) * depth + pad;
+				Fields.terrain[(nx-1-x) + nx * (ny-1-y)] = (uint8_t)GetTerrain(&data[imgidx]);
+				if (objdata != nullptr)
+					objects[x + nx * y] = (int8_t)ObjLookup.Find(&objdata[imgidx]);
 			}
 		}
-		pad += (nx * depth) % 4;
+	});
+
+	std::vector<bool> used(TerrList.size(), false);
+	for (std::size_t i = 0; i < Fields.size(); i++)
+		used[Fields.terrain[i]] = true;
+	for (std::size_t i = 0; i < TerrList.size(); i++) {
+		if (used[i])
+			RequestTerrainTexture(i);
 	}
+
+	if (convert_objects)
+		ConvertObjectMap(objects);
 	return true;
 }
 
@@ -635,7 +827,7 @@ bool CCourse::LoadTerrainMap() {
 //					CCourseList
 // --------------------------------------------------------------------
 
-bool CCourseList::Load(const std::string& dir) {
+bool CCourseList::Load(const std::string& dir, bool previews) {
 	CSPList list;
 
 	if (!list.Load(dir, "courses.lst")) {
@@ -654,10 +846,13 @@ bool CCourseList::Load(const std::string& dir) {
 		std::string coursepath = MakePathStr(dir, courses[i].dir);
 		if (DirExists(coursepath.c_str())) {
 			// preview
-			std::string previewfile = coursepath + SEP "preview.png";
-			courses[i].preview = new TTexture();
-			if (!courses[i].preview->Load(previewfile, false)) {
-				Message("couldn't load previewfile");
+			courses[i].preview = nullptr;
+			if (previews) {
+				std::string previewfile = coursepath + SEP "preview.png";
+				courses[i].preview = new TTexture();
+				if (!courses[i].preview->Load(previewfile, false)) {
+					Message("couldn't load previewfile");
+				}
 			}
 
 			// params
@@ -680,7 +875,7 @@ bool CCourseList::Load(const std::string& dir) {
 			courses[i].music_theme = Music.GetThemeIdx(SPStrN(line2, "theme", "normal"));
 			courses[i].use_keyframe = SPBoolN(line2, "use_keyframe", false);
 			courses[i].finish_brake = SPFloatN(line2, "finish_brake", 20);
-			if (paramlist.size() >= 2)
+			if (previews && paramlist.size() >= 2)
 				courses[i].SetTranslatedData(paramlist.back());
 			paramlist.clear();	// the list is used several times
 		}
@@ -703,7 +898,9 @@ void CCourse::FreeCourseList() {
 		i->second.Free();
 }
 
-bool CCourse::LoadCourseList() {
+// Without previews the list can be loaded without an OpenGL context. The
+// translated descriptions are skipped then as well, they need the fonts.
+bool CCourse::LoadCourseList(bool previews) {
 	CSPList list;
 
 	if (!list.Load(param.common_course_dir, "groups.lst")) {
@@ -713,7 +910,7 @@ bool CCourse::LoadCourseList() {
 
 	for (CSPList::const_iterator line = list.cbegin(); line != list.cend(); ++line) {
 		std::string dir = SPStrN(*line, "dir", "nodir");
-		CourseLists[dir].Load(MakePathStr(param.common_course_dir, dir));
+		CourseLists[dir].Load(MakePathStr(param.common_course_dir, dir), previews);
 		CourseLists[dir].name = dir;
 	}
 	currentCourseList = &CourseLists["default"];
@@ -726,76 +923,344 @@ CCourseList* CCourse::getGroup(std::size_t index) {
 	return &i->second;
 }
 
+// --------------------------------------------------------------------
+//					course cache
+// --------------------------------------------------------------------
+// The cache (<group>_<course>.etrc in the cache directory of the user
+// config, since the course directory may be read-only) holds the item list
+// and the decoded field planes of a course. All blocks are stored in memory
+// layout and naturally aligned, so they are read straight into their
+// destination without any conversion. The file is
+// machine-specific; a different byte order or struct layout simply
+// invalidates it.
+
+#define COURSE_CACHE_VERSION 2
+#define COURSE_CACHE_ENDIAN 0x01020304
+
+struct TCourseCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t endian;
+	uint32_t field_size;
+	uint32_t nx, ny;
+	uint32_t num_terrains;
+	uint32_t num_objtypes;
+	uint32_t num_coll;
+	uint32_t num_nocoll;
+	uint32_t base_height;
+	double size_x, size_y;
+	double angle, scale;
+};
+
+struct TCourseCacheItem {
+	double x, y, z;
+	double height, diam;
+	uint32_t type;
+	uint32_t pad;
+};
+
+static void FillCacheHeader(TCourseCacheHeader& head, const TCourse* course) {
+	std::memset(&head, 0, sizeof(head));
+	std::memcpy(head.magic, "ETRC", 4);
+	head.version = COURSE_CACHE_VERSION;
+	head.endian = COURSE_CACHE_ENDIAN;
+	head.field_size = sizeof(float) + sizeof(uint32_t) + sizeof(uint8_t);
+	head.size_x = course->size.x;
+	head.size_y = course->size.y;
+	head.angle = course->angle;
+	head.scale = course->scale;
+}
+
+std::string CCourse::CacheFile() const {
+	return param.cache_dir + SEP + currentCourseList->name + '_' + curr_course->dir + ".etrc";
+}
+
+bool CCourse::CacheUpToDate() const {
+	std::time_t cachetime = FileModTime(CacheFile());
+	if (cachetime == 0)
+		return false;
+
+	// a missing items.lst means that trees.png has to be converted again
+	if (!FileExists(CourseDir + SEP "items.lst"))
+		return false;
+
+	static const char* const sources[] = {
+		"elev.png", "terrain.png", "trees.png", "course.dim", "items.lst"
+	};
+	for (std::size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+		if (FileModTime(CourseDir + SEP + sources[i]) >= cachetime)
+			return false;
+	}
+	// terrain and object indices refer to these lists. The times have a
+	// resolution of a second, so a file saved in the same second as the
+	// cache may be newer.
+	return FileModTime(MakePathStr(param.terr_dir, "terrains.lst")) < cachetime
+	       && FileModTime(MakePathStr(param.obj_dir, "object_types.lst")) < cachetime;
+}
+
+bool CCourse::LoadCourseCache() {
+	std::ifstream file(CacheFile(), std::ios::binary);
+	if (!file)
+		return false;
+
+	file.seekg(0, std::ios::end);
+	uint64_t filesize = (uint64_t)file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	// the header has to match course.dim and the lists, and the blocks it
+	// announces have to fill the file exactly before anything is allocated
+	TCourseCacheHeader head, expected;
+	FillCacheHeader(expected, curr_course);
+	if (!file.read(reinterpret_cast<char*>(&head), sizeof(head))
+	        || std::memcmp(head.magic, expected.magic, 4) != 0
+	        || head.version != expected.version
+	        || head.endian != expected.endian
+	        || head.field_size != expected.field_size
+	        || head.num_terrains != TerrList.size()
+	        || head.num_objtypes != ObjTypes.size()
+	        || head.base_height != (uint32_t)base_height_value
+	        || head.size_x != expected.size_x || head.size_y != expected.size_y
+	        || head.angle != expected.angle || head.scale != expected.scale
+	        || head.nx < 2 || head.ny < 2)
+		return false;
+	uint64_t expected_size = sizeof(head)
+	                         + ((uint64_t)head.num_coll + head.num_nocoll) * sizeof(TCourseCacheItem)
+	                         + (uint64_t)head.nx * head.ny * head.field_size;
+	if (expected_size != filesize) {
+		Message("course cache is truncated or corrupt", CacheFile());
+		return false;
+	}
+
+	nx = head.nx;
+	ny = head.ny;
+	Fields.resize(nx*ny);
+	std::vector<TCourseCacheItem> items(head.num_coll + head.num_nocoll);
+	std::vector<uint32_t> packed(nx * ny);
+	if ((!items.empty() && !file.read(reinterpret_cast<char*>(&items[0]), sizeof(TCourseCacheItem) * items.size()))
+	        || !file.read(reinterpret_cast<char*>(&Fields.elevation[0]), sizeof(float) * nx * ny)
+	        || !file.read(reinterpret_cast<char*>(&packed[0]), sizeof(uint32_t) * nx * ny)
+	        || !file.read(reinterpret_cast<char*>(&Fields.terrain[0]), sizeof(uint8_t) * nx * ny)) {
+		Message("course cache is truncated");
+		Fields.clear();
+		return false;
+	}
+	Fields.UnpackNormals(packed);
+	FillGlArrays();
+
+	// the textures of all terrains and objects which are in use
+	std::vector<bool> used(TerrList.size(), false);
+	for (std::size_t i = 0; i < Fields.size(); i++) {
+		if (Fields.terrain[i] >= TerrList.size())
+			Fields.terrain[i] = 0;
+		used[Fields.terrain[i]] = true;
+	}
+	for (std::size_t i = 0; i < TerrList.size(); i++) {
+		if (used[i])
+			RequestTerrainTexture(i);
+	}
+
+	CollArr.clear();
+	NocollArr.clear();
+	for (std::size_t i = 0; i < items.size(); i++) {
+		const TCourseCacheItem& item = items[i];
+		std::size_t type = item.type < ObjTypes.size() ? item.type : 0;
+		RequestObjectTexture(type);
+		if (i < head.num_coll)
+			CollArr.emplace_back(item.x, item.y, item.z, item.height, item.diam, type);
+		else
+			NocollArr.emplace_back(item.x, item.y, item.z, item.height, item.diam, ObjTypes[type]);
+	}
+	BuildObjectGrids();
+	return true;
+}
+
+void CCourse::SaveCourseCache() const {
+	TCourseCacheHeader head;
+	FillCacheHeader(head, curr_course);
+	head.nx = nx;
+	head.ny = ny;
+	head.num_terrains = (uint32_t)TerrList.size();
+	head.num_objtypes = (uint32_t)ObjTypes.size();
+	head.num_coll = (uint32_t)CollArr.size();
+	head.num_nocoll = (uint32_t)NocollArr.size();
+	head.base_height = (uint32_t)base_height_value;
+
+	std::vector<TCourseCacheItem> items;
+	items.reserve(CollArr.size() + NocollArr.size());
+	for (std::size_t i = 0; i < CollArr.size(); i++) {
+		const TCollidable& obj = CollArr[i];
+		TCourseCacheItem item = { obj.pt.x, obj.pt.y, obj.pt.z, obj.height, obj.diam, (uint32_t)obj.tree_type, 0 };
+		items.push_back(item);
+	}
+	for (std::size_t i = 0; i < NocollArr.size(); i++) {
+		const TItem& obj = NocollArr[i];
+		TCourseCacheItem item = { obj.pt.x, obj.pt.y, obj.pt.z, obj.height, obj.diam, (uint32_t)(&obj.type - &ObjTypes[0]), 0 };
+		items.push_back(item);
+	}
+
+	// without a cache directory the course is simply decoded every time
+	if (!MakeDir(param.cache_dir))
+		return;
+
+	std::ofstream file(CacheFile(), std::ios::binary | std::ios::trunc);
+	if (!file) {
+		Message("could not write course cache", CacheFile());
+		return;
+	}
+	std::vector<uint32_t> packed;
+	Fields.PackNormals(packed);
+	file.write(reinterpret_cast<const char*>(&head), sizeof(head));
+	if (!items.empty())
+		file.write(reinterpret_cast<const char*>(&items[0]), sizeof(TCourseCacheItem) * items.size());
+	file.write(reinterpret_cast<const char*>(&Fields.elevation[0]), sizeof(float) * nx * ny);
+	file.write(reinterpret_cast<const char*>(&packed[0]), sizeof(uint32_t) * nx * ny);
+	file.write(reinterpret_cast<const char*>(&Fields.terrain[0]), sizeof(uint8_t) * nx * ny);
+	if (!file)
+		Message("could not write course cache", CacheFile());
+}
+
 //  ===================================================================
 //					LoadCourse
 //  ===================================================================
 
 void CCourse::ResetCourse() {
 	Fields.clear();
-	delete[] vnc_array;
-	vnc_array = nullptr;
+	CollGrid.Clear();
+	ItemGrid.Clear();
+	CollectGrid.Clear();
+	std::vector<GLfloat>().swap(vn_array);
+	std::vector<GLubyte>().swap(col_array);
+	vn_buffer_valid = false;
 
 	FreeTerrainTextures();
 	FreeObjectTextures();
-	ResetQuadtree();
+	if (!headless) {
+		ResetTreeGeometry();
+		ResetQuadtree();
+	}
 	curr_course = nullptr;
 	mirrored = false;
 }
 
-bool CCourse::LoadCourse(TCourse* course) {
-	if (course != curr_course || g_game.force_treemap) {
-		ResetCourse();
-		curr_course = course;
-		CourseDir = param.common_course_dir + SEP + currentCourseList->name + SEP + curr_course->dir;
+// The items are rebuilt from trees.png on request of the race selection,
+// never for a headless course
+bool CCourse::ForceTreemap() const {
+	return !headless && g_game.force_treemap;
+}
 
-		start_pt.x = course->start.x;
-		start_pt.y = -course->start.y;
-		base_height_value = 127;
+// Starts loading a course. Returns false if the course is already loaded,
+// otherwise PrepareCourse has to follow.
+bool CCourse::BeginLoadCourse(TCourse* course) {
+	if (!headless)
+		SetTreeSize(g_game.treesize, g_game.treevar);
+	if (course == curr_course && !ForceTreemap())
+		return false;
 
-		g_game.use_keyframe = course->use_keyframe;
-		g_game.finish_brake = course->finish_brake;
+	ResetCourse();
+	curr_course = course;
+	CourseDir = param.common_course_dir + SEP + currentCourseList->name + SEP + curr_course->dir;
 
+	start_pt.x = course->start.x;
+	start_pt.y = -course->start.y;
+	base_height_value = 127;
+	prepare_step = 0;
+	return true;
+}
+
+// Reads and decodes the course files. This doesn't use OpenGL, so it can
+// run on a loader thread; the textures are left in TexQueue.
+bool CCourse::PrepareCourse() {
+	bool cached = !ForceTreemap() && CacheUpToDate() && LoadCourseCache();
+	if (!cached) {
 		if (!LoadElevMap()) {
 			Message("could not load course elev map");
 			return false;
 		}
+		prepare_step = 1;
 
 		MakeCourseNormals();
 		FillGlArrays();
+		prepare_step = 2;
+
+		// ................................................................
+		std::string itemfile = CourseDir + SEP "items.lst";
+		bool convert_objects = !FileExists(itemfile) || ForceTreemap();
 
-		if (!LoadTerrainMap()) {
+		if (!LoadCourseMaps(convert_objects)) {
 			Message("could not load course terrain map");
 			return false;
 		}
+		prepare_step = 3;
 
+		if (!convert_objects)
+			LoadItemList();
 		// ................................................................
-		std::string itemfile = CourseDir + SEP "items.lst";
-		bool itemsexists = FileExists(itemfile);
-		const CControl *ctrl = g_game.player->ctrl;
 
-		if (itemsexists && !g_game.force_treemap)
-			LoadItemList();
-		else
-			LoadAndConvertObjectMap();
+		if (!headless)
+			SaveCourseCache();
+	}
+	prepare_step = PREPARE_STEPS;
+	if (!headless)
 		g_game.force_treemap = false;
-		// ................................................................
+	return true;
+}
+
+// The part of loading that needs OpenGL, after the textures of TexQueue
+// are uploaded. prepared tells whether PrepareCourse has succeeded.
+void CCourse::FinishLoadCourse(bool prepared) {
+	if (prepared) {
+		const CControl *ctrl = g_game.player->ctrl;
 
 		init_track_marks();
 		InitQuadtree(
-		    &Fields[0], nx, ny,
+		    &Fields, TerrList.size(), nx, ny,
 		    curr_course->size.x / (nx - 1.0),
 		    -curr_course->size.y / (ny - 1.0),
 		    ctrl->viewpos,
 		    param.course_detail_level);
 	}
+	UpdateMirror();
+}
 
-	if (g_game.mirrorred != mirrored) {
+void CCourse::SetMirrored(bool mirror) {
+	if (mirror != mirrored) {
 		MirrorCourse();
-		mirrored = g_game.mirrorred;
+		mirrored = mirror;
 	}
+}
+
+// Mirrors the course if it doesn't match g_game.mirrorred
+void CCourse::UpdateMirror() {
+	SetMirrored(g_game.mirrorred);
+}
+
+void CCourse::SetTreeSize(int size, int var) {
+	size = clamp(1, size, 5);
+	var = clamp(1, var, 5);
+	if (size == tree_size && var == tree_var)
+		return;
+	tree_size = size;
+	tree_var = var;
+	// a headless course is loaded again, its items may change
+	if (headless && curr_course != nullptr)
+		ResetCourse();
+}
+
+bool CCourse::LoadCourse(TCourse* course) {
+	bool load = BeginLoadCourse(course);
+	if (load && !PrepareCourse()) {
+		TexQueue.LoadAll();
+		return false;
+	}
+	TexQueue.LoadAll();
+	FinishLoadCourse(load);
 	return true;
 }
 
+float CCourse::PrepareProgress() const {
+	return (float)prepare_step / PREPARE_STEPS;
+}
+
 std::size_t CCourse::GetEnv() const {
 	return curr_course->env;
 }
@@ -807,19 +1272,17 @@ std::size_t CCourse::GetEnv() const {
 void CCourse::MirrorCourseData() {
 	for (unsigned int y = 0; y < ny; y++) {
 		for (unsigned int x = 0; x < nx / 2; x++) {
-			double tmp = ELEV(x,y);
-			ELEV(x,y) = ELEV(nx-1-x, y);
-			ELEV(nx-1-x,y) = tmp;
+			std::swap(ELEV(x,y), ELEV(nx-1-x, y));
 
 			int idx1 = (x+1) + nx*(y);
 			int idx2 = (nx-1-x) + nx*(y);
-			std::swap(Fields[idx1].terrain, Fields[idx2].terrain);
+			std::swap(Fields.terrain[idx1], Fields.terrain[idx2]);
 
 			idx1 = (x) + nx*(y);
 			idx2 = (nx-1-x) + nx*(y);
-			std::swap(Fields[idx1].nml, Fields[idx2].nml);
-			Fields[idx1].nml.x *= -1;
-			Fields[idx2].nml.x *= -1;
+			Fields.SwapNormals(idx1, idx2);
+			Fields.MirrorNormal(idx1);
+			Fields.MirrorNormal(idx2);
 		}
 	}
 
@@ -832,14 +1295,17 @@ void CCourse::MirrorCourseData() {
 		NocollArr[i].pt.x = curr_course->size.x - NocollArr[i].pt.x;
 		NocollArr[i].pt.y = FindYCoord(NocollArr[i].pt.x, NocollArr[i].pt.z);
 	}
-
+	BuildObjectGrids();
 	FillGlArrays();
 
-	ResetQuadtree();
-	if (nx > 0 && ny > 0) {
-		const CControl *ctrl = g_game.player->ctrl;
-		InitQuadtree(&Fields[0], nx, ny, curr_course->size.x/(nx-1),
-		             - curr_course->size.y/(ny-1), ctrl->viewpos, param.course_detail_level);
+	if (!headless) {
+		ResetTreeGeometry();
+		ResetQuadtree();
+		if (nx > 0 && ny > 0) {
+			const CControl *ctrl = g_game.player->ctrl;
+			InitQuadtree(&Fields, TerrList.size(), nx, ny, curr_course->size.x/(nx-1),
+			             - curr_course->size.y/(ny-1), ctrl->viewpos, param.course_detail_level);
+		}
 	}
 
 	start_pt.x = curr_course->size.x - start_pt.x;
@@ -847,18 +1313,19 @@ void CCourse::MirrorCourseData() {
 
 void CCourse::MirrorCourse() {
 	MirrorCourseData();
-	init_track_marks();
+	if (!headless)
+		init_track_marks();
 }
 
 // ********************************************************************
 //				from phys_sim:
 // ********************************************************************
 
-void CCourse::GetIndicesForPoint(double x, double z, unsigned int* x0, unsigned int* y0, unsigned int* x1, unsigned int* y1)  const {
-
-	double xidx = x / curr_course->size.x * ((double) nx - 1.);
-	double yidx = -z / curr_course->size.y * ((double) ny - 1.);
-
+// The grid cell around the point (xidx, yidx) in grid units and the
+// triangle of the cell it lies in, with the barycentric weights u and v of
+// the first two corners. Shared by the single and the batched lookups.
+static inline void GridCell(double xidx, double yidx, unsigned int nx, unsigned int ny,
+                            unsigned int* x0, unsigned int* y0, unsigned int* x1, unsigned int* y1) {
 	if (xidx < 0) xidx = 0;
 	else if (xidx > nx-1) xidx = nx-1;
 
@@ -881,15 +1348,10 @@ void CCourse::GetIndicesForPoint(double x, double z, unsigned int* x0, unsigned
 	}
 }
 
-void CCourse::FindBarycentricCoords(double x, double z, TVector2i *idx0,
-                                    TVector2i *idx1, TVector2i *idx2, double *u, double *v) const {
-	double xidx, yidx;
+static inline void GridTriangle(double xidx, double yidx, unsigned int nx, unsigned int ny,
+                                TVector2i *idx0, TVector2i *idx1, TVector2i *idx2, double *u, double *v) {
 	unsigned int x0, x1, y0, y1;
-	double dx, ex, dz, ez, qx, qz, invdet;
-
-	GetIndicesForPoint(x, z, &x0, &y0, &x1, &y1);
-	xidx = x / curr_course->size.x * ((double) nx - 1.0);
-	yidx = -z / curr_course->size.y * ((double) ny - 1.0);
+	GridCell(xidx, yidx, nx, ny, &x0, &y0, &x1, &y1);
 
 	if ((x0 + y0) % 2 == 0) {
 		if (yidx - y0 < xidx - x0) {
@@ -913,18 +1375,31 @@ void CCourse::FindBarycentricCoords(double x, double z, TVector2i *idx0,
 		}
 	}
 
-	dx = idx0->x - idx2->x;
-	dz = idx0->y - idx2->y;
-	ex = idx1->x - idx2->x;
-	ez = idx1->y - idx2->y;
-	qx = xidx - idx2->x;
-	qz = yidx - idx2->y;
+	double dx = idx0->x - idx2->x;
+	double dz = idx0->y - idx2->y;
+	double ex = idx1->x - idx2->x;
+	double ez = idx1->y - idx2->y;
+	double qx = xidx - idx2->x;
+	double qz = yidx - idx2->y;
 
-	invdet = 1 / (dx * ez - dz * ex);
+	double invdet = 1 / (dx * ez - dz * ex);
 	*u = (qx * ez - qz * ex) * invdet;
 	*v = (qz * dx - qx * dz) * invdet;
 }
 
+void CCourse::GetIndicesForPoint(double x, double z, unsigned int* x0, unsigned int* y0, unsigned int* x1, unsigned int* y1)  const {
+	double xidx = x / curr_course->size.x * ((double) nx - 1.);
+	double yidx = -z / curr_course->size.y * ((double) ny - 1.);
+	GridCell(xidx, yidx, nx, ny, x0, y0, x1, y1);
+}
+
+void CCourse::FindBarycentricCoords(double x, double z, TVector2i *idx0,
+                                    TVector2i *idx1, TVector2i *idx2, double *u, double *v) const {
+	double xidx = x / curr_course->size.x * ((double) nx - 1.0);
+	double yidx = -z / curr_course->size.y * ((double) ny - 1.0);
+	GridTriangle(xidx, yidx, nx, ny, idx0, idx1, idx2, u, v);
+}
+
 #define COURSE_VERTX(_x, _y) TVector3d ( (double)(_x)/(nx-1.)*curr_course->size.x, \
                        ELEV((_x),(_y)), -(double)(_y)/(ny-1.)*curr_course->size.y )
 
@@ -933,9 +1408,9 @@ TVector3d CCourse::FindCourseNormal(double x, double z) const {
 	double u, v;
 	FindBarycentricCoords(x, z, &idx0, &idx1, &idx2, &u, &v);
 
-	const TVector3d& n0 = Course.Fields[idx0.x + nx * idx0.y].nml;
-	const TVector3d& n1 = Course.Fields[idx1.x + nx * idx1.y].nml;
-	const TVector3d& n2 = Course.Fields[idx2.x + nx * idx2.y].nml;
+	TVector3d n0 = Fields.Normal(idx0.x + nx * idx0.y);
+	TVector3d n1 = Fields.Normal(idx1.x + nx * idx1.y);
+	TVector3d n2 = Fields.Normal(idx2.x + nx * idx2.y);
 
 	TVector3d p0 = COURSE_VERTX(idx0.x, idx0.y);
 	TVector3d p1 = COURSE_VERTX(idx1.x, idx1.y);
@@ -958,11 +1433,6 @@ TVector3d CCourse::FindCourseNormal(double x, double z) const {
 }
 
 double CCourse::FindYCoord(double x, double z) const {
-	static double last_x, last_z, last_y;
-	static bool cache_full = false;
-
-	if (cache_full && last_x == x && last_z == z) return last_y;
-
 	TVector2i idx0, idx1, idx2;
 	double u, v;
 	FindBarycentricCoords(x, z, &idx0, &idx1, &idx2, &u, &v);
@@ -971,27 +1441,148 @@ double CCourse::FindYCoord(double x, double z) const {
 	TVector3d p1 = COURSE_VERTX(idx1.x, idx1.y);
 	TVector3d p2 = COURSE_VERTX(idx2.x, idx2.y);
 
-	double ycoord = u * p0.y + v * p1.y + (1. - u - v) * p2.y;
+	return u * p0.y + v * p1.y + (1. - u - v) * p2.y;
+}
+
+// Points per block of FindYCoordBatch
+#define YCOORD_BLOCK 64
+
+// FindYCoord for many points at once, in float. The points are handled in
+// blocks of fixed size, so that the compiler vectorizes the loops over a
+// block: the first finds the cell and the triangle of each point, the last
+// interpolates. Both are free of branches; the triangle is chosen by
+// blending with 0/1 factors. Only the loads of the corner heights from the
+// elevation plane are scalar. The cells are split as in
+// FindBarycentricCoords, so the result differs from FindYCoord only by
+// float rounding.
+void CCourse::FindYCoordBatch(const float* xs, const float* zs, float* out, std::size_t n) const {
+	const float xscale = (nx - 1.f) / (float)curr_course->size.x;
+	const float yscale = -(ny - 1.f) / (float)curr_course->size.y;
+	const float xmax = nx - 1.f;
+	const float ymax = ny - 1.f;
+	const int xcell = nx - 2;
+	const int ycell = ny - 2;
+	const int stride = nx;
+	const float* elev = &Fields.elevation[0];
+
+	float xb[YCOORD_BLOCK], zb[YCOORD_BLOCK], yb[YCOORD_BLOCK];
+	float fx[YCOORD_BLOCK], fy[YCOORD_BLOCK];
+	float upper[YCOORD_BLOCK], odd_upper[YCOORD_BLOCK], diag[YCOORD_BLOCK];
+	float h00[YCOORD_BLOCK], h10[YCOORD_BLOCK], h01[YCOORD_BLOCK], h11[YCOORD_BLOCK];
+	int cell[YCOORD_BLOCK];
+
+	for (std::size_t start = 0; start < n; start += YCOORD_BLOCK) {
+		const std::size_t m = std::min<std::size_t>(YCOORD_BLOCK, n - start);
+		std::copy(xs + start, xs + start + m, xb);
+		std::copy(zs + start, zs + start + m, zb);
+		std::fill(xb + m, xb + YCOORD_BLOCK, 0.f);
+		std::fill(zb + m, zb + YCOORD_BLOCK, 0.f);
+
+		// The cell is clamped to the course, points on the far borders lie
+		// in the last one. Points off the course get the height of the
+		// plane of the nearest triangle, as in FindYCoord. Cells with an
+		// even x0 + y0 are split along the diagonal from (x0, y0) to
+		// (x1, y1), the others along the other diagonal.
+		for (std::size_t k = 0; k < YCOORD_BLOCK; k++) {
+			float xidx = xb[k] * xscale;
+			float yidx = zb[k] * yscale;
+			int x0 = std::min((int)std::min(std::max(xidx, 0.f), xmax), xcell);
+			int y0 = std::min((int)std::min(std::max(yidx, 0.f), ymax), ycell);
+			float u = xidx - x0;
+			float v = yidx - y0;
+			int odd = (x0 + y0) & 1;
+			int up = (odd & (u + v >= 1.f)) | ((odd ^ 1) & (v >= u));
+			fx[k] = u;
+			fy[k] = v;
+			upper[k] = (float)up;
+			odd_upper[k] = (float)(odd & up);
+			diag[k] = (float)(1 ^ odd ^ up);
+			cell[k] = x0 + stride * y0;
+		}
 
-	last_x = x;
-	last_z = z;
-	last_y = ycoord;
-	cache_full = true;
+		for (std::size_t k = 0; k < YCOORD_BLOCK; k++) {
+			const float* corner = elev + cell[k];
+			h00[k] = corner[0];
+			h10[k] = corner[1];
+			h01[k] = corner[stride];
+			h11[k] = corner[stride + 1];
+		}
 
-	return ycoord;
+		// the plane of the triangle is base + u * gx + v * gz
+		for (std::size_t k = 0; k < YCOORD_BLOCK; k++) {
+			float a = h00[k], b = h10[k], c = h01[k], d = h11[k];
+			float base = a + odd_upper[k] * (b + c - d - a);
+			float gx = (b - a) + upper[k] * ((d - c) - (b - a));
+			float gz = (c - a) + diag[k] * ((d - b) - (c - a));
+			yb[k] = base + fx[k] * gx + fy[k] * gz;
+		}
+		std::copy(yb, yb + m, out + start);
+	}
 }
 
-void CCourse::GetSurfaceType(double x, double z, double weights[]) const {
+TSurfaceSample CCourse::SampleSurface(double x, double z) const {
 	TVector2i idx0, idx1, idx2;
 	double u, v;
 	FindBarycentricCoords(x, z, &idx0, &idx1, &idx2, &u, &v);
+	double w = 1. - u - v;
+
+	std::size_t i0 = idx0.x + nx * idx0.y;
+	std::size_t i1 = idx1.x + nx * idx1.y;
+	std::size_t i2 = idx2.x + nx * idx2.y;
+
+	TVector3d p0 = COURSE_VERTX(idx0.x, idx0.y);
+	TVector3d p1 = COURSE_VERTX(idx1.x, idx1.y);
+	TVector3d p2 = COURSE_VERTX(idx2.x, idx2.y);
+
+	TSurfaceSample sample;
+	sample.elevation = u * p0.y + v * p1.y + w * p2.y;
 
-	for (std::size_t i=0; i<Course.TerrList.size(); i++) {
-		weights[i] = 0;
-		if (Course.Fields[idx0.x + nx*idx0.y].terrain == i) weights[i] += u;
-		if (Course.Fields[idx1.x + nx*idx1.y].terrain == i) weights[i] += v;
-		if (Course.Fields[idx2.x + nx*idx2.y].terrain == i) weights[i] += 1.0 - u - v;
+	// same interpolation as FindCourseNormal
+	TVector3d smooth_nml = u * Fields.Normal(i0) + v * Fields.Normal(i1) + w * Fields.Normal(i2);
+	TVector3d tri_nml = CrossProduct(p1 - p0, p2 - p0);
+	tri_nml.Norm();
+	double min_bary = std::min(u, std::min(v, w));
+	double interp_factor = std::min(min_bary / NORM_INTERPOL, 1.0);
+	sample.normal = interp_factor * tri_nml + (1.-interp_factor) * smooth_nml;
+	sample.normal.Norm();
+
+	sample.terrain[0] = Fields.terrain[i0];
+	sample.terrain[1] = Fields.terrain[i1];
+	sample.terrain[2] = Fields.terrain[i2];
+	sample.weight[0] = u;
+	sample.weight[1] = v;
+	sample.weight[2] = w;
+	// summed per corner, not per terrain type like the old GetSurfaceType,
+	// so the values can differ in the last bits
+	sample.friction = sample.depth = 0.0;
+	for (int i = 0; i < 3; i++) {
+		const TTerrType& terr = TerrList[sample.terrain[i]];
+		sample.friction += sample.weight[i] * terr.friction;
+		sample.depth += sample.weight[i] * terr.depth;
+	}
+	return sample;
+}
+
+int TSurfaceSample::TerrainIdx(double level) const {
+	// like CCourse::GetTerrainIdx: the lowest terrain index whose summed
+	// weight exceeds the level
+	int idx = -1;
+	for (int i = 0; i < 3; i++) {
+		double wheight = 0.0;
+		for (int j = 0; j < 3; j++) {
+			if (terrain[j] == terrain[i]) wheight += weight[j];
+		}
+		if (wheight > level && (idx < 0 || terrain[i] < idx))
+			idx = terrain[i];
 	}
+	return idx;
+}
+
+TPlane TSurfaceSample::Plane(double x, double z) const {
+	TPlane plane;
+	plane.nml = normal;
+	plane.d = -DotProduct(plane.nml, TVector3d(x, elevation, z));
+	return plane;
 }
 
 int CCourse::GetTerrainIdx(double x, double z, double level) const {
@@ -999,20 +1590,16 @@ int CCourse::GetTerrainIdx(double x, double z, double level) const {
 	double u, v;
 	FindBarycentricCoords(x, z, &idx0, &idx1, &idx2, &u, &v);
 
-	for (std::size_t i=0; i<Course.TerrList.size(); i++) {
+	for (std::size_t i=0; i<TerrList.size(); i++) {
 		double wheight = 0.0;
-		if (Course.Fields[idx0.x + nx*idx0.y].terrain == i) wheight += u;
-		if (Course.Fields[idx1.x + nx*idx1.y].terrain == i) wheight += v;
-		if (Course.Fields[idx2.x + nx*idx2.y].terrain == i) wheight += 1.0 - u - v;
+		if (Fields.terrain[idx0.x + nx*idx0.y] == i) wheight += u;
+		if (Fields.terrain[idx1.x + nx*idx1.y] == i) wheight += v;
+		if (Fields.terrain[idx2.x + nx*idx2.y] == i) wheight += 1.0 - u - v;
 		if (wheight > level) return (int)i;
 	}
 	return -1;
 }
 
 TPlane CCourse::GetLocalCoursePlane(TVector3d pt) const {
-	TPlane plane;
-	pt.y = FindYCoord(pt.x, pt.z);
-	plane.nml = FindCourseNormal(pt.x, pt.z);
-	plane.d = -DotProduct(plane.nml, pt);
-	return plane;
+	return SampleSurface(pt.x, pt.z).Plane(pt.x, pt.z);
 }
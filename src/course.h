@@ -21,12 +21,13 @@ GNU General Public License for more details.
 #include "bh.h"
 #include "mathlib.h"
 #include <vector>
+#include <atomic>
 #include <unordered_map>
+#include <algorithm>
+#include <cmath>
 
-#define FLOATVAL(i) (*(GLfloat*)(vnc_array+idx+(i)*sizeof(GLfloat)))
-#define BYTEVAL(i) (*(GLubyte*)(vnc_array+idx+8*sizeof(GLfloat) + i*sizeof(GLubyte)))
-#define STRIDE_GL_ARRAY (8 * sizeof(GLfloat) + 4 * sizeof(GLubyte))
-#define ELEV(x,y) (Fields[(x) + nx*(y)].elevation)
+#define STRIDE_GL_ARRAY (6 * sizeof(GLfloat))
+#define ELEV(x,y) (Fields.elevation[(x) + nx*(y)])
 #define NORM_INTERPOL 0.05
 #define XCD(_x) ((double)(_x) / (nx-1.0) * curr_course->size.x)
 #define ZCD(_y) (-(double)(_y) / (ny-1.0) * curr_course->size.y)
@@ -113,10 +114,44 @@ struct TCourse {
 	void SetTranslatedData(const std::string& line2);
 };
 
+// The course grid, one plane per attribute. The normals are octahedron
+// encoded into two 16 bit values, which is what the course cache stores.
+// The physics reads the normals many times per step, so they are also
+// kept decoded as floats; a cell takes 21 bytes.
 struct CourseFields {
-	TVector3d nml;
+	std::vector<float> elevation;
+	std::vector<float> normals;		// x, y, z per cell
+	std::vector<uint8_t> terrain;
+
+	void resize(std::size_t n);
+	void clear();
+	std::size_t size() const { return terrain.size(); }
+	std::size_t Bytes() const;
+
+	TVector3d Normal(std::size_t i) const {
+		return TVector3d(normals[3*i], normals[3*i+1], normals[3*i+2]);
+	}
+	void SetNormal(std::size_t i, const TVector3d& n);
+	void MirrorNormal(std::size_t i);
+	void SwapNormals(std::size_t i, std::size_t j);
+	// the normals as the course cache stores them, 32 bits each
+	void PackNormals(std::vector<uint32_t>& packed) const;
+	void UnpackNormals(const std::vector<uint32_t>& packed);
+};
+
+// Result of CCourse::SampleSurface: everything physics and effects need
+// to know about the course surface at one point. The terrain weights are
+// the barycentric weights of the three corners of the triangle.
+struct TSurfaceSample {
 	double elevation;
-	uint8_t terrain;
+	TVector3d normal;
+	double friction;
+	double depth;
+	uint8_t terrain[3];
+	double weight[3];
+
+	int TerrainIdx(double level) const;
+	TPlane Plane(double x, double z) const;
 };
 
 class CCourseList {
@@ -125,7 +160,7 @@ class CCourseList {
 public:
 	std::string name;
 
-	bool Load(const std::string& dir);
+	bool Load(const std::string& dir, bool previews);
 	void Free();
 	TCourse& operator[](std::size_t idx) { return courses[idx]; }
 	const TCourse& operator[](std::size_t idx) const { return courses[idx]; }
@@ -134,6 +169,119 @@ public:
 	std::size_t size() const { return courses.size(); }
 };
 
+// --------------------------------------------------------------------
+//					spatial index of the course objects
+// --------------------------------------------------------------------
+// Uniform grid over the course area. Each cell holds the indices of the
+// objects whose center lies in it. Queries are widened by the largest
+// object radius, so callers only have to test the returned candidates.
+// Objects can be removed from the index (e.g. collected herrings); the
+// removed index is swapped behind the active part of its cell.
+
+class CObjectGrid {
+	double cellsize;
+	double maxradius;
+	unsigned int cols;
+	unsigned int rows;
+	std::vector<uint32_t> cellstart;	// cols*rows+1 offsets into indices
+	std::vector<uint32_t> cellcount;	// active indices per cell
+	std::vector<uint32_t> indices;
+
+	unsigned int Col(double x) const {
+		int c = (int)std::floor(x / cellsize);
+		return (unsigned int)std::max(0, std::min<int>(c, cols - 1));
+	}
+	unsigned int Row(double z) const {
+		int r = (int)std::floor(-z / cellsize);
+		return (unsigned int)std::max(0, std::min<int>(r, rows - 1));
+	}
+public:
+	CObjectGrid() : cellsize(10.0), maxradius(0.0), cols(0), rows(0) {}
+
+	// indexes the objects for which use(object) returns true
+	template<typename T, typename P>
+	void Build(const std::vector<T>& objects, const TVector2d& size, P use);
+	template<typename T>
+	void Build(const std::vector<T>& objects, const TVector2d& size) {
+		Build(objects, size, [](const T&) { return true; });
+	}
+	void Clear() { cols = rows = 0; cellstart.clear(); cellcount.clear(); indices.clear(); }
+	void Remove(uint32_t index, const TVector3d& pt);
+
+	// call func(index) for all objects that may overlap the circle or rectangle
+	template<typename F>
+	void Query(double x, double z, double radius, F func) const {
+		QueryRect(x - radius, z - radius, x + radius, z + radius, func);
+	}
+	template<typename F>
+	void QueryRect(double x0, double z0, double x1, double z1, F func) const;
+};
+
+template<typename T, typename P>
+void CObjectGrid::Build(const std::vector<T>& objects, const TVector2d& size, P use) {
+	cols = std::max(1, (int)std::ceil(size.x / cellsize));
+	rows = std::max(1, (int)std::ceil(size.y / cellsize));
+	maxradius = 0.0;
+	cellstart.assign(cols * rows + 1, 0);
+	cellcount.assign(cols * rows, 0);
+	for (std::size_t i = 0; i < objects.size(); i++) {
+		if (!use(objects[i])) continue;
+		cellcount[Col(objects[i].pt.x) + cols * Row(objects[i].pt.z)]++;
+		maxradius = std::max(maxradius, objects[i].diam / 2.0);
+	}
+	for (std::size_t c = 0; c < cellcount.size(); c++)
+		cellstart[c + 1] = cellstart[c] + cellcount[c];
+
+	indices.resize(cellstart.back());
+	std::vector<uint32_t> fill(cellstart.begin(), cellstart.end() - 1);
+	for (std::size_t i = 0; i < objects.size(); i++) {
+		if (use(objects[i]))
+			indices[fill[Col(objects[i].pt.x) + cols * Row(objects[i].pt.z)]++] = (uint32_t)i;
+	}
+}
+
+inline void CObjectGrid::Remove(uint32_t index, const TVector3d& pt) {
+	if (indices.empty())
+		return;
+	unsigned int cell = Col(pt.x) + cols * Row(pt.z);
+	uint32_t* first = &indices[0] + cellstart[cell];
+	uint32_t* last = first + cellcount[cell];
+	uint32_t* it = std::find(first, last, index);
+	if (it != last) {
+		std::swap(*it, *(last - 1));
+		cellcount[cell]--;
+	}
+}
+
+template<typename F>
+void CObjectGrid::QueryRect(double x0, double z0, double x1, double z1, F func) const {
+	if (indices.empty())
+		return;
+	unsigned int c0 = Col(x0 - maxradius), c1 = Col(x1 + maxradius);
+	unsigned int r0 = Row(z1 + maxradius), r1 = Row(z0 - maxradius);
+	for (unsigned int r = r0; r <= r1; r++) {
+		for (unsigned int c = c0; c <= c1; c++) {
+			unsigned int cell = c + cols * r;
+			const uint32_t* it = &indices[0] + cellstart[cell];
+			const uint32_t* last = it + cellcount[cell];
+			for (; it != last; ++it)
+				func(*it);
+		}
+	}
+}
+
+// Finds the first of up to 64 colour classes a pixel belongs to in
+// constant time. A class is given by a range of values per channel; bit i
+// of chan[c][v] is set if value v of channel c lies in the range of
+// class i, so the classes of a pixel are the AND of three table entries.
+struct TColorLookup {
+	uint64_t chan[3][256];
+
+	void Clear();
+	void AddRange(std::size_t entry, int channel, int min, int max);
+	int Find(const unsigned char* pixel) const;	// -1 if none matches
+};
+
 class CCourse {
 private:
 	const TCourse* curr_course;
@@ -143,22 +291,47 @@ private:
 	unsigned int nx;
 	unsigned int ny;
 	TVector2d	start_pt;
+	TColorLookup TerrLookup;
+	TColorLookup ObjLookup;
 	int			base_height_value;
+	int			tree_size;		// see SetTreeSize
+	int			tree_var;
 	bool		mirrored;
-
+	const bool	headless;		// see the constructor
+	GLuint		vn_buffer;			// positions and normals in a buffer object
+	bool		vn_buffer_valid;
+	std::vector<GLfloat> vn_array;	// client side copy, only built without buffer objects
+	std::vector<GLubyte> col_array;
+	std::atomic<int>	prepare_step;		// progress of PrepareCourse
+	static const int	PREPARE_STEPS = 4;
+
+	void		RequestTerrainTexture(std::size_t idx);
+	void		RequestObjectTexture(std::size_t type);
 	void		FreeTerrainTextures();
 	void		FreeObjectTextures();
 	void		CalcNormals();
+	void		CalcNormalRows(unsigned int y0, unsigned int y1, const std::vector<double>& xcd);
 	void		MakeCourseNormals();
 	bool		LoadElevMap();
 	void		LoadItemList();
-	bool		LoadAndConvertObjectMap();
-	bool		LoadTerrainMap();
+	bool		LoadCourseMaps(bool convert_objects);
+	void		ConvertObjectMap(const std::vector<int8_t>& objects);
 	int			GetTerrain(const unsigned char* pixel) const;
+	void		BuildObjectGrids();
+
+	std::string	CacheFile() const;
+	bool		CacheUpToDate() const;
+	void		FillVertexArray(GLfloat* out) const;
+	bool		LoadCourseCache();
+	void		SaveCourseCache() const;
+	bool		ForceTreemap() const;
 
 	void		MirrorCourseData();
 public:
-	CCourse();
+	// A headless course has no textures, leaves the quadtree, the tree
+	// geometry and the track marks alone and doesn't write to the course
+	// directory. Several of them can be loaded and used on different threads.
+	explicit CCourse(bool headless = false);
 	~CCourse();
 
 	std::unordered_map<std::string, CCourseList> CourseLists;
@@ -168,9 +341,11 @@ public:
 	std::vector<TCollidable>	CollArr;
 	std::vector<TItem>			NocollArr;
 	std::vector<TPolyhedron>	PolyArr;
+	CObjectGrid					CollGrid;
+	CObjectGrid					ItemGrid;		// drawable items not yet collected
+	CObjectGrid					CollectGrid;	// items which can still be collected
 
-	std::vector<CourseFields>	Fields;
-	GLubyte *vnc_array;
+	CourseFields				Fields;
 
 	CCourseList* getGroup(std::size_t index);
 
@@ -178,30 +353,47 @@ public:
 	TCourse* GetCourse(const std::string& group, const std::string& dir);
 	std::size_t GetCourseIdx(const TCourse* course) const;
 	void FreeCourseList();
-	bool LoadCourseList();
+	bool LoadCourseList(bool previews = true);
 	bool LoadCourse(TCourse* course);
+	bool BeginLoadCourse(TCourse* course);
+	bool PrepareCourse();
+	void FinishLoadCourse(bool prepared);
+	float PrepareProgress() const;
 	bool LoadTerrainTypes();
 	bool LoadObjectTypes();
 	void MakeStandardPolyhedrons();
-	GLubyte* GetGLArrays() const { return vnc_array; }
+	GLubyte* GetColorArray() { return col_array.data(); }
+	const GLfloat* GetVertexArray();
 	void FillGlArrays();
+	bool BindGLBuffer();
 
 	const TVector2d& GetDimensions() const { return curr_course->size; }
+	void GetDivisions(int *x, int *y) const { *x = nx; *y = ny; }
 	const TVector2d& GetPlayDimensions() const { return curr_course->play_size; }
 	double GetCourseAngle() const { return curr_course->angle; }
+	bool UseKeyframe() const { return curr_course->use_keyframe; }
+	double GetFinishBrake() const { return curr_course->finish_brake; }
 	double GetBaseHeight(double distance) const;
 	double GetMaxHeight(double distance) const;
 	std::size_t GetEnv() const;
 	const TVector2d& GetStartPoint() const { return start_pt; }
 	const TPolyhedron& GetPoly(std::size_t type) const;
 	void MirrorCourse();
+	void SetMirrored(bool mirror);
+	// The size and variation (1 to 5) of the trees made from trees.png.
+	// The course of the game takes them from g_game when it's loaded.
+	void SetTreeSize(int size, int var);
+	void UpdateMirror();
+	void ResetItems();
+	void CollectItem(std::size_t idx);
 
 	void GetIndicesForPoint(double x, double z, unsigned int* x0, unsigned int* y0, unsigned int* x1, unsigned int* y1) const;
 	void FindBarycentricCoords(double x, double z,
 	                           TVector2i *idx0, TVector2i *idx1, TVector2i *idx2, double *u, double *v) const;
 	TVector3d FindCourseNormal(double x, double z) const;
 	double FindYCoord(double x, double z) const;
-	void GetSurfaceType(double x, double z, double weights[]) const;
+	void FindYCoordBatch(const float* xs, const float* zs, float* out, std::size_t n) const;
+	TSurfaceSample SampleSurface(double x, double z) const;
 	int GetTerrainIdx(double x, double z, double level) const;
 	TPlane GetLocalCoursePlane(TVector3d pt) const;
 };
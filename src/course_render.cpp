@@ -28,6 +28,8 @@ GNU General Public License for more details.
 #include "env.h"
 #include "game_ctrl.h"
 #include "physics.h"
+#include "view.h"
+#include <algorithm>
 
 #define TEX_SCALE 6
 static const bool clip_course = true;
@@ -45,12 +47,270 @@ void RenderCourse() {
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 	set_material(colWhite, colBlack, 1.0);
 	const CControl *ctrl = g_game.player->ctrl;
-	UpdateQuadtree(ctrl->viewpos, param.course_detail_level);
+	UpdateQuadtree(ctrl->viewpos, param.course_detail_level, param.course_update_budget);
 	RenderQuadtree();
 }
 
+// Appends a textured quad to a batch of interleaved x, y, z, s, t floats
+static void AddTreeQuad(std::vector<GLfloat>& batch, const TVector3d& base,
+                        double dx, double dz, double height) {
+	const GLfloat quad[20] = {
+		GLfloat(base.x - dx), GLfloat(base.y),          GLfloat(base.z - dz), 0, 1,
+		GLfloat(base.x + dx), GLfloat(base.y),          GLfloat(base.z + dz), 1, 1,
+		GLfloat(base.x + dx), GLfloat(base.y + height), GLfloat(base.z + dz), 1, 0,
+		GLfloat(base.x - dx), GLfloat(base.y + height), GLfloat(base.z - dz), 0, 0
+	};
+	batch.insert(batch.end(), quad, quad + 20);
+}
+
+static void DrawTreeBatch(const std::vector<GLfloat>& batch) {
+	glVertexPointer(3, GL_FLOAT, 5 * sizeof(GLfloat), &batch[0]);
+	glTexCoordPointer(2, GL_FLOAT, 5 * sizeof(GLfloat), &batch[3]);
+	glDrawArrays(GL_QUADS, 0, (GLsizei)(batch.size() / 5));
+}
+
+// --------------------------------------------------------------------
+//					static tree geometry
+// --------------------------------------------------------------------
+
+// The crossed quads of the detailed trees never change during a race, so
+// they are built once per course and kept in one vertex buffer per tree
+// type. The trees of a type are sorted by z and split into slabs of
+// TREE_CHUNK_LENGTH, which can be culled and drawn as contiguous ranges.
+
+#define TREE_CHUNK_LENGTH 25.0
+
+struct TTreeChunk {
+	GLint first;			// first vertex of the chunk in the buffer
+	GLsizei count;
+	std::size_t first_tree;	// range in TTreeGeometry::trees
+	std::size_t num_trees;
+	TVector3d bbmin;
+	TVector3d bbmax;
+};
+
+struct TTreeGeometry {
+	std::vector<uint32_t> trees;	// indices into CollArr, sorted by z
+	std::vector<TTreeChunk> chunks;
+	std::vector<GLfloat> vertices;	// until they are in the buffer object
+	GLuint buffer;
+};
+
+static std::vector<TTreeGeometry> tree_geometry;
+static bool tree_geometry_valid = false;
+static const CCourse* tree_geometry_course = nullptr;
+static int tree_geometry_perf_level = -1;
+
+void ResetTreeGeometry() {
+	tree_geometry_valid = false;
+}
+
+static void FreeTreeGeometry() {
+	for (std::size_t t = 0; t < tree_geometry.size(); t++) {
+		if (tree_geometry[t].buffer != 0)
+			glDeleteBuffers_p(1, &tree_geometry[t].buffer);
+	}
+	tree_geometry.clear();
+}
+
+// Sorts the trees of each type into chunks and builds their vertices. This
+// needs no OpenGL context, the vertices are moved into buffer objects by
+// UploadTreeGeometry when the trees are drawn.
+static void BuildTreeGeometry(const CCourse& course) {
+	FreeTreeGeometry();
+	tree_geometry.resize(course.ObjTypes.size());
+	for (std::size_t t = 0; t < tree_geometry.size(); t++)
+		tree_geometry[t].buffer = 0;
+
+	const std::vector<TCollidable>& trees = course.CollArr;
+	for (std::size_t i = 0; i < trees.size(); i++)
+		tree_geometry[trees[i].tree_type].trees.push_back((uint32_t)i);
+
+	// a slight turn of the crossed quads, as before
+	double rot_cos = 1.0, rot_sin = 0.0;
+	if (param.perf_level > 1) {
+		rot_cos = std::cos(ANGLES_TO_RADIANS(1.0));
+		rot_sin = std::sin(ANGLES_TO_RADIANS(1.0));
+	}
+
+	for (std::size_t t = 0; t < tree_geometry.size(); t++) {
+		TTreeGeometry& geom = tree_geometry[t];
+		if (geom.trees.empty()) continue;
+		std::stable_sort(geom.trees.begin(), geom.trees.end(), [&](uint32_t a, uint32_t b) {
+			return trees[a].pt.z > trees[b].pt.z;
+		});
+
+		geom.vertices.reserve(geom.trees.size() * 8 * 5);
+		int slab = 0;
+		for (std::size_t n = 0; n < geom.trees.size(); n++) {
+			const TCollidable& tree = trees[geom.trees[n]];
+			double treeRadius = tree.diam / 2.0;
+			double treeHeight = tree.height;
+			TVector3d bbmin(tree.pt.x - treeRadius, tree.pt.y, tree.pt.z - treeRadius);
+			TVector3d bbmax(tree.pt.x + treeRadius, tree.pt.y + treeHeight, tree.pt.z + treeRadius);
+
+			int tree_slab = (int)std::floor(-tree.pt.z / TREE_CHUNK_LENGTH);
+			if (geom.chunks.empty() || tree_slab != slab) {
+				slab = tree_slab;
+				TTreeChunk chunk;
+				chunk.first = (GLint)(geom.vertices.size() / 5);
+				chunk.count = 0;
+				chunk.first_tree = n;
+				chunk.num_trees = 0;
+				chunk.bbmin = bbmin;
+				chunk.bbmax = bbmax;
+				geom.chunks.push_back(chunk);
+			}
+			TTreeChunk& chunk = geom.chunks.back();
+			chunk.count += 8;
+			chunk.num_trees++;
+			chunk.bbmin.x = std::min(chunk.bbmin.x, bbmin.x);
+			chunk.bbmin.y = std::min(chunk.bbmin.y, bbmin.y);
+			chunk.bbmin.z = std::min(chunk.bbmin.z, bbmin.z);
+			chunk.bbmax.x = std::max(chunk.bbmax.x, bbmax.x);
+			chunk.bbmax.y = std::max(chunk.bbmax.y, bbmax.y);
+			chunk.bbmax.z = std::max(chunk.bbmax.z, bbmax.z);
+
+			AddTreeQuad(geom.vertices, tree.pt, treeRadius * rot_cos, -treeRadius * rot_sin, treeHeight);
+			AddTreeQuad(geom.vertices, tree.pt, treeRadius * rot_sin, treeRadius * rot_cos, treeHeight);
+		}
+
+	}
+
+	tree_geometry_valid = true;
+	tree_geometry_course = &course;
+	tree_geometry_perf_level = param.perf_level;
+}
+
+static void UploadTreeGeometry() {
+	if (!HaveBufferObjects())
+		return;
+	bool uploaded = false;
+	for (std::size_t t = 0; t < tree_geometry.size(); t++) {
+		TTreeGeometry& geom = tree_geometry[t];
+		if (geom.buffer != 0 || geom.vertices.empty()) continue;
+		glGenBuffers_p(1, &geom.buffer);
+		glBindBuffer_p(GL_ARRAY_BUFFER, geom.buffer);
+		glBufferData_p(GL_ARRAY_BUFFER, geom.vertices.size() * sizeof(GLfloat),
+		               &geom.vertices[0], GL_STATIC_DRAW);
+		std::vector<GLfloat>().swap(geom.vertices);
+		uploaded = true;
+	}
+	if (uploaded)
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
+}
+
+// Draws the vertex range [first, first + count) of the bound static geometry
+static void DrawTreeRange(GLint first, GLsizei count) {
+	if (count > 0)
+		glDrawArrays(GL_QUADS, first, count);
+}
+
+static void BindTreeGeometry(const TTreeGeometry& geom) {
+	if (geom.buffer != 0) {
+		glBindBuffer_p(GL_ARRAY_BUFFER, geom.buffer);
+		glVertexPointer(3, GL_FLOAT, 5 * sizeof(GLfloat), (const GLvoid*)0);
+		glTexCoordPointer(2, GL_FLOAT, 5 * sizeof(GLfloat), (const GLvoid*)(3 * sizeof(GLfloat)));
+	} else {
+		glVertexPointer(3, GL_FLOAT, 5 * sizeof(GLfloat), &geom.vertices[0]);
+		glTexCoordPointer(2, GL_FLOAT, 5 * sizeof(GLfloat), &geom.vertices[3]);
+	}
+}
+
+// Squared horizontal distance between a point and a box
+static double BoxDistanceSq(const TVector3d& pt, const TVector3d& bbmin, const TVector3d& bbmax) {
+	double dx = std::max(0.0, std::max(bbmin.x - pt.x, pt.x - bbmax.x));
+	double dz = std::max(0.0, std::max(bbmin.z - pt.z, pt.z - bbmax.z));
+	return dx * dx + dz * dz;
+}
+
+// Appends an item quad to a batch of interleaved x, y, z, nx, ny, nz, s, t floats
+static void AddItemQuad(std::vector<GLfloat>& batch, const TVector3d& base,
+                        const TVector3d& normal, double dx, double dz, double height) {
+	const GLfloat nx = (GLfloat)normal.x;
+	const GLfloat ny = (GLfloat)normal.y;
+	const GLfloat nz = (GLfloat)normal.z;
+	const GLfloat quad[32] = {
+		GLfloat(base.x - dx), GLfloat(base.y),          GLfloat(base.z - dz), nx, ny, nz, 0, 1,
+		GLfloat(base.x + dx), GLfloat(base.y),          GLfloat(base.z + dz), nx, ny, nz, 1, 1,
+		GLfloat(base.x + dx), GLfloat(base.y + height), GLfloat(base.z + dz), nx, ny, nz, 1, 0,
+		GLfloat(base.x - dx), GLfloat(base.y + height), GLfloat(base.z - dz), nx, ny, nz, 0, 0
+	};
+	batch.insert(batch.end(), quad, quad + 32);
+}
+
+// Appends a range of the static geometry, merging it with the last one
+// if they are adjacent
+static void AddTreeRange(std::vector<TTreeRange>& ranges, GLint first, GLsizei count) {
+	if (!ranges.empty() && ranges.back().first + ranges.back().count == first)
+		ranges.back().count += count;
+	else
+		ranges.push_back(TTreeRange{first, count});
+}
+
+void SelectTrees(const CCourse& course, const CControl* ctrl, std::vector<TTreeDrawList>& lists) {
+	if (!tree_geometry_valid || tree_geometry_course != &course ||
+	        tree_geometry_perf_level != param.perf_level)
+		BuildTreeGeometry(course);
+
+	lists.resize(tree_geometry.size());
+	for (std::size_t t = 0; t < lists.size(); t++) {
+		lists[t].ranges.clear();
+		lists[t].billboards.clear();
+	}
+
+	const TVector2d& dim = course.GetDimensions();
+	double zmin = -dim.y;
+	double zmax = 0.0;
+	if (clip_course) {
+		zmin = ctrl->viewpos.z - param.forward_clip_distance;
+		zmax = ctrl->viewpos.z + param.backward_clip_distance;
+	}
+
+	TVector3d right(ctrl->view_mat[0][0], 0.0, ctrl->view_mat[0][2]);
+	if (right.Norm() == 0.0)
+		right = TVector3d(1.0, 0.0, 0.0);
+	double detail_dist_sq = (double)param.tree_detail_distance * param.tree_detail_distance;
+
+	for (std::size_t t = 0; t < tree_geometry.size(); t++) {
+		const TTreeGeometry& geom = tree_geometry[t];
+		TTreeDrawList& list = lists[t];
+
+		for (std::size_t c = 0; c < geom.chunks.size(); c++) {
+			const TTreeChunk& chunk = geom.chunks[c];
+			if (chunk.bbmax.z < zmin || chunk.bbmin.z > zmax)
+				continue;
+			clip_result_t clip = clip_aabb_to_view_frustum(chunk.bbmin, chunk.bbmax);
+			if (clip == NotVisible)
+				continue;
+			bool detailed = BoxDistanceSq(ctrl->viewpos, chunk.bbmin, chunk.bbmax) <= detail_dist_sq;
+
+			// a chunk which lies completely in view is drawn as a whole
+			if (detailed && clip == NoClip && chunk.bbmin.z >= zmin && chunk.bbmax.z <= zmax) {
+				AddTreeRange(list.ranges, chunk.first, chunk.count);
+				continue;
+			}
+
+			for (std::size_t n = 0; n < chunk.num_trees; n++) {
+				const TCollidable& tree = course.CollArr[geom.trees[chunk.first_tree + n]];
+				if (tree.pt.z < zmin || tree.pt.z > zmax) continue;
+
+				double treeRadius = tree.diam / 2.0;
+				double treeHeight = tree.height;
+				TVector3d bbmin(tree.pt.x - treeRadius, tree.pt.y, tree.pt.z - treeRadius);
+				TVector3d bbmax(tree.pt.x + treeRadius, tree.pt.y + treeHeight, tree.pt.z + treeRadius);
+				if (clip_aabb_to_view_frustum(bbmin, bbmax) == NotVisible) continue;
+
+				if (detailed)
+					AddTreeRange(list.ranges, chunk.first + (GLint)(8 * n), 8);
+				else
+					AddTreeQuad(list.billboards, tree.pt, treeRadius * right.x, treeRadius * right.z, treeHeight);
+			}
+		}
+	}
+}
+
 void DrawTrees() {
-	std::size_t tree_type = -1;
 	const CControl*	ctrl = g_game.player->ctrl;
 
 	ScopedRenderMode rm(TREES);
@@ -61,122 +321,79 @@ void DrawTrees() {
 	set_material(colWhite, colBlack, 1.0);
 
 	// Trees
-	for (std::size_t i = 0; i< Course.CollArr.size(); i++) {
-		if (clip_course) {
-			if (ctrl->viewpos.z - Course.CollArr[i].pt.z > fwd_clip_limit) continue;
-			if (Course.CollArr[i].pt.z - ctrl->viewpos.z > bwd_clip_limit) continue;
-		}
+	// The detailed trees are drawn from the static geometry, the others
+	// as single quads facing the camera, collected into one batch per type.
+	static std::vector<TTreeDrawList> tree_lists;
+	SelectTrees(Course, ctrl, tree_lists);
+	UploadTreeGeometry();
 
-		if (Course.CollArr[i].tree_type != tree_type) {
-			tree_type = Course.CollArr[i].tree_type;
-			Course.ObjTypes[tree_type].texture->Bind();
-		}
+	glNormal3i(0, 0, 1);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	for (std::size_t t = 0; t < tree_lists.size(); t++) {
+		const std::vector<TTreeRange>& ranges = tree_lists[t].ranges;
+		if (ranges.empty()) continue;
+		Course.ObjTypes[t].texture->Bind();
+		BindTreeGeometry(tree_geometry[t]);
+		for (std::size_t r = 0; r < ranges.size(); r++)
+			DrawTreeRange(ranges[r].first, ranges[r].count);
+	}
+	if (HaveBufferObjects())
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
 
-		glPushMatrix();
-		glTranslate(Course.CollArr[i].pt);
-		if (param.perf_level > 1) glRotatef(1, 0, 1, 0);
-
-		float treeRadius = Course.CollArr[i].diam / 2.0;
-		float treeHeight = Course.CollArr[i].height;
-		glNormal3i(0, 0, 1);
-
-		static const GLshort tex[] = {
-			0, 1,
-			1, 1,
-			1, 0,
-			0, 0,
-			0, 1,
-			1, 1,
-			1, 0,
-			0, 0
-		};
-
-		const GLfloat vtx[] = {
-			-treeRadius, 0.0,        0.0,
-			    treeRadius,  0.0,        0.0,
-			    treeRadius,  treeHeight, 0.0,
-			    -treeRadius, treeHeight, 0.0,
-			    0.0,         0.0,        -treeRadius,
-			    0.0,         0.0,        treeRadius,
-			    0.0,         treeHeight, treeRadius,
-			    0.0,         treeHeight, -treeRadius
-		    };
-
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-		glVertexPointer(3, GL_FLOAT, 0, vtx);
-		glTexCoordPointer(2, GL_SHORT, 0, tex);
-		glDrawArrays(GL_QUADS, 0, 8);
-
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
-
-		glPopMatrix();
+	for (std::size_t t = 0; t < tree_lists.size(); t++) {
+		if (tree_lists[t].billboards.empty()) continue;
+		Course.ObjTypes[t].texture->Bind();
+		DrawTreeBatch(tree_lists[t].billboards);
 	}
 
-	// Items
-	const TObjectType* item_type = nullptr;
+	const TVector2d& dim = Course.GetDimensions();
+	double zmin = -dim.y;
+	double zmax = 0.0;
+	if (clip_course) {
+		zmin = ctrl->viewpos.z - fwd_clip_limit;
+		zmax = ctrl->viewpos.z + bwd_clip_limit;
+	}
 
-	for (std::size_t i = 0; i< Course.NocollArr.size(); i++) {
-		if (Course.NocollArr[i].collectable == 0 || Course.NocollArr[i].type.drawable == false) continue;
-		if (clip_course) {
-			if (ctrl->viewpos.z - Course.NocollArr[i].pt.z > fwd_clip_limit) continue;
-			if (Course.NocollArr[i].pt.z - ctrl->viewpos.z > bwd_clip_limit) continue;
-		}
+	// Items
+	// the item index only holds drawable items which are not collected yet
+	static std::vector<std::vector<GLfloat> > item_batches;
+	item_batches.resize(Course.ObjTypes.size());
+	for (std::size_t t = 0; t < item_batches.size(); t++)
+		item_batches[t].clear();
 
-		if (&Course.NocollArr[i].type != item_type) {
-			item_type = &Course.NocollArr[i].type;
-			item_type->texture->Bind();
-		}
+	Course.ItemGrid.QueryRect(0.0, zmin, dim.x, zmax, [&](uint32_t i) {
+		const TItem& item = Course.NocollArr[i];
+		if (item.pt.z < zmin || item.pt.z > zmax) return;
 
-		glPushMatrix();
-		glTranslate(Course.NocollArr[i].pt);
-		double itemRadius = Course.NocollArr[i].diam / 2;
-		double itemHeight = Course.NocollArr[i].height;
+		double itemRadius = item.diam / 2;
+		double itemHeight = item.height;
 
 		TVector3d normal;
-		if (item_type->use_normal) {
-			normal = item_type->normal;
+		if (item.type.use_normal) {
+			normal = item.type.normal;
 		} else {
-			normal = ctrl->viewpos - Course.NocollArr[i].pt;
+			normal = ctrl->viewpos - item.pt;
 			normal.Norm();
 		}
-		glNormal3(normal);
-		normal.y = 0.0;
-		normal.Norm();
-
-		static const GLshort tex[] = {
-			0, 1,
-			1, 1,
-			1, 0,
-			0, 0
-		};
-
-		const GLfloat vtx[] = {
-			static_cast<GLfloat>(-itemRadius*normal.z),
-			0.f,
-			static_cast<GLfloat>(itemRadius*normal.x),
-
-			static_cast<GLfloat>(itemRadius*normal.z),
-			0.f,
-			static_cast<GLfloat>(-itemRadius*normal.x),
-			static_cast<GLfloat>(itemRadius*normal.z),
-			static_cast<GLfloat>(itemHeight),
-			static_cast<GLfloat>(-itemRadius*normal.x),
-			static_cast<GLfloat>(-itemRadius*normal.z),
-			static_cast<GLfloat>(itemHeight),
-			static_cast<GLfloat>(itemRadius*normal.x)
-		};
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-		glVertexPointer(3, GL_FLOAT, 0, vtx);
-		glTexCoordPointer(2, GL_SHORT, 0, tex);
-		glDrawArrays(GL_QUADS, 0, 4);
-
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glPopMatrix();
+		TVector3d dir(normal.x, 0.0, normal.z);
+		dir.Norm();
+
+		std::size_t t = &item.type - &Course.ObjTypes[0];
+		AddItemQuad(item_batches[t], item.pt, normal, itemRadius * dir.z, -itemRadius * dir.x, itemHeight);
+	});
+
+	glEnableClientState(GL_NORMAL_ARRAY);
+	for (std::size_t t = 0; t < item_batches.size(); t++) {
+		const std::vector<GLfloat>& batch = item_batches[t];
+		if (batch.empty()) continue;
+		Course.ObjTypes[t].texture->Bind();
+		glVertexPointer(3, GL_FLOAT, 8 * sizeof(GLfloat), &batch[0]);
+		glNormalPointer(GL_FLOAT, 8 * sizeof(GLfloat), &batch[3]);
+		glTexCoordPointer(2, GL_FLOAT, 8 * sizeof(GLfloat), &batch[6]);
+		glDrawArrays(GL_QUADS, 0, (GLsizei)(batch.size() / 8));
 	}
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 }
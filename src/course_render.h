@@ -22,7 +22,27 @@ GNU General Public License for more details.
 
 void setup_course_tex_gen();
 
+class CCourse;
+class CControl;
+
+// A vertex range of the static geometry of a tree type
+struct TTreeRange {
+	GLint first;
+	GLsizei count;
+};
+
+// What DrawTrees draws of one tree type in a frame
+struct TTreeDrawList {
+	std::vector<TTreeRange> ranges;		// the detailed trees
+	std::vector<GLfloat> billboards;	// the far trees, facing the camera
+};
+
 void RenderCourse();
 void DrawTrees();
+void ResetTreeGeometry();
+// The trees of course DrawTrees draws for the camera of ctrl, one list per
+// tree type. Needs the view frustum, but no OpenGL context: the static
+// geometry is built here, and DrawTrees moves it into buffer objects.
+void SelectTrees(const CCourse& course, const CControl* ctrl, std::vector<TTreeDrawList>& lists);
 
 #endif
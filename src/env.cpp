@@ -146,13 +146,13 @@ std::string CEnvironment::GetDir(std::size_t location, std::size_t light) const
 	return res;
 }
 
+// The sides are queued in TexQueue, the high resolution image falls back
+// to the normal one
 void CEnvironment::LoadSkyboxSide(std::size_t index, const std::string& EnvDir, const std::string& name, bool high_res) {
-	bool loaded = false;
 	if (param.perf_level > 3 && high_res)
-		loaded = Skybox[index].Load(EnvDir, name + "H.png");
-
-	if (!loaded)
-		Skybox[index].Load(EnvDir, name + ".png");
+		TexQueue.Add(&Skybox[index], MakePathStr(EnvDir, name + "H.png"), false, MakePathStr(EnvDir, name + ".png"));
+	else
+		TexQueue.Add(&Skybox[index], MakePathStr(EnvDir, name + ".png"), false);
 }
 
 void CEnvironment::LoadSkybox(const std::string& EnvDir, bool high_res) {
@@ -375,6 +375,12 @@ void CEnvironment::DrawFog() const {
 
 
 void CEnvironment::LoadEnvironment(std::size_t loc, std::size_t light) {
+	QueueEnvironment(loc, light);
+	TexQueue.LoadAll();
+}
+
+// Like LoadEnvironment, but the skybox textures are left in TexQueue
+void CEnvironment::QueueEnvironment(std::size_t loc, std::size_t light) {
 	if (loc >= locs.size()) loc = 0;
 	if (light >= 4) light = 0;
 	// remember: with (example) 3 locations and 4 lights there
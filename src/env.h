@@ -76,6 +76,7 @@ public:
 	CEnvironment();
 	bool LoadEnvironmentList();
 	void LoadEnvironment(std::size_t loc, std::size_t light);
+	void QueueEnvironment(std::size_t loc, std::size_t light);
 	void DrawSkybox(const TVector3d& pos) const;
 	void SetupLight();
 	void SetupFog();
@@ -51,12 +51,9 @@ struct TGameData {
 	TToolMode toolmode;
 	float time_step;
 	TGameType game_type;
-	double finish_brake;
 	int argument;
 	int treesize;
 	int treevar;
-	bool finish;
-	bool use_keyframe;
 	bool force_treemap;
 
 	// course and race params
@@ -72,11 +69,11 @@ struct TGameData {
 	int snow_id;
 	int wind_id;
 	std::size_t theme_id;
+	unsigned int seed;		// of the wind and the snow, see CRandom
 
-	// race results (better in player.ctrl ?)
-	float time;				// reached time
+	// race results (better in player.ctrl ?), the time and the herrings
+	// are counted in GameContext
 	int score;				// reached score
-	int herring;			// catched herrings during the race
 	int race_result;		// tuxlifes, only for a single race, see game_ctrl
 	bool raceaborted;
 };
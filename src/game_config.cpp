@@ -81,6 +81,8 @@ void LoadConfigFile() {
 		param.tux_sphere_divisions = SPIntN(*line, "tux_sphere_divisions", 10);
 		param.tux_shadow_sphere_divisions = SPIntN(*line, "tux_shadow_sphere_div", 3);
 		param.course_detail_level = SPIntN(*line, "course_detail_level", 75);
+		param.course_update_budget = SPIntN(*line, "course_update_budget", 2000);
+		param.max_particles = SPIntN(*line, "max_particles", 10000);
 
 		param.use_papercut_font = SPIntN(*line, "use_papercut_font", 1);
 #ifndef MOBILE
@@ -89,7 +91,10 @@ void LoadConfigFile() {
 		param.ice_cursor = SPIntN(*line, "ice_cursor", 0) != 0;
 #endif
 		param.full_skybox = SPBoolN(*line, "full_skybox", false);
+		param.terrain_shader = SPBoolN(*line, "terrain_shader", false);
 		param.use_quad_scale = SPBoolN(*line, "use_quad_scale", false);
+		param.save_replays = SPBoolN(*line, "save_replays", false);
+		param.draw_stats = SPBoolN(*line, "draw_stats", false);
 
 		param.menu_music = SPStrN(*line, "menu_music", "start_1");
 		param.credits_music = SPStrN(*line, "credits_music", "credits_1");
@@ -121,6 +126,8 @@ void SetConfigDefaults() {
 	param.tux_sphere_divisions = 10;
 	param.tux_shadow_sphere_divisions = 3;
 	param.course_detail_level = 75;
+	param.course_update_budget = 2000;
+	param.max_particles = 10000;
 
 	param.use_papercut_font = 1;
 #ifndef MOBILE
@@ -129,7 +136,10 @@ void SetConfigDefaults() {
 	param.ice_cursor = false;
 #endif
 	param.full_skybox = false;
+	param.terrain_shader = false;
 	param.use_quad_scale = false;
+	param.save_replays = false;
+	param.draw_stats = false;
 
 	param.menu_music = "start_1";
 	param.credits_music = "credits_1";
@@ -251,6 +261,19 @@ void SaveConfigFile() {
 	AddItem(liste, "course_detail_level", param.course_detail_level);
 	liste.Add();
 
+	AddComment(liste, "Time for refining the course mesh per frame, in microseconds");
+	AddComment(liste, "Only the parts of the mesh whose detail can have changed are");
+	AddComment(liste, "updated, and after this time the rest waits for the next frame.");
+	AddComment(liste, "0 = update the whole mesh every frame");
+	AddItem(liste, "course_update_budget", param.course_update_budget);
+	liste.Add();
+
+	AddComment(liste, "Maximum number of snow particles");
+	AddComment(liste, "The particles thrown up by the character are kept in a pool");
+	AddComment(liste, "of this size. When it is full, no new particles are created.");
+	AddItem(liste, "max_particles", param.max_particles);
+	liste.Add();
+
 	AddComment(liste, "Font type [0...2]");
 	AddComment(liste, "0 = always arial-like font,");
 	AddComment(liste, "1 = papercut font on the menu screens");
@@ -270,6 +293,13 @@ void SaveConfigFile() {
 	AddItem(liste, "full_skybox", param.full_skybox);
 	liste.Add();
 
+	AddComment(liste, "Draw the course terrain in a single pass [0...1]");
+	AddComment(liste, "Experimental: blends all terrain textures with a shader instead of");
+	AddComment(liste, "drawing one pass per terrain. Needs OpenGL 2.0, otherwise the");
+	AddComment(liste, "normal passes are used.");
+	AddItem(liste, "terrain_shader", param.terrain_shader);
+	liste.Add();
+
 	AddComment(liste, "Select the music:");
 	AddComment(liste, "(the racing music is defined by a music theme)");
 	AddItem(liste, "menu_music", param.menu_music);
@@ -283,6 +313,18 @@ void SaveConfigFile() {
 	AddItem(liste, "use_quad_scale", param.use_quad_scale);
 	liste.Add();
 
+	AddComment(liste, "Save a replay of every finished race [0...1]");
+	AddComment(liste, "The replays are written to the folder 'replays' and can be");
+	AddComment(liste, "checked with 'etr --replay <file>'.");
+	AddItem(liste, "save_replays", param.save_replays);
+	liste.Add();
+
+	AddComment(liste, "Show the draw statistics of the character [0...1]");
+	AddComment(liste, "Debugging aid: the triangles and draw calls of the character");
+	AddComment(liste, "are shown below the frame rate while it is displayed.");
+	AddItem(liste, "draw_stats", param.draw_stats);
+	liste.Add();
+
 	// ---------------------------------------
 	liste.Save(param.config_dir + SEP "options.txt");
 }
@@ -390,6 +432,8 @@ void InitConfig() {
 #endif /* WIN32 */
 
 	param.screenshot_dir = param.save_dir + SEP "screenshots";
+	param.replay_dir = param.save_dir + SEP "replays";
+	param.cache_dir = param.config_dir + SEP "cache";
 	param.obj_dir = param.data_dir + SEP "objects";
 	param.env_dir2 = param.data_dir + SEP "env";
 	param.char_dir = param.data_dir + SEP "char";
@@ -33,6 +33,8 @@ struct TParam {
 	std::string sounds_dir;
 	std::string music_dir;
 	std::string screenshot_dir;
+	std::string replay_dir;
+	std::string cache_dir;
 	std::string font_dir;
 	std::string trans_dir;
 	std::string player_dir;
@@ -59,11 +61,16 @@ struct TParam {
 	int		tux_sphere_divisions;
 	int		tux_shadow_sphere_divisions;
 	int		course_detail_level; // only for quadtree
+	int		course_update_budget; // microseconds per frame, 0 = full update
+	int		max_particles;
 
 	int		use_papercut_font;
 	bool	ice_cursor;
 	bool	full_skybox;
+	bool	terrain_shader;			// single pass terrain rendering
 	bool	use_quad_scale;			// scaling type for menus
+	bool	save_replays;			// of every finished race
+	bool	draw_stats;				// of the character, below the fps
 	bool	fullscreen;
 
 	std::string	menu_music;
@@ -27,6 +27,8 @@ GNU General Public License for more details.
 #include "tux.h"
 #include "physics.h"
 
+TGameData g_game;
+
 // --------------------------------------------------------------------
 //				administration of events and cups
 // --------------------------------------------------------------------
@@ -232,7 +234,7 @@ void CPlayers::ResetControls() {
 void CPlayers::AllocControl(std::size_t player) {
 	if (player >= plyr.size()) return;
 	if (plyr[player].ctrl != nullptr) return;
-	plyr[player].ctrl = new CControl;
+	plyr[player].ctrl = new CControl(&GameContext);
 }
 
 // ----------------------- avatars ------------------------------------
@@ -296,7 +298,7 @@ CCharacter::~CCharacter() {
 	}
 }
 
-bool CCharacter::LoadCharacterList() {
+bool CCharacter::LoadCharacterList(bool previews) {
 	CSPList list;
 
 	if (!list.Load(param.char_dir, "characters.lst")) {
@@ -314,13 +316,15 @@ bool CCharacter::LoadCharacterList() {
 
 		std::string charpath = MakePathStr(param.char_dir, CharList[i].dir);
 		if (DirExists(charpath.c_str())) {
-			std::string previewfile = charpath + SEP "preview.png";
-
 			TCharacter* ch = &CharList[i];
-			ch->preview = new TTexture();
-			if (!ch->preview->Load(previewfile, false)) {
-				Message("could not load previewfile of character");
-//				texid = Tex.TexID (NO_PREVIEW);
+			ch->preview = nullptr;
+			if (previews) {
+				std::string previewfile = charpath + SEP "preview.png";
+				ch->preview = new TTexture();
+				if (!ch->preview->Load(previewfile, false)) {
+					Message("could not load previewfile of character");
+//					texid = Tex.TexID (NO_PREVIEW);
+				}
 			}
 
 			ch->shape = new CCharShape;
@@ -163,7 +163,7 @@ public:
 
 	~CCharacter();
 
-	bool LoadCharacterList();
+	bool LoadCharacterList(bool previews = true);
 	void FreeCharacterPreviews();
 };
 
@@ -23,6 +23,7 @@ GNU General Public License for more details.
 #include "audio.h"
 #include "ogl.h"
 #include "view.h"
+#include "course.h"
 #include "course_render.h"
 #include "env.h"
 #include "hud.h"
@@ -39,6 +40,7 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "physics.h"
 #include "tux.h"
+#include "replay.h"
 
 CGameOver GameOver;
 
@@ -96,7 +98,7 @@ void GameOverMessage(const CControl *ctrl) {
 
 		line = Trans.Text(85) + ":  ";
 		FT.DrawString(firstMarker, AutoYPosN(17), line);
-		line = Int_StrN(g_game.herring);
+		line = Int_StrN(GameContext.herring);
 		if (g_game.game_type == CUPRACING) {
 			line += "  (";
 			line += Int_StrN(g_game.race->herrings.x);
@@ -106,7 +108,7 @@ void GameOverMessage(const CControl *ctrl) {
 
 		line = Trans.Text(86) + ":  ";
 		FT.DrawString(firstMarker, AutoYPosN(22), line);
-		line = Float_StrN(g_game.time, 2);
+		line = Float_StrN(GameContext.time, 2);
 		line += "  s";
 		if (g_game.game_type == CUPRACING) {
 			line += "  (";
@@ -123,7 +125,7 @@ void GameOverMessage(const CControl *ctrl) {
 
 		line = Trans.Text(88) + ":  ";
 		FT.DrawString(firstMarker, AutoYPosN(32), line);
-		line = Float_StrN(ctrl->way / g_game.time * 3.6, 2);
+		line = Float_StrN(ctrl->way / GameContext.time * 3.6, 2);
 		line += "  km/h";
 		FT.DrawString(secondMarker, AutoYPosN(32), line);
 
@@ -146,6 +148,12 @@ void GameOverMessage(const CControl *ctrl) {
 void CGameOver::Enter() {
 	if (!g_game.raceaborted) highscore_pos = Score.CalcRaceResult();
 
+	if (Replay.Recording()) {
+		Replay.Finish(g_game.player->ctrl);
+		if (param.save_replays && !g_game.raceaborted)
+			Replay.Save(ReplayFileName());
+	}
+
 	if (g_game.game_type == CUPRACING) {
 		if (g_game.race_result >= 0) {
 			Music.PlayTheme(g_game.theme_id, MUS_WONRACE);
@@ -161,7 +169,7 @@ void CGameOver::Enter() {
 	}
 
 
-	if (g_game.raceaborted || !g_game.use_keyframe) {
+	if (g_game.raceaborted || !Course.UseKeyframe()) {
 		final_frame = nullptr;
 	} else {
 		if (g_game.game_type == CUPRACING) {
@@ -29,6 +29,7 @@ GNU General Public License for more details.
 #include "physics.h"
 #include "winsys.h"
 #include "game_ctrl.h"
+#include "tux.h"
 #include <algorithm>
 
 
@@ -332,6 +333,18 @@ void DrawFps() {
 		FT.DrawString((Winsys.resolution.width - 60 * scale) / 2, 10 * scale, fpsstr);
 		Winsys.endSFML();
 	}
+
+	if (!param.draw_stats)
+		return;
+
+	// cost of the character, including its shadow
+	const TCharDrawStats& stats = g_game.character->shape->draw_stats;
+	std::string charstr = Int_StrN((int)stats.triangles) + " tris / " + Int_StrN((int)stats.draw_calls) + " calls";
+	Winsys.beginSFML();
+	FT.SetColor(colWhite);
+	FT.AutoSizeN(2);
+	FT.DrawString((Winsys.resolution.width - 60 * scale) / 2, 40 * scale, charstr);
+	Winsys.endSFML();
 }
 
 void DrawPercentBar(float fact, float x, float y) {
@@ -384,26 +397,26 @@ void DrawHud(const CControl *ctrl) {
 	ScopedRenderMode rm(TEXFONT);
 
 	if (g_game.game_type == CUPRACING) {
-		if (g_game.time < g_game.race->time.z)
-			draw_time(g_game.race->time.z - g_game.time, colGold);
-		else if (g_game.time < g_game.race->time.y)
-			draw_time(g_game.race->time.y - g_game.time, colSilver);
-		else if (g_game.time < g_game.race->time.x)
-			draw_time(g_game.race->time.x - g_game.time, colBronze);
+		if (GameContext.time < g_game.race->time.z)
+			draw_time(g_game.race->time.z - GameContext.time, colGold);
+		else if (GameContext.time < g_game.race->time.y)
+			draw_time(g_game.race->time.y - GameContext.time, colSilver);
+		else if (GameContext.time < g_game.race->time.x)
+			draw_time(g_game.race->time.x - GameContext.time, colBronze);
 		else
-			draw_time(g_game.time, colDRed);
-
-		if (g_game.herring < g_game.race->herrings.x)
-			draw_herring_count(g_game.race->herrings.x - g_game.herring, colBronze);
-		else if (g_game.herring < g_game.race->herrings.y)
-			draw_herring_count(g_game.race->herrings.y - g_game.herring, colSilver);
-		else if (g_game.herring < g_game.race->herrings.z)
-			draw_herring_count(g_game.race->herrings.z - g_game.herring, colGold);
+			draw_time(GameContext.time, colDRed);
+
+		if (GameContext.herring < g_game.race->herrings.x)
+			draw_herring_count(g_game.race->herrings.x - GameContext.herring, colBronze);
+		else if (GameContext.herring < g_game.race->herrings.y)
+			draw_herring_count(g_game.race->herrings.y - GameContext.herring, colSilver);
+		else if (GameContext.herring < g_game.race->herrings.z)
+			draw_herring_count(g_game.race->herrings.z - GameContext.herring, colGold);
 		else
-			draw_herring_count(g_game.herring, colGreen);
+			draw_herring_count(GameContext.herring, colGreen);
 	} else {
-		draw_time(g_game.time, param.use_papercut_font < 2 ? colWhite : colDYell);
-		draw_herring_count(g_game.herring, param.use_papercut_font < 2 ? colWhite : colDYell);
+		draw_time(GameContext.time, param.use_papercut_font < 2 ? colWhite : colDYell);
+		draw_herring_count(GameContext.herring, param.use_papercut_font < 2 ? colWhite : colDYell);
 	}
 
 	DrawSpeed(speed * 3.6);
@@ -34,6 +34,8 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "physics.h"
 #include "tux.h"
+#include "loading.h"
+#include <cstdlib>
 
 CIntro Intro;
 static CKeyframe *startframe;
@@ -64,11 +66,12 @@ void CIntro::Enter() {
 	}
 
 	// reset of result values
-	g_game.herring = 0;
+	GameContext.Reset();
+	GameContext.shape = g_game.character->shape;
 	g_game.score = 0;
-	g_game.time = 0.f;
 	g_game.race_result = -1;
 	g_game.raceaborted = false;
+	g_game.seed = (unsigned int)std::rand();
 
 	ctrl->Init();
 
@@ -78,12 +81,7 @@ void CIntro::Enter() {
 	SetCameraDistance(4.0);
 	SetStationaryCamera(false);
 	update_view(ctrl, EPS);
-	std::size_t num_items = Course.NocollArr.size();
-	for (std::size_t i = 0; i < num_items; i++) {
-		if (Course.NocollArr[i].collectable != -1) {
-			Course.NocollArr[i].collectable = 1;
-		}
-	}
+	Course.ResetItems();
 
 	InitSnow(ctrl);
 	InitWind();
@@ -127,6 +125,7 @@ void CIntro::Loop(float time_step) {
 
 	Reshape(width, height);
 	Winsys.SwapBuffers();
+	Loading.FirstFrameDrawn();
 }
 // -----------------------------------------------------------------------
 
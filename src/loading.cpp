@@ -31,6 +31,8 @@ GNU General Public License for more details.
 #include "gui.h"
 #include "intro.h"
 #include "winsys.h"
+#include "game_ctrl.h"
+#include "spx.h"
 
 CLoading Loading;
 
@@ -38,6 +40,44 @@ CLoading Loading;
 void CLoading::Enter() {
 	Winsys.ShowCursor(false);
 	Music.Play("loading", true);
+	clock.restart();
+	measuring = param.draw_stats;
+
+	load_course = Course.BeginLoadCourse(g_game.course);
+	g_game.location_id = Course.GetEnv();
+	Env.QueueEnvironment(g_game.location_id, g_game.light_id);
+
+	course_prepared = false;
+	loader_done = false;
+	loader = std::thread([this] {
+		if (load_course)
+			course_prepared = Course.PrepareCourse();
+		TexQueue.Decode();
+		loader_done = true;
+	});
+}
+
+void CLoading::Exit() {
+	if (loader.joinable())
+		loader.join();
+}
+
+// The course files count for one half, decoding and uploading the
+// textures for the other
+float CLoading::Progress() const {
+	float course = load_course ? Course.PrepareProgress() : 1.f;
+	std::size_t total = TexQueue.Total();
+	if (total == 0)
+		return loader_done ? 1.f : 0.5f * course;
+	float textures = (TexQueue.Decoded() + TexQueue.Uploaded()) / (2.f * total);
+	return 0.5f * course + 0.5f * textures;
+}
+
+void CLoading::FirstFrameDrawn() {
+	if (measuring) {
+		Message("time to first course frame: " + Int_StrN(clock.getElapsedTime().asMilliseconds()) + " ms");
+		measuring = false;
+	}
 }
 
 void CLoading::Loop(float time_step) {
@@ -60,10 +100,30 @@ void CLoading::Loop(float time_step) {
 	FT.DrawString(CENTER, AutoYPosN(60), Trans.Text(29) + " '" + g_game.course->name + '\'');
 	FT.SetColor(colWhite);
 	FT.DrawString(CENTER, AutoYPosN(70), Trans.Text(30));
+
+	int barwidth = 300 * Winsys.scale;
+	int barheight = 12 * Winsys.scale;
+	int barx = (Winsys.resolution.width - barwidth) / 2;
+	int bary = AutoYPosN(78);
+	DrawFrameX(barx, bary, barwidth, barheight, 2, colMBackgr, colWhite, 1.f);
+	DrawFrameX(barx, bary, (int)(barwidth * Progress()), barheight, 2, colDYell, colWhite, 1.f);
 	Winsys.SwapBuffers();
 
-	Course.LoadCourse(g_game.course);
-	g_game.location_id = Course.GetEnv();
-	Env.LoadEnvironment(g_game.location_id, g_game.light_id);
+	if (!loader_done)
+		return;
+	if (loader.joinable())
+		loader.join();
+
+	// create the GL textures, but keep the screen moving
+	sf::Clock frame;
+	while (TexQueue.UploadNext()) {
+		if (frame.getElapsedTime().asMilliseconds() > 20)
+			return;
+	}
+
+	if (!load_course || course_prepared)
+		Course.FinishLoadCourse(load_course);
+	if (measuring)
+		Message("course loaded in " + Int_StrN(clock.getElapsedTime().asMilliseconds()) + " ms");
 	State::manager.RequestEnterState(Intro);
 }
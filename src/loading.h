@@ -17,14 +17,32 @@ GNU General Public License for more details.
 
 #include "bh.h"
 #include "states.h"
+#include <thread>
+#include <atomic>
 
 #ifndef LOADING_H
 #define LOADING_H
 
+// Reads the course and environment on a loader thread while the loading
+// screen is drawn. Only the GL uploads are left to the main thread.
 class CLoading final : public State {
+	std::thread loader;
+	std::atomic<bool> loader_done;
+	bool load_course;
+	bool course_prepared;
+	bool measuring;
+	sf::Clock clock;
+
 	void Enter();
 	void Loop(float time_step);
+	void Exit();
+	float Progress() const;
 public:
+	CLoading() : loader_done(false), load_course(false), course_prepared(false), measuring(false) {}
+
+	// With draw_stats, reports the time from entering the loading screen
+	// to the first frame that shows the course
+	void FirstFrameDrawn();
 };
 
 extern CLoading Loading;
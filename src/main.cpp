@@ -30,6 +30,7 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "game_ctrl.h"
 #include "course.h"
+#include "simulate.h"
 #include <iostream>
 #include <ctime>
 #include <cstring>
@@ -38,13 +39,21 @@ GNU General Public License for more details.
 #include "SFML/Main.hpp"
 #endif
 
-TGameData g_game;
+static std::string simulate_course;
+static std::string simulate_script;
 
 void InitGame(int argc, char **argv) {
 	g_game.active = true;
 	g_game.toolmode = NONE;
 	g_game.argument = 0;
-	if (argc == 4) {
+	if (argc >= 3 && argc <= 4 && std::strcmp("--simulate", argv[1]) == 0) {
+		g_game.argument = 5;
+		simulate_course = argv[2];
+		if (argc == 4) simulate_script = argv[3];
+	} else if (argc == 3 && std::strcmp("--replay", argv[1]) == 0) {
+		g_game.argument = 6;
+		simulate_script = argv[2];
+	} else if (argc == 4) {
 		if (std::strcmp("--char", argv[1]) == 0)
 			g_game.argument = 4;
 		Tools.SetParameter(argv[2], argv[3]);
@@ -63,6 +72,7 @@ void InitGame(int argc, char **argv) {
 	g_game.snow_id = 0;
 	g_game.cup = 0;
 	g_game.theme_id = 0;
+	g_game.seed = 0;
 	g_game.force_treemap = false;
 	g_game.treesize = 3;
 	g_game.treevar = 3;
@@ -75,6 +85,18 @@ int main(int argc, char **argv) {
 	std::srand(std::time(nullptr));
 	InitConfig();
 	InitGame(argc, argv);
+
+	// headless race, without window, OpenGL and audio
+	if (g_game.argument == 5 || g_game.argument == 6) {
+		int result;
+		if (g_game.argument == 5)
+			result = RunSimulation(simulate_course, simulate_script);
+		else
+			result = RunReplay(simulate_script);
+		Course.FreeCourseList();
+		return result;
+	}
+
 	Winsys.Init();
 	InitOpenglExtensions();
 
@@ -436,70 +436,12 @@ void TransPolyhedron(const TMatrix<4, 4>& mat, TPolyhedron& ph) {
 //					ode solver
 // --------------------------------------------------------------------
 
-const double ode23_time_step_mat[] = { 0., 1./2., 3./4., 1. };
-const double ode23_coeff_mat[][4] = {
-	{0.0, 1./2.,   0.0,  2./9.},
-	{0.0,   0.0, 3./4.,  1./3.},
-	{0.0,   0.0,   0.0,  4./9.},
-	{0.0,   0.0,   0.0,    0.0}
-};
-
-const double ode23_error_mat[] = {-5./72., 1./12., 1./9., -1./8. };
-const double ode23_time_step_exp = 1./3.;
-
-int ode23_NumEstimates() {return 4; }
-
-void ode23_InitOdeData(TOdeData *data, double init_val, double h) {
-	data->init_val = init_val;
-	data->h = h;
-}
-
-double ode23_NextTime(TOdeData *data, int step) {
-	return ode23_time_step_mat[step] * data->h;
-}
-
-double ode23_NextValue(TOdeData *data, int step) {
-	double val = data->init_val;
-
-	for (int i=0; i<step; i++)
-		val += ode23_coeff_mat[i][step] * data->k[i];
-	return val;
-}
-
-void ode23_UpdateEstimate(TOdeData *data, int step, double val) {
-	data->k[step] = data->h * val;
-}
-
-double ode23_FinalEstimate(TOdeData *data) {
-	double val = data->init_val;
-
-	for (int i=0; i<3; i++)
-		val += ode23_coeff_mat[i][3] * data->k[i];
-	return val;
-}
-
-double ode23_EstimateError(TOdeData *data) {
-	double err=0.;
-
-	for (int i=0; i<4; i++)
-		err += ode23_error_mat[i] * data->k[i];
-	return std::fabs(err);
-}
-
-double ode23_TimestepExponent() {
-	return ode23_time_step_exp;
-}
-
-TOdeSolver::TOdeSolver() {
-	NumEstimates = ode23_NumEstimates;
-	InitOdeData = ode23_InitOdeData;
-	NextTime = ode23_NextTime;
-	NextValue = ode23_NextValue;
-	UpdateEstimate = ode23_UpdateEstimate;
-	FinalEstimate = ode23_FinalEstimate;
-	EstimateError = ode23_EstimateError;
-	TimestepExponent = ode23_TimestepExponent;
-}
+constexpr double TOde23::a[4][4];
+constexpr double TOde23::b[4];
+constexpr double TOde23::e[4];
+constexpr double TOdeRK4::a[4][4];
+constexpr double TOdeRK4::b[4];
+constexpr double TOdeRK4::e[4];
 
 double LinearInterp(const double x[], const double y[], double val, int n) {
 	int i;
@@ -527,6 +469,18 @@ int IRandom(int min, int max) {
 	return min + std::rand()%(max-min+1);
 }
 
+void CRandom::Seed(uint32_t seed) {
+	state = seed * 0x9E3779B9u + 0x7F4A7C15u;
+	if (state == 0) state = 1;	// xorshift never leaves 0
+}
+
+uint32_t CRandom::Next() {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
 int ITrunc(int val, int base) {
 	return (int)(val / base);
 }
@@ -70,31 +70,82 @@ void		TransPolyhedron(const TMatrix<4, 4>& mat, TPolyhedron& ph);
 //				ode solver
 // --------------------------------------------------------------------
 
-struct TOdeData {
-	double k[4];
-	double init_val;
-	double h;
+// Explicit Runge-Kutta methods. a[i][step] weights the slope i in the
+// estimate of a step, b the slopes in the final estimate and e the slopes
+// in the error estimate. Methods which aren't adaptive run with a fixed
+// time step, their error is not estimated.
+
+struct TOde23 {		// Bogacki-Shampine
+	static constexpr int NumEstimates = 4;
+	static constexpr bool Adaptive = true;
+	static constexpr double TimestepExponent = 1./3.;
+	static constexpr double a[4][4] = {
+		{0.0, 1./2.,   0.0,  2./9.},
+		{0.0,   0.0, 3./4.,  1./3.},
+		{0.0,   0.0,   0.0,  4./9.},
+		{0.0,   0.0,   0.0,    0.0}
+	};
+	static constexpr double b[4] = { 2./9., 1./3., 4./9., 0. };
+	static constexpr double e[4] = { -5./72., 1./12., 1./9., -1./8. };
+};
+
+struct TOdeRK4 {	// classic Runge-Kutta
+	static constexpr int NumEstimates = 4;
+	static constexpr bool Adaptive = false;
+	static constexpr double TimestepExponent = 1./4.;
+	static constexpr double a[4][4] = {
+		{0.0, 1./2.,   0.0,    0.0},
+		{0.0,   0.0, 1./2.,    0.0},
+		{0.0,   0.0,   0.0,    1.0},
+		{0.0,   0.0,   0.0,    0.0}
+	};
+	static constexpr double b[4] = { 1./6., 1./3., 1./3., 1./6. };
+	static constexpr double e[4] = { 0., 0., 0., 0. };
 };
 
-typedef int (*PNumEstimates)();
-typedef void (*PInitOdeData)(TOdeData *, double init_val, double h);
-typedef double (*PNextTime)(TOdeData *, int step);
-typedef double (*PNextValue)(TOdeData *, int step);
-typedef void (*PUpdateEstimate)(TOdeData *, int step, double val);
-typedef double (*PFinalEstimate)(TOdeData *);
-typedef double (*PEstimateError)(TOdeData *);
-typedef double (*PTimestepExponent)();
-
-struct TOdeSolver {
-	PNumEstimates		NumEstimates;
-	PInitOdeData		InitOdeData;
-	PNextTime			NextTime;
-	PNextValue			NextValue;
-	PUpdateEstimate		UpdateEstimate;
-	PFinalEstimate		FinalEstimate;
-	PEstimateError		EstimateError;
-	PTimestepExponent	TimestepExponent;
-	TOdeSolver();
+// One step of the size h of a system with the state position and velocity.
+// The slopes are stored multiplied with h.
+template<typename Method>
+struct TOdeStep {
+	TVector3d init_pos;
+	TVector3d init_vel;
+	TVector3d kpos[Method::NumEstimates];
+	TVector3d kvel[Method::NumEstimates];
+	double h;
+
+	TOdeStep(const TVector3d& pos, const TVector3d& vel, double h_)
+		: init_pos(pos), init_vel(vel), h(h_)
+	{}
+	void UpdateEstimate(int step, const TVector3d& vel, const TVector3d& acc) {
+		kpos[step] = h * vel;
+		kvel[step] = h * acc;
+	}
+	void NextValue(int step, TVector3d& pos, TVector3d& vel) const {
+		pos = init_pos;
+		vel = init_vel;
+		for (int i=0; i<step; i++) {
+			pos += Method::a[i][step] * kpos[i];
+			vel += Method::a[i][step] * kvel[i];
+		}
+	}
+	void FinalEstimate(TVector3d& pos, TVector3d& vel) const {
+		pos = init_pos;
+		vel = init_vel;
+		for (int i=0; i<Method::NumEstimates; i++) {
+			pos += Method::b[i] * kpos[i];
+			vel += Method::b[i] * kvel[i];
+		}
+	}
+	// length of the error vectors of the final estimate
+	void EstimateError(double& pos_err, double& vel_err) const {
+		TVector3d perr, verr;
+		for (int i=0; i<Method::NumEstimates; i++) {
+			perr += Method::e[i] * kpos[i];
+			verr += Method::e[i] * kvel[i];
+		}
+		pos_err = std::sqrt(perr.x * perr.x + perr.y * perr.y + perr.z * perr.z);
+		vel_err = std::sqrt(verr.x * verr.x + verr.y * verr.y + verr.z * verr.z);
+	}
 };
 
 // --------------------------------------------------------------------
@@ -110,4 +161,18 @@ int		IRandom(int min, int max);
 int		ITrunc(int val, int base);
 int		IFrac(int val, int base);
 
+// Random numbers whose sequence depends only on the seed. Unlike the
+// functions above it doesn't share its state with other modules, so
+// whatever uses it can be replayed.
+class CRandom {
+	uint32_t state;
+public:
+	explicit CRandom(uint32_t seed = 0) { Seed(seed); }
+	void Seed(uint32_t seed);
+	uint32_t Next();
+	double Frac() { return Next() / 4294967295.0; }		// like FRandom
+	double Range(double min, double max) { return Frac() * (max - min) + min; }	// like XRandom
+	int Int(int min, int max) { return min + (int)(Next() % (uint32_t)(max - min + 1)); }	// like IRandom
+};
+
 #endif
@@ -64,6 +64,39 @@ void check_gl_error() {
 PFNGLLOCKARRAYSEXTPROC glLockArraysEXT_p = nullptr;
 PFNGLUNLOCKARRAYSEXTPROC glUnlockArraysEXT_p = nullptr;
 
+PFNGLGENBUFFERSPROC glGenBuffers_p = nullptr;
+PFNGLDELETEBUFFERSPROC glDeleteBuffers_p = nullptr;
+PFNGLBINDBUFFERPROC glBindBuffer_p = nullptr;
+PFNGLBUFFERDATAPROC glBufferData_p = nullptr;
+PFNGLBUFFERSUBDATAPROC glBufferSubData_p = nullptr;
+
+PFNGLCREATESHADERPROC glCreateShader_p = nullptr;
+PFNGLDELETESHADERPROC glDeleteShader_p = nullptr;
+PFNGLSHADERSOURCEPROC glShaderSource_p = nullptr;
+PFNGLCOMPILESHADERPROC glCompileShader_p = nullptr;
+PFNGLGETSHADERIVPROC glGetShaderiv_p = nullptr;
+PFNGLGETSHADERINFOLOGPROC glGetShaderInfoLog_p = nullptr;
+PFNGLCREATEPROGRAMPROC glCreateProgram_p = nullptr;
+PFNGLDELETEPROGRAMPROC glDeleteProgram_p = nullptr;
+PFNGLATTACHSHADERPROC glAttachShader_p = nullptr;
+PFNGLLINKPROGRAMPROC glLinkProgram_p = nullptr;
+PFNGLGETPROGRAMIVPROC glGetProgramiv_p = nullptr;
+PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog_p = nullptr;
+PFNGLUSEPROGRAMPROC glUseProgram_p = nullptr;
+PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation_p = nullptr;
+PFNGLUNIFORM1IPROC glUniform1i_p = nullptr;
+PFNGLUNIFORM1FPROC glUniform1f_p = nullptr;
+PFNGLUNIFORM2FPROC glUniform2f_p = nullptr;
+PFNGLACTIVETEXTUREPROC glActiveTexture_p = nullptr;
+
+// core name first, then the ARB variant
+static decltype(sf::Context::getFunction("")) GetGLFunction(const char* name) {
+	decltype(sf::Context::getFunction("")) func = sf::Context::getFunction(name);
+	if (func == nullptr)
+		func = sf::Context::getFunction((std::string(name) + "ARB").c_str());
+	return func;
+}
+
 void InitOpenglExtensions() {
 	glLockArraysEXT_p = (PFNGLLOCKARRAYSEXTPROC)sf::Context::getFunction("glLockArraysEXT");
 	glUnlockArraysEXT_p = (PFNGLUNLOCKARRAYSEXTPROC)sf::Context::getFunction("glUnlockArraysEXT");
@@ -73,6 +106,72 @@ void InitOpenglExtensions() {
 		glLockArraysEXT_p = nullptr;
 		glUnlockArraysEXT_p = nullptr;
 	}
+
+	glGenBuffers_p = (PFNGLGENBUFFERSPROC)GetGLFunction("glGenBuffers");
+	glDeleteBuffers_p = (PFNGLDELETEBUFFERSPROC)GetGLFunction("glDeleteBuffers");
+	glBindBuffer_p = (PFNGLBINDBUFFERPROC)GetGLFunction("glBindBuffer");
+	glBufferData_p = (PFNGLBUFFERDATAPROC)GetGLFunction("glBufferData");
+	glBufferSubData_p = (PFNGLBUFFERSUBDATAPROC)GetGLFunction("glBufferSubData");
+
+	if (glGenBuffers_p == nullptr || glDeleteBuffers_p == nullptr || glBindBuffer_p == nullptr
+	        || glBufferData_p == nullptr || glBufferSubData_p == nullptr) {
+		Message("Vertex buffer objects NOT supported");
+		glGenBuffers_p = nullptr;
+		glDeleteBuffers_p = nullptr;
+		glBindBuffer_p = nullptr;
+		glBufferData_p = nullptr;
+		glBufferSubData_p = nullptr;
+	}
+
+	// shaders are only used for optional render paths
+	glCreateShader_p = (PFNGLCREATESHADERPROC)sf::Context::getFunction("glCreateShader");
+	glDeleteShader_p = (PFNGLDELETESHADERPROC)sf::Context::getFunction("glDeleteShader");
+	glShaderSource_p = (PFNGLSHADERSOURCEPROC)sf::Context::getFunction("glShaderSource");
+	glCompileShader_p = (PFNGLCOMPILESHADERPROC)sf::Context::getFunction("glCompileShader");
+	glGetShaderiv_p = (PFNGLGETSHADERIVPROC)sf::Context::getFunction("glGetShaderiv");
+	glGetShaderInfoLog_p = (PFNGLGETSHADERINFOLOGPROC)sf::Context::getFunction("glGetShaderInfoLog");
+	glCreateProgram_p = (PFNGLCREATEPROGRAMPROC)sf::Context::getFunction("glCreateProgram");
+	glDeleteProgram_p = (PFNGLDELETEPROGRAMPROC)sf::Context::getFunction("glDeleteProgram");
+	glAttachShader_p = (PFNGLATTACHSHADERPROC)sf::Context::getFunction("glAttachShader");
+	glLinkProgram_p = (PFNGLLINKPROGRAMPROC)sf::Context::getFunction("glLinkProgram");
+	glGetProgramiv_p = (PFNGLGETPROGRAMIVPROC)sf::Context::getFunction("glGetProgramiv");
+	glGetProgramInfoLog_p = (PFNGLGETPROGRAMINFOLOGPROC)sf::Context::getFunction("glGetProgramInfoLog");
+	glUseProgram_p = (PFNGLUSEPROGRAMPROC)sf::Context::getFunction("glUseProgram");
+	glGetUniformLocation_p = (PFNGLGETUNIFORMLOCATIONPROC)sf::Context::getFunction("glGetUniformLocation");
+	glUniform1i_p = (PFNGLUNIFORM1IPROC)sf::Context::getFunction("glUniform1i");
+	glUniform1f_p = (PFNGLUNIFORM1FPROC)sf::Context::getFunction("glUniform1f");
+	glUniform2f_p = (PFNGLUNIFORM2FPROC)sf::Context::getFunction("glUniform2f");
+	glActiveTexture_p = (PFNGLACTIVETEXTUREPROC)sf::Context::getFunction("glActiveTexture");
+
+	if (glCreateShader_p == nullptr || glDeleteShader_p == nullptr
+	        || glShaderSource_p == nullptr || glCompileShader_p == nullptr
+	        || glGetShaderiv_p == nullptr || glGetShaderInfoLog_p == nullptr
+	        || glCreateProgram_p == nullptr || glDeleteProgram_p == nullptr
+	        || glAttachShader_p == nullptr || glLinkProgram_p == nullptr
+	        || glGetProgramiv_p == nullptr || glGetProgramInfoLog_p == nullptr
+	        || glUseProgram_p == nullptr || glGetUniformLocation_p == nullptr
+	        || glUniform1i_p == nullptr || glUniform1f_p == nullptr
+	        || glUniform2f_p == nullptr || glActiveTexture_p == nullptr) {
+		Message("GLSL shaders NOT supported");
+		glCreateShader_p = nullptr;
+		glDeleteShader_p = nullptr;
+		glShaderSource_p = nullptr;
+		glCompileShader_p = nullptr;
+		glGetShaderiv_p = nullptr;
+		glGetShaderInfoLog_p = nullptr;
+		glCreateProgram_p = nullptr;
+		glDeleteProgram_p = nullptr;
+		glAttachShader_p = nullptr;
+		glLinkProgram_p = nullptr;
+		glGetProgramiv_p = nullptr;
+		glGetProgramInfoLog_p = nullptr;
+		glUseProgram_p = nullptr;
+		glGetUniformLocation_p = nullptr;
+		glUniform1i_p = nullptr;
+		glUniform1f_p = nullptr;
+		glUniform2f_p = nullptr;
+		glActiveTexture_p = nullptr;
+	}
 }
 
 void PrintGLInfo() {
@@ -44,6 +44,37 @@ enum TRenderMode {
 extern PFNGLLOCKARRAYSEXTPROC glLockArraysEXT_p;
 extern PFNGLUNLOCKARRAYSEXTPROC glUnlockArraysEXT_p;
 
+// buffer objects (OpenGL 1.5 or ARB_vertex_buffer_object)
+extern PFNGLGENBUFFERSPROC glGenBuffers_p;
+extern PFNGLDELETEBUFFERSPROC glDeleteBuffers_p;
+extern PFNGLBINDBUFFERPROC glBindBuffer_p;
+extern PFNGLBUFFERDATAPROC glBufferData_p;
+extern PFNGLBUFFERSUBDATAPROC glBufferSubData_p;
+
+inline bool HaveBufferObjects() { return glBindBuffer_p != nullptr; }
+
+// shaders (OpenGL 2.0)
+extern PFNGLCREATESHADERPROC glCreateShader_p;
+extern PFNGLDELETESHADERPROC glDeleteShader_p;
+extern PFNGLSHADERSOURCEPROC glShaderSource_p;
+extern PFNGLCOMPILESHADERPROC glCompileShader_p;
+extern PFNGLGETSHADERIVPROC glGetShaderiv_p;
+extern PFNGLGETSHADERINFOLOGPROC glGetShaderInfoLog_p;
+extern PFNGLCREATEPROGRAMPROC glCreateProgram_p;
+extern PFNGLDELETEPROGRAMPROC glDeleteProgram_p;
+extern PFNGLATTACHSHADERPROC glAttachShader_p;
+extern PFNGLLINKPROGRAMPROC glLinkProgram_p;
+extern PFNGLGETPROGRAMIVPROC glGetProgramiv_p;
+extern PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog_p;
+extern PFNGLUSEPROGRAMPROC glUseProgram_p;
+extern PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation_p;
+extern PFNGLUNIFORM1IPROC glUniform1i_p;
+extern PFNGLUNIFORM1FPROC glUniform1f_p;
+extern PFNGLUNIFORM2FPROC glUniform2f_p;
+extern PFNGLACTIVETEXTUREPROC glActiveTexture_p;
+
+inline bool HaveShaders() { return glUseProgram_p != nullptr; }
+
 void check_gl_error();
 void InitOpenglExtensions();
 void PrintGLInfo();
@@ -48,6 +48,9 @@ GNU General Public License for more details.
 #define AIR_DRAG 0.4
 #define TUX_WIDTH 0.45
 
+// all particles and snow flakes, the wind has its own generator
+static CRandom random_gen;
+
 #define PARTICLE_MIN_SIZE 1
 #define PARTICLE_SIZE_RANGE 10
 
@@ -71,7 +74,7 @@ TGuiParticle::TGuiParticle(float x, float y) {
 	sprite.setTexture(texture);
 	sprite.setPosition(x*static_cast<float>(Winsys.resolution.width), y*static_cast<float>(Winsys.resolution.height));
 	sprite.setColor(sf::Color(255, 255, 255, 76));
-	double p_dist = FRandom();
+	double p_dist = random_gen.Frac();
 
 	size = PARTICLE_MIN_SIZE + (1.0 - p_dist) * PARTICLE_SIZE_RANGE;
 
@@ -79,7 +82,7 @@ TGuiParticle::TGuiParticle(float x, float y) {
 	vel.x = 0;
 	vel.y = BASE_VELOCITY + p_dist * VELOCITY_RANGE;
 
-	int type = std::rand() % 4;
+	int type = random_gen.Int(0, 3);
 	switch (type) {
 		case 0:
 			sprite.setTextureRect(sf::IntRect(0, 0, texture.getSize().x / 2, texture.getSize().y / 2));
@@ -128,7 +131,7 @@ void TGuiParticle::Update(float time_step, float push_timestep, const TVector2d&
 void init_ui_snow() {
 	particles_2d.clear();
 	for (int i = 0; i < BASE_snowparticles * Winsys.resolution.width; i++)
-		particles_2d.emplace_back(static_cast<float>(FRandom()), static_cast<float>(FRandom()));
+		particles_2d.emplace_back(static_cast<float>(random_gen.Frac()), static_cast<float>(random_gen.Frac()));
 	push_position = TVector2d(0.0, 0.0);
 }
 
@@ -150,17 +153,17 @@ void update_ui_snow(float time_step) {
 		p->Update(time_step, push_timestep, push_vector);
 	}
 
-	if (FRandom() < time_step*20.f*(MAX_num_snowparticles - particles_2d.size()) / 1000.f) {
-		particles_2d.emplace_back(static_cast<float>(FRandom()), -0.05f);
+	if (random_gen.Frac() < time_step*20.f*(MAX_num_snowparticles - particles_2d.size()) / 1000.f) {
+		particles_2d.emplace_back(static_cast<float>(random_gen.Frac()), -0.05f);
 	}
 
 	for (std::list<TGuiParticle>::iterator p = particles_2d.begin(); p != particles_2d.end();) {
 		if (p->sprite.getPosition().y / static_cast<float>(Winsys.resolution.height) > 1.05) {
-			if (particles_2d.size() > BASE_snowparticles * Winsys.resolution.width && FRandom() > 0.2) {
+			if (particles_2d.size() > BASE_snowparticles * Winsys.resolution.width && random_gen.Frac() > 0.2) {
 				p = particles_2d.erase(p);
 			} else {
-				p->sprite.setPosition(static_cast<float>(Winsys.resolution.width)*FRandom(), static_cast<float>(Winsys.resolution.height) * (-FRandom()*BASE_VELOCITY));
-				double p_dist = FRandom();
+				p->sprite.setPosition(static_cast<float>(Winsys.resolution.width)*random_gen.Frac(), static_cast<float>(Winsys.resolution.height) * (-random_gen.Frac()*BASE_VELOCITY));
+				double p_dist = random_gen.Frac();
 				p->size = PARTICLE_MIN_SIZE + (1.f - p_dist) * PARTICLE_SIZE_RANGE;
 				p->sprite.setScale(p->size / (p->sprite.getTexture()->getSize().x / 2), p->size / (p->sprite.getTexture()->getSize().x / 2));
 				p->vel.x = 0;
@@ -194,7 +197,6 @@ void push_ui_snow(const TVector2i& pos) {
 //						tux particles
 // ====================================================================
 
-#define MAX_PARTICLES 10000
 #define START_RADIUS 0.04
 #define OLD_PART_SIZE 0.12	// orig 0.07
 #define NEW_PART_SIZE 0.035	// orig 0.02
@@ -213,26 +215,148 @@ void push_ui_snow(const TVector2i& pos) {
 #define PARTICLE_SPEED_MULTIPLIER 0.3
 #define MAX_PARTICLE_SPEED 2.0
 
-
-struct Particle {
-	TVector3d pt;
-	short type;
-	double base_size;
-	double cur_size;
-	double terrain_height;
-	double age;
-	double death;
-	double alpha;
-	TVector3d vel;
-
-	void Draw(const CControl* ctrl) const;
-private:
-	void draw_billboard(const CControl *ctrl, double width, double height, bool use_world_y_axis, const GLfloat* tex) const;
+// The race particles are kept in a pool of fixed capacity (param.max_particles),
+// one array per attribute. A dead particle is replaced by the last one, so
+// the live particles always occupy the range [0, count).
+struct TParticlePool {
+	std::size_t count;
+	std::size_t capacity;
+
+	std::vector<float> x, y, z;
+	std::vector<float> vx, vy, vz;
+	std::vector<float> age;
+	std::vector<float> death;
+	std::vector<float> base_size;
+	std::vector<float> cur_size;
+	std::vector<float> alpha;
+	// scratch for the height lookup of the born particles
+	std::vector<uint32_t> born;
+	std::vector<float> born_x, born_z, terrain_y;
+	std::vector<uint8_t> type;
+
+	TParticlePool() : count(0), capacity(0) {}
+	void Reserve(std::size_t cap);
+	void Remove(std::size_t i);
 };
 
-static std::list<Particle> particles;
+void TParticlePool::Reserve(std::size_t cap) {
+	capacity = cap;
+	count = std::min(count, cap);
+	x.resize(cap); y.resize(cap); z.resize(cap);
+	vx.resize(cap); vy.resize(cap); vz.resize(cap);
+	age.resize(cap);
+	death.resize(cap);
+	base_size.resize(cap);
+	cur_size.resize(cap);
+	alpha.resize(cap);
+	born.resize(cap);
+	born_x.resize(cap);
+	born_z.resize(cap);
+	terrain_y.resize(cap);
+	type.resize(cap);
+}
+
+void TParticlePool::Remove(std::size_t i) {
+	std::size_t last = --count;
+	x[i] = x[last]; y[i] = y[last]; z[i] = z[last];
+	vx[i] = vx[last]; vy[i] = vy[last]; vz[i] = vz[last];
+	age[i] = age[last];
+	death[i] = death[last];
+	base_size[i] = base_size[last];
+	cur_size[i] = cur_size[last];
+	alpha[i] = alpha[last];
+	type[i] = type[last];
+}
+
+static TParticlePool particles;
+
+void create_new_particles(const TVector3d& loc, const TVector3d& vel, std::size_t num) {
+	if (particles.capacity != (std::size_t)std::max(param.max_particles, 0))
+		particles.Reserve(std::max(param.max_particles, 0));
+
+	double speed = vel.Length();
+
+	if (particles.count + num > particles.capacity) {
+		Message("maximum number of particles exceeded");
+		num = particles.capacity - particles.count;
+	}
+	for (std::size_t i = particles.count; i < particles.count + num; i++) {
+		particles.x[i] = loc.x + 2.*(random_gen.Frac() - 0.5) * START_RADIUS;
+		particles.y[i] = loc.y;
+		particles.z[i] = loc.z + 2.*(random_gen.Frac() - 0.5) * START_RADIUS;
+		particles.type[i] = random_gen.Int(0, 3);
+		particles.base_size[i] = (random_gen.Frac() + 0.5) * OLD_PART_SIZE;
+		particles.cur_size[i] = NEW_PART_SIZE;
+		particles.age[i] = random_gen.Frac() * MIN_AGE;
+		particles.death[i] = random_gen.Frac() * MAX_AGE;
+		particles.alpha[i] = 1.f;
+		particles.vx[i] = vel.x + VARIANCE_FACTOR * (random_gen.Frac() - 0.5) * speed;
+		particles.vy[i] = vel.y + VARIANCE_FACTOR * (random_gen.Frac() - 0.5) * speed;
+		particles.vz[i] = vel.z + VARIANCE_FACTOR * (random_gen.Frac() - 0.5) * speed;
+	}
+	particles.count += num;
+}
+
+void update_particles(const CCourse& course, float time_step) {
+	std::size_t n = particles.count;
+	if (n == 0)
+		return;
 
-void Particle::Draw(const CControl* ctrl) const {
+	// particles with negative age are not born yet and stay in place
+	float* age = &particles.age[0];
+	float* x = &particles.x[0];
+	float* y = &particles.y[0];
+	float* z = &particles.z[0];
+	const float* vx = &particles.vx[0];
+	const float* vy = &particles.vy[0];
+	const float* vz = &particles.vz[0];
+	for (std::size_t i = 0; i < n; i++) {
+		age[i] += time_step;
+		float dt = age[i] < 0 ? 0.f : time_step;
+		x[i] += dt * vx[i];
+		y[i] += dt * vy[i];
+		z[i] += dt * vz[i];
+	}
+
+	// the terrain below the born particles, in one batch
+	uint32_t* born = &particles.born[0];
+	float* born_x = &particles.born_x[0];
+	float* born_z = &particles.born_z[0];
+	std::size_t num_born = 0;
+	for (std::size_t i = 0; i < n; i++) {
+		// without a branch, an unborn particle is overwritten by the next
+		born[num_born] = (uint32_t)i;
+		born_x[num_born] = x[i];
+		born_z[num_born] = z[i];
+		num_born += age[i] >= 0;
+	}
+	float* terrain_y = &particles.terrain_y[0];
+	course.FindYCoordBatch(born_x, born_z, terrain_y, num_born);
+
+	// going backwards, a removed particle is replaced by one that has
+	// already been checked or is not born yet
+	for (std::size_t k = num_born; k-- > 0;) {
+		std::size_t i = born[k];
+		if (y[i] < terrain_y[k] - 3 || age[i] >= particles.death[i])
+			particles.Remove(i);
+	}
+
+	n = particles.count;
+	const float* death = &particles.death[0];
+	float* alpha = &particles.alpha[0];
+	float* cur_size = &particles.cur_size[0];
+	float* vel_y = &particles.vy[0];
+	for (std::size_t i = 0; i < n; i++) {
+		if (age[i] < 0) continue;
+		alpha[i] = (death[i] - age[i]) / death[i];
+		cur_size[i] = NEW_PART_SIZE + (OLD_PART_SIZE - NEW_PART_SIZE) * (age[i] / death[i]);
+		vel_y[i] += -EARTH_GRAV * time_step;
+	}
+}
+
+// All visible particles are drawn with one call. The billboard corners
+// are built from the camera axes, which are taken once per frame.
+void draw_particles(const CControl *ctrl) {
 	static const GLfloat tex_coords[4][8] = {
 		{
 			0.0, 0.5,
@@ -256,142 +380,89 @@ void Particle::Draw(const CControl* ctrl) const {
 			0.5, 0.5
 		}
 	};
+	static std::vector<GLfloat> vtx;
+	static std::vector<GLfloat> tex;
+	static std::vector<GLubyte> col;
 
-	const sf::Color& particle_colour = Env.ParticleColor();
-	glColor(particle_colour, particle_colour.a * alpha);
-
-	draw_billboard(ctrl, cur_size, cur_size, false, tex_coords[type]);
-}
+	if (particles.count == 0)
+		return;
 
-void Particle::draw_billboard(const CControl *ctrl, double width, double height, bool use_world_y_axis, const GLfloat* tex) const {
-	TVector3d x_vec;
-	TVector3d y_vec;
-	TVector3d z_vec;
+	const float xx = ctrl->view_mat[0][0], xy = ctrl->view_mat[0][1], xz = ctrl->view_mat[0][2];
+	const float yx = ctrl->view_mat[1][0], yy = ctrl->view_mat[1][1], yz = ctrl->view_mat[1][2];
+	const sf::Color& particle_colour = Env.ParticleColor();
 
-	x_vec.x = ctrl->view_mat[0][0];
-	x_vec.y = ctrl->view_mat[0][1];
-	x_vec.z = ctrl->view_mat[0][2];
+	vtx.resize(particles.count * 12);
+	tex.resize(particles.count * 8);
+	col.resize(particles.count * 16);
+	std::size_t num = 0;
+	for (std::size_t i = 0; i < particles.count; i++) {
+		if (particles.age[i] < 0)
+			continue;
+		const float half = particles.cur_size[i] * 0.5f;
+		TVector3d pt(particles.x[i], particles.y[i], particles.z[i]);
+		if (!sphere_in_view_frustum(pt, half * 1.415f))
+			continue;
 
-	if (use_world_y_axis) {
-		y_vec = TVector3d(0, 1, 0);
-		x_vec = ProjectToPlane(y_vec, x_vec);
-		x_vec.Norm();
-		z_vec = CrossProduct(x_vec, y_vec);
-	} else {
-		y_vec.x = ctrl->view_mat[1][0];
-		y_vec.y = ctrl->view_mat[1][1];
-		y_vec.z = ctrl->view_mat[1][2];
-		z_vec.x = ctrl->view_mat[2][0];
-		z_vec.y = ctrl->view_mat[2][1];
-		z_vec.z = ctrl->view_mat[2][2];
+		// corners: -x-y, +x-y, +x+y, -x+y
+		const float ax = half * (xx + yx), ay = half * (xy + yy), az = half * (xz + yz);
+		const float bx = half * (xx - yx), by = half * (xy - yy), bz = half * (xz - yz);
+		GLfloat* v = &vtx[num * 12];
+		v[0] = particles.x[i] - ax; v[1] = particles.y[i] - ay; v[2] = particles.z[i] - az;
+		v[3] = particles.x[i] + bx; v[4] = particles.y[i] + by; v[5] = particles.z[i] + bz;
+		v[6] = particles.x[i] + ax; v[7] = particles.y[i] + ay; v[8] = particles.z[i] + az;
+		v[9] = particles.x[i] - bx; v[10] = particles.y[i] - by; v[11] = particles.z[i] - bz;
+
+		std::copy(tex_coords[particles.type[i]], tex_coords[particles.type[i]] + 8, &tex[num * 8]);
+
+		GLubyte alpha = static_cast<GLubyte>(particle_colour.a * particles.alpha[i]);
+		GLubyte* c = &col[num * 16];
+		for (int k = 0; k < 4; k++) {
+			c[k*4] = particle_colour.r;
+			c[k*4+1] = particle_colour.g;
+			c[k*4+2] = particle_colour.b;
+			c[k*4+3] = alpha;
+		}
+		num++;
 	}
+	if (num == 0)
+		return;
 
-	TVector3d pt1 = pt - width/2.0 * x_vec - height/2.0 * y_vec;
-	TVector3d pt2 = pt1 + width * x_vec;
-	TVector3d pt3 = pt2 + height * y_vec;
-	TVector3d pt4 = pt3 + -width * x_vec;
-	const GLfloat vtx[] = {
-		static_cast<GLfloat>(pt1.x),
-		static_cast<GLfloat>(pt1.y),
-		static_cast<GLfloat>(pt1.z),
-		static_cast<GLfloat>(pt2.x),
-		static_cast<GLfloat>(pt2.y),
-		static_cast<GLfloat>(pt2.z),
-		static_cast<GLfloat>(pt3.x),
-		static_cast<GLfloat>(pt3.y),
-		static_cast<GLfloat>(pt3.z),
-		static_cast<GLfloat>(pt4.x),
-		static_cast<GLfloat>(pt4.y),
-		static_cast<GLfloat>(pt4.z),
-	};
+	ScopedRenderMode rm(PARTICLES);
+	Tex.BindTex(SNOW_PART);
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
 
-	glVertexPointer(3, GL_FLOAT, 0, vtx);
-	glTexCoordPointer(2, GL_FLOAT, 0, tex);
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	glVertexPointer(3, GL_FLOAT, 0, &vtx[0]);
+	glTexCoordPointer(2, GL_FLOAT, 0, &tex[0]);
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, &col[0]);
+	glDrawArrays(GL_QUADS, 0, (GLsizei)(num * 4));
 
+	glDisableClientState(GL_COLOR_ARRAY);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glDisableClientState(GL_VERTEX_ARRAY);
 }
 
-void create_new_particles(const TVector3d& loc, const TVector3d& vel, std::size_t num) {
-	double speed = vel.Length();
-
-	if (particles.size() + num > MAX_PARTICLES) {
-		Message("maximum number of particles exceeded");
-	}
-	for (std::size_t i=0; i<num; i++) {
-		particles.emplace_back();
-		Particle* newp = &particles.back();
-		newp->pt.x = loc.x + 2.*(FRandom() - 0.5) * START_RADIUS;
-		newp->pt.y = loc.y;
-		newp->pt.z = loc.z + 2.*(FRandom() - 0.5) * START_RADIUS;
-		newp->type = std::rand() % 4;
-		newp->base_size = (FRandom() + 0.5) * OLD_PART_SIZE;
-		newp->cur_size = NEW_PART_SIZE;
-		newp->age = FRandom() * MIN_AGE;
-		newp->death = FRandom() * MAX_AGE;
-		newp->vel = vel +
-		            TVector3d(VARIANCE_FACTOR * (FRandom() - 0.5) * speed,
-		                      VARIANCE_FACTOR * (FRandom() - 0.5) * speed,
-		                      VARIANCE_FACTOR * (FRandom() - 0.5) * speed);
-	}
-}
-void update_particles(float time_step) {
-	for (std::list<Particle>::iterator p = particles.begin(); p != particles.end();) {
-		p->age += time_step;
-		if (p->age < 0) {
-			++p;
-			continue;
-		}
-
-		p->pt += static_cast<double>(time_step) * p->vel;
-		double ycoord = Course.FindYCoord(p->pt.x, p->pt.z);
-		if (p->pt.y < ycoord - 3)
-			p->age = p->death + 1;
-		if (p->age >= p->death) {
-			p = particles.erase(p);
-			continue;
-		}
-		p->alpha = (p->death - p->age) / p->death;
-		p->cur_size = NEW_PART_SIZE +
-		              (OLD_PART_SIZE - NEW_PART_SIZE) * (p->age / p->death);
-		p->vel.y += -EARTH_GRAV * time_step;
-		++p;
-	}
-}
-void draw_particles(const CControl *ctrl) {
-	if (particles.empty())
-		return;
-
-	ScopedRenderMode rm(PARTICLES);
-	Tex.BindTex(SNOW_PART);
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	glColor4f(1.f, 1.f, 1.f, 0.8f);
-
-	for (std::list<Particle>::const_iterator p = particles.begin(); p != particles.end(); ++p) {
-		if (p->age >= 0)
-			p->Draw(ctrl);
-	}
-}
 void clear_particles() {
-	particles.clear();
+	particles.count = 0;
 }
 
 static double adjust_particle_count(double count) {
 	if (count < 1) {
-		if (((double)std::rand()) / RAND_MAX < count) return 1.0;
+		if (random_gen.Frac() < count) return 1.0;
 		else return 0.0;
 	} else return count;
 }
 
 void generate_particles(const CControl *ctrl, double dtime, const TVector3d& pos, double speed) {
-	double surf_y = Course.FindYCoord(pos.x, pos.z);
+	const CCourse& course = *ctrl->ctx->course;
+	TSurfaceSample surf = course.SampleSurface(pos.x, pos.z);
+	double surf_y = surf.elevation;
 
-	int id = Course.GetTerrainIdx(pos.x, pos.z, 0.5);
-	if (id >= 0 && Course.TerrList[id].particles && pos.y < surf_y) {
+	int id = surf.TerrainIdx(0.5);
+	if (id >= 0 && course.TerrList[id].particles && pos.y < surf_y) {
 		TVector3d xvec = CrossProduct(ctrl->cdirection, ctrl->plane_nml);
 
 		TVector3d right_part_pt = pos + TUX_WIDTH/2.0 * xvec;
@@ -545,16 +616,16 @@ void CFlakes::Reset() {
 }
 
 void CFlakes::MakeSnowFlake(std::size_t ar, std::size_t i) {
-	areas[ar].flakes[i].pt.x = XRandom(areas[ar].left, areas[ar].right);
-	areas[ar].flakes[i].pt.y = -XRandom(areas[ar].top, areas[ar].bottom);
-	areas[ar].flakes[i].pt.z = areas[ar].back - FRandom() * (areas[ar].back - areas[ar].front);
+	areas[ar].flakes[i].pt.x = random_gen.Range(areas[ar].left, areas[ar].right);
+	areas[ar].flakes[i].pt.y = -random_gen.Range(areas[ar].top, areas[ar].bottom);
+	areas[ar].flakes[i].pt.z = areas[ar].back - random_gen.Frac() * (areas[ar].back - areas[ar].front);
 
-	areas[ar].flakes[i].size = XRandom(areas[ar].minSize, areas[ar].maxSize);
+	areas[ar].flakes[i].size = random_gen.Range(areas[ar].minSize, areas[ar].maxSize);
 	areas[ar].flakes[i].vel.x = 0;
 	areas[ar].flakes[i].vel.z = 0;
 	areas[ar].flakes[i].vel.y = -areas[ar].flakes[i].size * areas[ar].speed;
 
-	int type = std::rand() % 4;
+	int type = random_gen.Int(0, 3);
 
 	static const GLfloat tex_coords[4][8] = {
 		{
@@ -699,8 +770,8 @@ TChange changes[NUM_CHANGES];
 
 void InitChanges() {
 	for (int i=0; i<NUM_CHANGES; i++) {
-		changes[i].min = XRandom(-0.15, -0.05);
-		changes[i].max = XRandom(0.05, 0.15);
+		changes[i].min = random_gen.Range(-0.15, -0.05);
+		changes[i].max = random_gen.Range(0.05, 0.15);
 		changes[i].curr = (changes[i].min + changes[i].max) / 2;
 		changes[i].step = CHANGE_SPEED;
 		changes[i].forward = true;
@@ -746,7 +817,7 @@ TCurtain::TCurtain(int num_rows, float z_dist, float tex_size,
 	lastangle = startangle + (numCols-1) * angledist;
 
 	for (unsigned int i=0; i<numRows; i++)
-		chg[i] = IRandom(0, 5);
+		chg[i] = random_gen.Int(0, 5);
 }
 
 void TCurtain::SetStartParams(const CControl* ctrl) {
@@ -927,6 +998,8 @@ CWind::CWind()
 	DestAngle = 0;
 	WindChange = 0;
 	AngleChange = 0;
+	WindId = 0;
+	Seed = 0;
 }
 
 void CWind::SetParams(int grade) {
@@ -1001,31 +1074,31 @@ void CWind::SetParams(int grade) {
 
 	float speed, var, angle;
 
-	speed = XRandom(min_base_speed, max_base_speed);
-	var = XRandom(min_speed_var, max_speed_var) / 2;
+	speed = rand_gen.Range(min_base_speed, max_base_speed);
+	var = rand_gen.Range(min_speed_var, max_speed_var) / 2;
 	params.minSpeed = speed - var;
 	params.maxSpeed = speed + var;
 	if (params.minSpeed < 0) params.minSpeed = 0;
 	if (params.maxSpeed > 100) params.maxSpeed = 100;
 
-	angle = XRandom(min_base_angle, max_base_angle);
-	if (XRandom(0, 100) > 50) angle = angle + alt_angle;
-	var = XRandom(min_angle_var, max_angle_var) / 2;
+	angle = rand_gen.Range(min_base_angle, max_base_angle);
+	if (rand_gen.Range(0, 100) > 50) angle = angle + alt_angle;
+	var = rand_gen.Range(min_angle_var, max_angle_var) / 2;
 	params.minAngle = angle - var;
 	params.maxAngle = angle + var;
 }
 
 void CWind::CalcDestSpeed() {
-	float rand = XRandom(0, 100);
+	float rand = rand_gen.Range(0, 100);
 	if (rand > (100 - params.topProbability)) {
-		DestSpeed = XRandom(params.maxSpeed, params.topSpeed);
+		DestSpeed = rand_gen.Range(params.maxSpeed, params.topSpeed);
 		WindChange = params.maxChange;
 	} else if (rand < params.nullProbability) {
 		DestSpeed = 0.0;
-		WindChange = XRandom(params.minChange, params.maxChange);
+		WindChange = rand_gen.Range(params.minChange, params.maxChange);
 	} else {
-		DestSpeed = XRandom(params.minSpeed, params.maxSpeed);
-		WindChange = XRandom(params.minChange, params.maxChange);
+		DestSpeed = rand_gen.Range(params.minSpeed, params.maxSpeed);
+		WindChange = rand_gen.Range(params.minChange, params.maxChange);
 	}
 
 	if (DestSpeed > WSpeed) SpeedMode = 1;
@@ -1033,8 +1106,8 @@ void CWind::CalcDestSpeed() {
 }
 
 void CWind::CalcDestAngle() {
-	DestAngle = XRandom(params.minAngle, params.maxAngle);
-	AngleChange = XRandom(params.minAngleChange, params.maxAngleChange);
+	DestAngle = rand_gen.Range(params.minAngle, params.maxAngle);
+	AngleChange = rand_gen.Range(params.minAngleChange, params.maxAngleChange);
 
 	if (DestAngle > WAngle) AngleMode = 1;
 	else AngleMode = 0;
@@ -1084,27 +1157,37 @@ void CWind::Update(float timestep) {
 	}
 }
 
-void CWind::Init(int wind_id) {
+void CWind::Init(int wind_id, uint32_t seed) {
+	WindId = wind_id;
+	Seed = seed;
+	rand_gen.Seed(seed);
+	CurrTime = 0.f;
+	WVector = TVector3d(0, 0, 0);	// until the first Update
 	if (wind_id < 1 || wind_id > 3) {
 		windy = false;
-		WVector = TVector3d(0, 0, 0);
 		WAngle = 0;
 		WSpeed = 0;
 		return;
 	}
 	windy = true;;
 	SetParams(wind_id -1);
-	WSpeed = XRandom(params.minSpeed, (params.minSpeed + params.maxSpeed) / 2);
-	WAngle = XRandom(params.minAngle, params.maxAngle);
+	WSpeed = rand_gen.Range(params.minSpeed, (params.minSpeed + params.maxSpeed) / 2);
+	WAngle = rand_gen.Range(params.minAngle, params.maxAngle);
 	CalcDestSpeed();
 	CalcDestAngle();
 }
 
+// Starts the wind of the last Init over, as at the begin of the race
+void CWind::Restart() {
+	Init(WindId, Seed);
+}
+
 // ====================================================================
 //			access functions
 // ====================================================================
 
 void InitSnow(const CControl *ctrl) {
+	random_gen.Seed(g_game.seed);
 	if (g_game.snow_id < 1 || g_game.snow_id > 3) return;
 	Flakes.Init(g_game.snow_id, ctrl);
 	Curtain.Init(ctrl);
@@ -1123,7 +1206,7 @@ void DrawSnow(const CControl *ctrl) {
 }
 
 void InitWind() {
-	Wind.Init(g_game.wind_id);
+	Wind.Init(g_game.wind_id, g_game.seed);
 }
 
 void UpdateWind(float timestep) {
@@ -22,6 +22,8 @@ GNU General Public License for more details.
 #include "mathlib.h"
 #include <vector>
 
+class CCourse;
+
 // --------------------------------------------------------------------
 //					snow for menu screens
 // --------------------------------------------------------------------
@@ -35,7 +37,7 @@ void draw_ui_snow();
 //					snow particles during race
 // --------------------------------------------------------------------
 
-void update_particles(float time_step);
+void update_particles(const CCourse& course, float time_step);
 void clear_particles();
 void draw_particles(const CControl *ctrl);
 void generate_particles(const CControl *ctrl, double dtime, const TVector3d& pos, double speed);
@@ -201,6 +203,9 @@ private:
 	float DestAngle;
 	float WindChange;
 	float AngleChange;
+	int WindId;
+	uint32_t Seed;
+	CRandom rand_gen;
 
 	void SetParams(int grade);
 	void CalcDestSpeed();
@@ -209,7 +214,8 @@ public:
 	CWind();
 
 	void Update(float timestep);
-	void Init(int wind_id);
+	void Init(int wind_id, uint32_t seed);
+	void Restart();
 	bool Windy() const { return windy; }
 	float Angle() const { return WAngle; }
 	float Speed() const { return WSpeed; }
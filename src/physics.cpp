@@ -22,13 +22,11 @@ GNU General Public License for more details.
 #include "physics.h"
 #include "course.h"
 #include "tux.h"
-#include "audio.h"
 #include "particles.h"
-#include "game_ctrl.h"
-#include "game_over.h"
 #include <algorithm>
 
-CControl::CControl() :
+CControl::CControl(TSimContext* ctx) :
+	ctx(ctx),
 	cnet_force(0, 0, 0) {
 	minSpeed = 0;
 	minFrictspeed = 0;
@@ -51,8 +49,13 @@ CControl::CControl() :
 	flip_factor = 0;
 
 	ode_time_step = -1;
+	integrator = INTEGRATE_ODE23;
 	jump_start_time = 0;
+	charge_start_time = 0;
 	begin_jump = false;
+	last_collision = false;
+	last_collision_tree_loc = TVector3d(-999, -999, -999);
+	last_collision_pos = TVector3d(-999, -999, -999);
 	paddle_time = 0;
 	view_init = false;
 	finish_speed = 0;
@@ -65,7 +68,8 @@ CControl::CControl() :
 // --------------------------------------------------------------------
 
 void CControl::Init() {
-	TVector3d nml = Course.FindCourseNormal(cpos.x, cpos.z);
+	TSurfaceSample surf = ctx->course->SampleSurface(cpos.x, cpos.z);
+	TVector3d nml = surf.normal;
 	TMatrix<4, 4> rotMat;
 	rotMat.SetRotationMatrix(-90.0, 'x');
 	TVector3d init_vel = TransformVector(rotMat, nml);
@@ -78,7 +82,8 @@ void CControl::Init() {
 	is_paddling = false;
 	jumping = false;
 	jump_charging = false;
-	cpos.y = Course.FindYCoord(cpos.x, cpos.z);
+	begin_jump = false;
+	cpos.y = surf.elevation;
 	cvel = init_vel;
 	last_pos = cpos;
 	cnet_force = TVector3d(0, 0, 0);
@@ -97,17 +102,15 @@ void CControl::Init() {
 	flip_factor = 0;
 
 	ode_time_step = -1;
+	last_collision = false;
+	last_collision_tree_loc = TVector3d(-999, -999, -999);
+	last_collision_pos = TVector3d(-999, -999, -999);
 }
 // --------------------------------------------------------------------
 //					collision
 // --------------------------------------------------------------------
 
-bool CControl::CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) const {
-	// These variables are used to cache collision detection results
-	static bool last_collision = false;
-	static TVector3d last_collision_tree_loc(-999, -999, -999);
-	static TVector3d last_collision_pos(-999, -999, -999);
-
+bool CControl::CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) {
 	TVector3d dist_vec = pos - last_collision_pos;
 	if (MAG_SQD(dist_vec) < COLL_TOLERANCE) {
 		if (last_collision && !cairborne) {
@@ -120,27 +123,37 @@ bool CControl::CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) co
 	bool hit = false;
 	TMatrix<4, 4> mat;
 
-	for (std::size_t i = 0; i<Course.CollArr.size(); i++) {
-		double diam = Course.CollArr[i].diam;
-		double height = Course.CollArr[i].height;
-		loc = Course.CollArr[i].pt;
-		TVector3d distvec(loc.x - pos.x, 0.0, loc.z - pos.z);
+	// only the trees in the grid cells around the player are candidates;
+	// they are visited in array order like a full scan would do
+	candidates.clear();
+	ctx->course->CollGrid.Query(pos.x, pos.z, 0.6, [&](uint32_t i) {
+		const TCollidable& tree = ctx->course->CollArr[i];
+		TVector3d distvec(tree.pt.x - pos.x, 0.0, tree.pt.z - pos.z);
 
 		// check distance from tree; .6 is the radius of a bounding sphere
-		double squared_dist = (diam / 2.0 + 0.6);
+		double squared_dist = (tree.diam / 2.0 + 0.6);
 		squared_dist *= squared_dist;
-		if (MAG_SQD(distvec) > squared_dist) continue;
-
-		TPolyhedron ph2 = Course.GetPoly(Course.CollArr[i].tree_type);
+		if (MAG_SQD(distvec) <= squared_dist)
+			candidates.push_back(i);
+	});
+	std::sort(candidates.begin(), candidates.end());
+
+	for (std::size_t c = 0; c < candidates.size(); c++) {
+		std::size_t i = candidates[c];
+		double diam = ctx->course->CollArr[i].diam;
+		double height = ctx->course->CollArr[i].height;
+		loc = ctx->course->CollArr[i].pt;
+
+		TPolyhedron ph2 = ctx->course->GetPoly(ctx->course->CollArr[i].tree_type);
 		mat.SetScalingMatrix(diam, height, diam);
 		TransPolyhedron(mat, ph2);
 		mat.SetTranslationMatrix(loc.x, loc.y, loc.z);
 		TransPolyhedron(mat, ph2);
 
-		hit = g_game.character->shape->Collision(pos, ph2);
+		hit = ctx->shape->Collision(pos, ph2);
 		if (hit == true) {
 			if (tree_loc != nullptr) *tree_loc = loc;
-			Sound.Play("tree_hit", 0);
+			ctx->events->TreeHit();
 			break;
 		}
 	}
@@ -152,7 +165,7 @@ bool CControl::CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) co
 	return hit;
 }
 
-void CControl::AdjustTreeCollision(const TVector3d& pos, TVector3d *vel) const {
+void CControl::AdjustTreeCollision(const TVector3d& pos, TVector3d *vel) {
 	TVector3d treeLoc;
 
 	if (CheckTreeCollisions(pos, &treeLoc)) {
@@ -179,24 +192,24 @@ void CControl::AdjustTreeCollision(const TVector3d& pos, TVector3d *vel) const {
 }
 
 void CControl::CheckItemCollection(const TVector3d& pos) {
-	std::size_t num_items = Course.NocollArr.size();
-
-	for (std::size_t i=0; i<num_items; i++) {
-		if (Course.NocollArr[i].collectable != 1) continue;
-
-		double diam = Course.NocollArr[i].diam;
-		const TVector3d& loc = Course.NocollArr[i].pt;
+	candidates.clear();
+	ctx->course->CollectGrid.Query(pos.x, pos.z, 0.7, [&](uint32_t i) {
+		double diam = ctx->course->NocollArr[i].diam;
+		const TVector3d& loc = ctx->course->NocollArr[i].pt;
 
 		TVector3d distvec(loc.x - pos.x, loc.y - pos.y, loc.z - pos.z);
 		double squared_dist = (diam / 2. + 0.7);
 		squared_dist *= squared_dist;
 		if (MAG_SQD(distvec) <= squared_dist) {  // Check collision using a bounding sphere
-			Course.NocollArr[i].collectable = 0;
-			g_game.herring += 1;
-			Sound.Play("pickup1", 0);
-			Sound.Play("pickup2", 0);
-			Sound.Play("pickup3", 0);
+			candidates.push_back(i);
 		}
+	});
+
+	// removing items from the index is deferred until the query is done
+	for (std::size_t c = 0; c < candidates.size(); c++) {
+		ctx->course->CollectItem(candidates[c]);
+		ctx->herring += 1;
+		ctx->events->ItemCollected();
 	}
 }
 // --------------------------------------------------------------------
@@ -208,9 +221,9 @@ void CControl::AdjustVelocity() {
 	speed = std::max(minSpeed, speed);
 	cvel *= speed;
 
-	if (g_game.finish == true) {
+	if (ctx->finish == true) {
 /// --------------- finish ------------------------------------
-		if (speed < 3) State::manager.RequestEnterState(GameOver);
+		if (speed < 3) ctx->events->RaceOver();
 /// -----------------------------------------------------------
 	}
 }
@@ -223,23 +236,24 @@ void CControl::AdjustPosition(const TPlane& surf_plane, double dist_from_surface
 }
 
 void CControl::SetTuxPosition(double speed) {
-	CCharShape *shape = g_game.character->shape;
+	CCharShape *shape = ctx->shape;
 
-	TVector2d playSize = Course.GetPlayDimensions();
-	TVector2d courseSize = Course.GetDimensions();
+	TVector2d playSize = ctx->course->GetPlayDimensions();
+	TVector2d courseSize = ctx->course->GetDimensions();
 	double boundaryWidth = (courseSize.x - playSize.x) / 2;
 	if (cpos.x < boundaryWidth) cpos.x = boundaryWidth;
 	if (cpos.x > courseSize.x - boundaryWidth) cpos.x = courseSize.x - boundaryWidth;
 	if (cpos.z > 0) cpos.z = 0;
 
-	if (g_game.finish == false) {
+	if (ctx->finish == false) {
 /// ------------------- finish --------------------------------
 		if (-cpos.z >= playSize.y) {
-			if (g_game.use_keyframe) {
-				g_game.finish = true;
+			ctx->events->Finish();
+			if (ctx->course->UseKeyframe()) {
+				ctx->finish = true;
 				finish_speed = speed;
 //				SetStationaryCamera (true);
-			} else State::manager.RequestEnterState(GameOver);
+			} else ctx->events->RaceOver();
 		}
 /// -----------------------------------------------------------
 	}
@@ -271,8 +285,8 @@ const double airdrag[] = {2.25, 1.35, 0.6, 0, -0.35, -0.45, -0.33, -0.9};
 
 TVector3d CControl::CalcAirForce() {
 	TVector3d windvec = -ff.vel;
-	if (g_game.wind_id > 0)
-		windvec += WIND_FACTOR * Wind.WindDrift();
+	if (ctx->wind->Windy())
+		windvec += WIND_FACTOR * ctx->wind->WindDrift();
 
 	double windspeed = windvec.Length();
 	double re = 34600 * windspeed;
@@ -307,10 +321,10 @@ TVector3d CControl::CalcJumpForce() {
 		begin_jump = false;
 		if (cairborne == false) {
 			jumping = true;
-			jump_start_time = g_game.time;
+			jump_start_time = ctx->time;
 		} else jumping = false;
 	}
-	if ((jumping) && (g_game.time - jump_start_time < JUMP_FORCE_DURATION)) {
+	if ((jumping) && (ctx->time - jump_start_time < JUMP_FORCE_DURATION)) {
 		double y = 294 + jump_amt * 294; // jump_amt goes from 0 to 1
 		jumpforce.y = y;
 
@@ -321,7 +335,7 @@ TVector3d CControl::CalcJumpForce() {
 }
 
 TVector3d CControl::CalcFrictionForce(double speed, const TVector3d& nmlforce) {
-	if ((cairborne == false && speed > minFrictspeed) || g_game.finish) {
+	if ((cairborne == false && speed > minFrictspeed) || ctx->finish) {
 		double fric_f_mag = nmlforce.Length() * ff.frict_coeff;
 		fric_f_mag = std::min(MAX_FRICT_FORCE, fric_f_mag);
 		TVector3d frictforce = fric_f_mag * ff.frictdir;
@@ -340,7 +354,7 @@ TVector3d CControl::CalcFrictionForce(double speed, const TVector3d& nmlforce) {
 }
 
 TVector3d CControl::CalcBrakeForce(double speed) {
-	if (g_game.finish == false) {
+	if (ctx->finish == false) {
 		if (cairborne == false && speed > minFrictspeed) {
 			if (speed > minSpeed && is_braking) {
 				return ff.frict_coeff * BRAKE_FORCE * ff.frictdir;
@@ -351,7 +365,7 @@ TVector3d CControl::CalcBrakeForce(double speed) {
 /// ------------------- finish --------------------------------
 		if (cairborne == false) {
 			is_braking = true;
-			return finish_speed * g_game.finish_brake * ff.frictdir;
+			return finish_speed * ctx->course->GetFinishBrake() * ff.frictdir;
 		} else {
 			return finish_speed * FIN_AIR_BRAKE * ff.frictdir;
 		}
@@ -363,7 +377,7 @@ TVector3d CControl::CalcBrakeForce(double speed) {
 TVector3d CControl::CalcPaddleForce(double speed) {
 	TVector3d paddleforce(0, 0, 0);
 	if (is_paddling)
-		if (g_game.time - paddle_time >= PADDLING_DURATION) is_paddling = false;
+		if (ctx->time - paddle_time >= PADDLING_DURATION) is_paddling = false;
 
 	if (is_paddling) {
 		if (cairborne) {
@@ -380,7 +394,7 @@ TVector3d CControl::CalcPaddleForce(double speed) {
 }
 
 TVector3d CControl::CalcGravitationForce() {
-	if (g_game.finish == false) {
+	if (ctx->finish == false) {
 		return TVector3d(0, -EARTH_GRAV * TUX_MASS, 0);
 	} else {
 /// ---------------- finish -----------------------------------
@@ -400,17 +414,11 @@ TVector3d CControl::CalcNetForce(const TVector3d& pos, const TVector3d& vel) {
 	double speed = ff.frictdir.Norm();
 	ff.frictdir *= -1.0;
 
-	static std::vector<double> surfweights;
-	if (surfweights.size() != Course.TerrList.size())
-		surfweights.resize(Course.TerrList.size());
-	Course.GetSurfaceType(ff.pos.x, ff.pos.z, &surfweights[0]);
-	ff.frict_coeff = ff.comp_depth = 0;
-	for (std::size_t i=0; i<Course.TerrList.size(); i++) {
-		ff.frict_coeff += surfweights[i] * Course.TerrList[i].friction;
-		ff.comp_depth += surfweights[i] * Course.TerrList[i].depth;
-	}
+	TSurfaceSample surf = ctx->course->SampleSurface(ff.pos.x, ff.pos.z);
+	ff.frict_coeff = surf.friction;
+	ff.comp_depth = surf.depth;
 
-	TPlane surfplane = Course.GetLocalCoursePlane(ff.pos);
+	TPlane surfplane = surf.Plane(ff.pos.x, ff.pos.z);
 	ff.surfnml = surfplane.nml;
 	ff.rollnml = CalcRollNormal(speed);
 	ff.surfdistance = DistanceToPlane(surfplane, ff.pos);
@@ -439,24 +447,27 @@ double CControl::AdjustTimeStep(double h, const TVector3d& vel) {
 	return h;
 }
 
+static inline TVector3d Acceleration(const TVector3d& force) {
+	return TVector3d(force.x / TUX_MASS, force.y / TUX_MASS, force.z / TUX_MASS);
+}
+
 void CControl::SolveOdeSystem(double timestep) {
-	double pos_err[3], vel_err[3], tot_pos_err, tot_vel_err;
+	if (integrator == INTEGRATE_RK4)
+		IntegrateOde<TOdeRK4>(timestep);
+	else
+		IntegrateOde<TOde23>(timestep);
+}
+
+template<typename Method>
+void CControl::IntegrateOde(double timestep) {
 	double err=0, tol=0;
 
-	static const TOdeSolver solver;
 	double h = ode_time_step;
-	if (h < 0 || solver.EstimateError == nullptr)
+	if (h < 0 || !Method::Adaptive)
 		h = AdjustTimeStep(timestep, cvel);
 	double t = 0;
 	double tfinal = timestep;
 
-	TOdeData x;
-	TOdeData y;
-	TOdeData z;
-	TOdeData vx;
-	TOdeData vy;
-	TOdeData vz;
-
 	TVector3d new_pos = cpos;
 	TVector3d new_vel = cvel;
 	TVector3d new_f   = cnet_force;
@@ -477,67 +488,20 @@ void CControl::SolveOdeSystem(double timestep) {
 
 		bool failed = false;
 		for (;;) {
-			solver.InitOdeData(&x, new_pos.x, h);
-			solver.InitOdeData(&y, new_pos.y, h);
-			solver.InitOdeData(&z, new_pos.z, h);
-			solver.InitOdeData(&vx, new_vel.x, h);
-			solver.InitOdeData(&vy, new_vel.y, h);
-			solver.InitOdeData(&vz, new_vel.z, h);
-
-			solver.UpdateEstimate(&x, 0, new_vel.x);
-			solver.UpdateEstimate(&y, 0, new_vel.y);
-			solver.UpdateEstimate(&z, 0, new_vel.z);
-			solver.UpdateEstimate(&vx, 0, new_f.x / TUX_MASS);
-			solver.UpdateEstimate(&vy, 0, new_f.y / TUX_MASS);
-			solver.UpdateEstimate(&vz, 0, new_f.z / TUX_MASS);
-
-			for (int i=1; i < solver.NumEstimates(); i++) {
-				new_pos.x = solver.NextValue(&x, i);
-				new_pos.y = solver.NextValue(&y, i);
-				new_pos.z = solver.NextValue(&z, i);
-				new_vel.x = solver.NextValue(&vx, i);
-				new_vel.y = solver.NextValue(&vy, i);
-				new_vel.z = solver.NextValue(&vz, i);
-
-				solver.UpdateEstimate(&x, i, new_vel.x);
-				solver.UpdateEstimate(&y, i, new_vel.y);
-				solver.UpdateEstimate(&z, i, new_vel.z);
+			TOdeStep<Method> step(new_pos, new_vel, h);
+			step.UpdateEstimate(0, new_vel, Acceleration(new_f));
 
+			for (int i=1; i < Method::NumEstimates; i++) {
+				step.NextValue(i, new_pos, new_vel);
 				new_f = CalcNetForce(new_pos, new_vel);
-
-				solver.UpdateEstimate(&vx, i, new_f.x / TUX_MASS);
-				solver.UpdateEstimate(&vy, i, new_f.y / TUX_MASS);
-				solver.UpdateEstimate(&vz, i, new_f.z / TUX_MASS);
+				step.UpdateEstimate(i, new_vel, Acceleration(new_f));
 			}
 
-			new_pos.x = solver.FinalEstimate(&x);
-			new_pos.y = solver.FinalEstimate(&y);
-			new_pos.z = solver.FinalEstimate(&z);
-
-			new_vel.x = solver.FinalEstimate(&vx);
-			new_vel.y = solver.FinalEstimate(&vy);
-			new_vel.z = solver.FinalEstimate(&vz);
+			step.FinalEstimate(new_pos, new_vel);
 
-			if (solver.EstimateError != nullptr) {
-				pos_err[0] = solver.EstimateError(&x);
-				pos_err[1] = solver.EstimateError(&y);
-				pos_err[2] = solver.EstimateError(&z);
-
-				vel_err[0] = solver.EstimateError(&vx);
-				vel_err[1] = solver.EstimateError(&vy);
-				vel_err[2] = solver.EstimateError(&vz);
-
-				tot_pos_err = 0.;
-				tot_vel_err = 0.;
-
-				for (int i=0; i<3; i++) {
-					pos_err[i] *= pos_err[i];
-					tot_pos_err += pos_err[i];
-					vel_err[i] *= vel_err[i];
-					tot_vel_err += vel_err[i];
-				}
-				tot_pos_err = std::sqrt(tot_pos_err);
-				tot_vel_err = std::sqrt(tot_vel_err);
+			if (Method::Adaptive) {
+				double tot_pos_err, tot_vel_err;
+				step.EstimateError(tot_pos_err, tot_vel_err);
 				if (tot_pos_err / MAX_POS_ERR > tot_vel_err / MAX_VEL_ERR) {
 					err = tot_pos_err;
 					tol = MAX_POS_ERR;
@@ -550,7 +514,7 @@ void CControl::SolveOdeSystem(double timestep) {
 					done = false;
 					if (!failed) {
 						failed = true;
-						h *=  std::max(0.5, 0.8 * std::pow(tol/err, solver.TimestepExponent()));
+						h *=  std::max(0.5, 0.8 * std::pow(tol/err, Method::TimestepExponent));
 					} else h *= 0.5;
 
 					h = AdjustTimeStep(h, saved_vel);
@@ -563,12 +527,12 @@ void CControl::SolveOdeSystem(double timestep) {
 
 		t = t + h;
 		double speed = new_vel.Length();
-		if (param.perf_level > 2) generate_particles(this, h, new_pos, speed);
+		ctx->events->Spray(this, h, new_pos, speed);
 
 		new_f = CalcNetForce(new_pos, new_vel);
 
-		if (!failed && solver.EstimateError != nullptr) {
-			double temp = 1.25 * std::pow(err / tol, solver.TimestepExponent());
+		if (!failed && Method::Adaptive) {
+			double temp = 1.25 * std::pow(err / tol, Method::TimestepExponent);
 			if (temp > 0.2) h = h / temp;
 			else h = 5.0 * h;
 		}
@@ -593,12 +557,12 @@ void CControl::SolveOdeSystem(double timestep) {
 // --------------------------------------------------------------------
 
 void CControl::UpdatePlayerPos(float timestep) {
-	CCharShape *shape = g_game.character->shape;
+	CCharShape *shape = ctx->shape;
 	double paddling_factor;
 	double flap_factor;
 	double dist_from_surface;
 
-	if (g_game.finish) {
+	if (ctx->finish) {
 /// --------------------- finish ------------------------------
 		minSpeed = 0;
 		minFrictspeed = 0;
@@ -610,7 +574,7 @@ void CControl::UpdatePlayerPos(float timestep) {
 
 	if (timestep > 2 * EPS) SolveOdeSystem(timestep);
 
-	TPlane surf_plane = Course.GetLocalCoursePlane(cpos);
+	TPlane surf_plane = ctx->course->GetLocalCoursePlane(cpos);
 	TVector3d surf_nml = surf_plane.nml; // normal vector of terrain
 	dist_from_surface = DistanceToPlane(surf_plane, cpos);
 
@@ -623,7 +587,7 @@ void CControl::UpdatePlayerPos(float timestep) {
 	flap_factor = 0;
 	if (is_paddling) {
 		double factor;
-		factor = (g_game.time - paddle_time) / PADDLING_DURATION;
+		factor = (ctx->time - paddle_time) / PADDLING_DURATION;
 		if (cairborne) {
 			paddling_factor = 0;
 			flap_factor = factor;
@@ -639,7 +603,7 @@ void CControl::UpdatePlayerPos(float timestep) {
 	                        (ConjugateQuaternion(corientation), cnet_force);
 
 	if (jumping)
-		flap_factor = (g_game.time - jump_start_time) / JUMP_FORCE_DURATION;
+		flap_factor = (ctx->time - jump_start_time) / JUMP_FORCE_DURATION;
 
 	shape->AdjustJoints(turn_animation, is_braking, paddling_factor, speed,
 	                    local_force, flap_factor);
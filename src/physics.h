@@ -20,6 +20,7 @@ GNU General Public License for more details.
 
 #include "bh.h"
 #include "mathlib.h"
+#include "sim_context.h"
 
 #define MAX_PADDLING_SPEED (60.0 / 3.6)
 #define PADDLE_FACT 1.0
@@ -62,6 +63,12 @@ GNU General Public License for more details.
 #define FIN_AIR_BRAKE 20
 #define FIN_BRAKE 12
 
+// the ODE solver UpdatePlayerPos uses; the replays are recorded with ODE23
+enum TIntegrator {
+	INTEGRATE_ODE23,	// adaptive time step (Bogacki-Shampine)
+	INTEGRATE_RK4		// fixed time step (classic Runge-Kutta)
+};
+
 struct TForce {
 	TVector3d surfnml;
 	TVector3d rollnml;
@@ -81,9 +88,16 @@ private:
 	double ode_time_step;
 	double finish_speed;
 
-	bool CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) const;
-	void AdjustTreeCollision(const TVector3d& pos, TVector3d *vel) const;
-	static void CheckItemCollection(const TVector3d& pos);
+	// result of the last tree collision test, reused for nearby positions
+	bool last_collision;
+	TVector3d last_collision_tree_loc;
+	TVector3d last_collision_pos;
+	// of the tree and item tests, kept between substeps
+	std::vector<uint32_t> candidates;
+
+	bool CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc);
+	void AdjustTreeCollision(const TVector3d& pos, TVector3d *vel);
+	void CheckItemCollection(const TVector3d& pos);
 
 	TVector3d CalcRollNormal(double speed);
 	TVector3d CalcAirForce();
@@ -101,8 +115,12 @@ private:
 	void     SetTuxPosition(double speed);
 	double   AdjustTimeStep(double h, const TVector3d& vel);
 	void     SolveOdeSystem(double timestep);
+	template<typename Method>
+	void     IntegrateOde(double timestep);
 public:
-	CControl();
+	explicit CControl(TSimContext* ctx);
+
+	TSimContext* ctx;	// the race the player takes part in
 
 	// view:
 	TVector3d viewpos;
@@ -130,6 +148,7 @@ public:
 	double paddle_time;
 	double jump_amt;
 	double jump_start_time;
+	double charge_start_time;
 	bool   is_paddling;
 	bool   is_braking;
 	bool   begin_jump;
@@ -150,6 +169,8 @@ public:
 	double minSpeed;
 	double minFrictspeed;
 
+	TIntegrator integrator;
+
 	void Init();
 	void UpdatePlayerPos(float timestep);
 };
@@ -7,9 +7,17 @@
 #include "textures.h"
 #include "course.h"
 #include "ogl.h"
+#include "terrain_shader.h"
+#include "spx.h"
+#include "thread_pool.h"
 
 #include <climits>
+#include <cfloat>
 #include <cstring>
+#include <new>
+#include <vector>
+#include <mutex>
+#include <atomic>
 
 #define TERRAIN_ERROR_SCALE 0.1f
 #define VERTEX_FORCE_THRESHOLD 100
@@ -17,50 +25,146 @@
 #define ERROR_MAGNIFICATION_AMOUNT 3
 #define ENV_MAP_ALPHA 50
 #define colorval(j,ch) \
-	VNCArray[j*STRIDE_GL_ARRAY+STRIDE_GL_ARRAY-4+(ch)]
+	ColArray[(j)*4+(ch)]
 
-#define setalphaval(i) colorval(VertexIndices[i], 3) = \
-	( terrain <= VertexTerrains[i] ) ? 255 : 0
+// Triangle index list of one render pass
+struct quadtrilist {
+	std::vector<GLuint> indices;
+	GLuint min_idx;
+	GLuint max_idx;
 
-#define update_min_max( idx ) \
-	if ( idx > VertexArrayMaxIdx ) { \
-		VertexArrayMaxIdx = idx; \
-	} \
-	if ( idx < VertexArrayMinIdx ) { \
-		VertexArrayMinIdx = idx; \
+	void Clear() {
+		indices.clear();
+		min_idx = INT_MAX;
+		max_idx = 0;
 	}
+	void Add(GLuint idx) {
+		indices.push_back(idx);
+		if (idx > max_idx) max_idx = idx;
+		if (idx < min_idx) min_idx = idx;
+	}
+	void Append(const quadtrilist& other) {
+		indices.insert(indices.end(), other.indices.begin(), other.indices.end());
+		if (other.max_idx > max_idx) max_idx = other.max_idx;
+		if (other.min_idx < min_idx) min_idx = other.min_idx;
+	}
+};
+
+// Per thread state of the triangle extraction. Every worker fills its
+// own lists, one per render pass.
+struct quadextract {
+	GLuint VertexIndices[9];
+	int VertexTerrains[9];
+	std::vector<quadtrilist> lists;
+
+	void Clear(std::size_t numPasses) {
+		lists.resize(numPasses);
+		for (std::size_t i = 0; i < numPasses; i++)
+			lists[i].Clear();
+	}
+};
 
-static void make_tri_list(void(*tri_func)(int, int, int, int), unsigned char EnabledFlags, int flags, int terrain) {
+typedef void(*tri_func_t)(const quadextract&, quadtrilist&, int, int, int, int);
+
+struct quadpass {
+	int terrain;
+	tri_func_t tri_func;
+};
+
+// The passes of the current frame, set up before the extraction starts
+static std::vector<quadpass> render_passes;
+
+static void make_tri_list(tri_func_t tri_func, const quadextract& ex, quadtrilist& list, unsigned char EnabledFlags, int flags, int terrain) {
 	if ((EnabledFlags & 1) == 0) {
-		tri_func(0, 2, 8, terrain);
+		tri_func(ex, list, 0, 2, 8, terrain);
 	} else {
-		if (flags & 8) tri_func(0, 1, 8, terrain);
-		if (flags & 1) tri_func(0, 2, 1, terrain);
+		if (flags & 8) tri_func(ex, list, 0, 1, 8, terrain);
+		if (flags & 1) tri_func(ex, list, 0, 2, 1, terrain);
 	}
 	if ((EnabledFlags & 2) == 0) {
-		tri_func(0, 4, 2, terrain);
+		tri_func(ex, list, 0, 4, 2, terrain);
 	} else {
-		if (flags & 1) tri_func(0, 3, 2, terrain);
-		if (flags & 2) tri_func(0, 4, 3, terrain);
+		if (flags & 1) tri_func(ex, list, 0, 3, 2, terrain);
+		if (flags & 2) tri_func(ex, list, 0, 4, 3, terrain);
 	}
 	if ((EnabledFlags & 4) == 0) {
-		tri_func(0, 6, 4, terrain);
+		tri_func(ex, list, 0, 6, 4, terrain);
 	} else {
-		if (flags & 2) tri_func(0, 5, 4, terrain);
-		if (flags & 4) tri_func(0, 6, 5, terrain);
+		if (flags & 2) tri_func(ex, list, 0, 5, 4, terrain);
+		if (flags & 4) tri_func(ex, list, 0, 6, 5, terrain);
 	}
 	if ((EnabledFlags & 8) == 0) {
-		tri_func(0, 8, 6, terrain);
+		tri_func(ex, list, 0, 8, 6, terrain);
 	} else {
-		if (flags & 4) tri_func(0, 7, 6, terrain);
-		if (flags & 8) tri_func(0, 8, 7, terrain);
+		if (flags & 4) tri_func(ex, list, 0, 7, 6, terrain);
+		if (flags & 8) tri_func(ex, list, 0, 8, 7, terrain);
 	}
 }
 
-GLuint *quadsquare::VertexArrayIndices = nullptr;
-GLuint quadsquare::VertexArrayCounter;
-GLuint quadsquare::VertexArrayMinIdx;
-GLuint quadsquare::VertexArrayMaxIdx;
+// --------------------------------------------------------------------
+//				node storage
+// --------------------------------------------------------------------
+
+// The nodes are taken from large blocks, so they lie close together in
+// memory. Deleted nodes are kept in a free list for reuse, and Reset drops
+// all nodes at once without visiting them. The blocks are kept for the
+// next course. The root children are updated on several threads, so the
+// nodes are handed out under a lock.
+class quadpool {
+	static const std::size_t BlockSize = 1024;
+	std::mutex mutex;
+	std::vector<quadsquare*> blocks;
+	std::size_t next;		// next never used node, counted over all blocks
+	void* free_list;
+	std::size_t used;
+public:
+	quadpool() : next(0), free_list(nullptr), used(0) {}
+	~quadpool() {
+		for (std::size_t i = 0; i < blocks.size(); i++)
+			::operator delete(blocks[i]);
+	}
+
+	void* Allocate() {
+		std::lock_guard<std::mutex> lock(mutex);
+		used++;
+		if (free_list != nullptr) {
+			void* node = free_list;
+			free_list = *static_cast<void**>(node);
+			return node;
+		}
+		if (next == blocks.size() * BlockSize)
+			blocks.push_back(static_cast<quadsquare*>(::operator new(BlockSize * sizeof(quadsquare))));
+		quadsquare* node = blocks[next / BlockSize] + next % BlockSize;
+		next++;
+		return node;
+	}
+	void Free(void* node) {
+		std::lock_guard<std::mutex> lock(mutex);
+		*static_cast<void**>(node) = free_list;
+		free_list = node;
+		used--;
+	}
+	void Reset() {
+		next = 0;
+		free_list = nullptr;
+		used = 0;
+	}
+
+	std::size_t NodeCount() const { return used; }
+	std::size_t Bytes() const { return used * sizeof(quadsquare); }
+	std::size_t ReservedBytes() const { return blocks.size() * BlockSize * sizeof(quadsquare); }
+};
+
+static quadpool pool;
+
+void* quadsquare::operator new(std::size_t) {
+	return pool.Allocate();
+}
+
+void quadsquare::operator delete(void* node) {
+	if (node != nullptr)
+		pool.Free(node);
+}
 
 quadsquare::quadsquare(quadcornerdata* pcd) {
 	pcd->Square = this;
@@ -68,6 +172,8 @@ quadsquare::quadsquare(quadcornerdata* pcd) {
 	ForceEastVert = false;
 	ForceSouthVert = false;
 	Dirty = true;
+	Slack = 0;
+	OwnSlack = 0;
 
 	for (int i = 0; i < 4; i++) {
 		Child[i] = (quadsquare*) nullptr;
@@ -196,6 +302,8 @@ quadsquare*	quadsquare::GetNeighbor(int dir, const quadcornerdata& cd) {
 		if (p == 0) return 0;
 	}
 	quadsquare*	n = p->Child[index];
+	// callers change the flags of the neighbor, so it must be updated again
+	if (n) n->Slack = n->OwnSlack = 0;
 	return n;
 }
 
@@ -206,7 +314,7 @@ float quadsquare::RecomputeError(const quadcornerdata& cd) {
 	float maxerror = 0;
 	float e;
 
-	std::size_t numTerr = Course.TerrList.size();
+	std::size_t numTerr = NumTerrains;
 	if (cd.ChildIndex & 1) {
 		e = std::fabs(Vertex[0].Y - (cd.Verts[1].Y + cd.Verts[3].Y) * 0.5f);
 	} else {
@@ -244,13 +352,13 @@ float quadsquare::RecomputeError(const quadcornerdata& cd) {
 		if (x < RowSize && z < NumRows) {
 
 			if (x < RowSize - 1) {
-				if (Fields[idx].terrain != Fields[idx + 1].terrain) {
+				if (Fields->terrain[idx] != Fields->terrain[idx + 1]) {
 					different_terrains = true;
 				}
 			}
 			if (z >= 1) {
 				idx -= RowSize;
-				if (Fields[idx].terrain != Fields[idx + 1].terrain) {
+				if (Fields->terrain[idx] != Fields->terrain[idx + 1]) {
 					different_terrains = true;
 				}
 			}
@@ -279,13 +387,13 @@ float quadsquare::RecomputeError(const quadcornerdata& cd) {
 		if (x < RowSize && z < NumRows) {
 
 			if (z >= 1) {
-				if (Fields[idx].terrain != Fields[idx - RowSize].terrain) {
+				if (Fields->terrain[idx] != Fields->terrain[idx - RowSize]) {
 					different_terrains = true;
 				}
 			}
 			if (z >= 1 && x < RowSize - 1) {
 				idx += 1;
-				if (Fields[idx].terrain != Fields[idx - RowSize].terrain) {
+				if (Fields->terrain[idx] != Fields->terrain[idx - RowSize]) {
 					different_terrains = true;
 				}
 			}
@@ -338,7 +446,7 @@ float quadsquare::RecomputeError(const quadcornerdata& cd) {
 				continue;
 			}
 
-			int terrain = (int) Fields[i + RowSize*j].terrain;
+			int terrain = (int) Fields->terrain[i + RowSize*j];
 			terrain_count[ terrain ] += 1;
 		}
 	}
@@ -468,12 +576,94 @@ void quadsquare::StaticCullAux(const quadcornerdata& cd, float ThresholdDetail,
 	}
 }
 
+// --------------------------------------------------------------------
+//				changes across the root children
+// --------------------------------------------------------------------
+
+// The root children are updated in parallel, see UpdateRootChildren. A
+// change that reaches from one root child into another is queued by the
+// worker and applied afterwards on the calling thread, in the order of the
+// serial traversal. So the result doesn't depend on the timing of the
+// workers.
+enum quadop_t {
+	OpEnableEdgeVertex,
+	OpDisableNeighborVertex,
+	OpNotifyChildDisable
+};
+
+struct quaddeferred {
+	quadop_t op;
+	int arg;
+	bool IncrementCount;
+	int depth;
+	unsigned char path[32];		// child indices from the node up to the root
+};
+
+static std::vector<quaddeferred> deferred_ops[4];
+// the queue of the root child the thread works on, null outside of workers
+static thread_local std::vector<quaddeferred>* DeferredOps = nullptr;
+
+// Whether the neighbor in direction dir lies in another root child. The
+// walk is the one of GetNeighbor and EnableEdgeVertex.
+static bool NeighborInOtherRootChild(int dir, const quadcornerdata& cd) {
+	for (const quadcornerdata* p = &cd; p->Parent != nullptr; p = p->Parent) {
+		if ((dir - p->ChildIndex) & 2)
+			return p->Parent->Parent == nullptr;
+	}
+	return false;
+}
+
+static void DeferOp(quadop_t op, int arg, bool IncrementCount, const quadcornerdata& cd) {
+	quaddeferred d;
+	d.op = op;
+	d.arg = arg;
+	d.IncrementCount = IncrementCount;
+	d.depth = 0;
+	for (const quadcornerdata* p = &cd; p->Parent != nullptr; p = p->Parent)
+		d.path[d.depth++] = (unsigned char)p->ChildIndex;
+	DeferredOps->push_back(d);
+}
+
+void quadsquare::ApplyDeferred(const quadcornerdata& cd, const quaddeferred& d) {
+	quadcornerdata q[32];
+	const quadcornerdata* pcd = &cd;
+	quadsquare* s = this;
+	for (int i = d.depth - 1, k = 0; i >= 0; i--, k++) {
+		s->SetupCornerData(&q[k], *pcd, d.path[i]);
+		s = s->Child[d.path[i]];
+		pcd = &q[k];
+		// the node and the subtrees above it must be updated again
+		s->Slack = 0;
+	}
+	s->OwnSlack = 0;
+
+	// the disabling changes are only applied if the queued changes before
+	// left the conditions for them in place
+	switch (d.op) {
+		case OpEnableEdgeVertex:
+			s->EnableEdgeVertex(d.arg, d.IncrementCount, *pcd);
+			break;
+		case OpDisableNeighborVertex:
+			if ((s->EnabledFlags & (1 << d.arg)) == 0)
+				s->DisableNeighborVertex(d.arg, *pcd);
+			break;
+		case OpNotifyChildDisable:
+			if ((s->EnabledFlags & (16 << d.arg)) && s->Child[d.arg]->EnabledFlags == 0)
+				s->NotifyChildDisable(*pcd, d.arg);
+			break;
+	}
+}
+
 void quadsquare::EnableEdgeVertex(int index, bool IncrementCount, const quadcornerdata& cd) {
 	int	ct = 0;
 	int	stack[32];
 
 
 	if ((EnabledFlags & (1 << index)) && IncrementCount == false) return;
+	if (DeferredOps != nullptr && NeighborInOtherRootChild(index, cd)) {
+		DeferOp(OpEnableEdgeVertex, index, IncrementCount, cd);
+		return;
+	}
 
 	EnabledFlags |= 1 << index;
 	if (IncrementCount == true && (index == 0 || index == 3)) {
@@ -515,6 +705,8 @@ quadsquare*	quadsquare::EnableDescendant(int count, int path[], const quadcorner
 		EnableChild(ChildIndex, cd);
 	}
 
+	// the flags below are changed from outside the subtree's own update
+	Child[ChildIndex]->Slack = Child[ChildIndex]->OwnSlack = 0;
 	if (count > 0) {
 		quadcornerdata	q;
 		SetupCornerData(&q, cd, ChildIndex);
@@ -543,10 +735,17 @@ void quadsquare::EnableChild(int index, const quadcornerdata& cd) {
 		if (Child[index] == 0) {
 			CreateChild(index, cd);
 		}
+		// a disabled child isn't updated, its slack is out of date
+		Child[index]->Slack = Child[index]->OwnSlack = 0;
 	}
 }
 
 void quadsquare::NotifyChildDisable(const quadcornerdata& cd, int index) {
+	if (DeferredOps != nullptr && (cd.Parent == nullptr ||
+	        NeighborInOtherRootChild(1, cd) || NeighborInOtherRootChild(2, cd))) {
+		DeferOp(OpNotifyChildDisable, index, false, cd);
+		return;
+	}
 	EnabledFlags &= ~(16 << index);
 	quadsquare*	s;
 
@@ -563,16 +762,56 @@ void quadsquare::NotifyChildDisable(const quadcornerdata& cd, int index) {
 	}
 }
 
+// Clears the flag of the east (dir 0) or south (dir 3) edge vertex on the
+// side of the neighbor, after it was cleared here.
+void quadsquare::DisableNeighborVertex(int dir, const quadcornerdata& cd) {
+	if (DeferredOps != nullptr && NeighborInOtherRootChild(dir, cd)) {
+		DeferOp(OpDisableNeighborVertex, dir, false, cd);
+		return;
+	}
+	quadsquare*	s = GetNeighbor(dir, cd);
+	if (s) s->EnabledFlags &= ~(1 << (dir ^ 2));
+}
+
 static float DetailThreshold = 100;
 
+// state of the incremental update, see UpdateQuadtree
+static bool IncrementalUpdate = false;
+static float SlackDetail = -1.f;
+static sf::Int64 UpdateBudget = 0;		// microseconds, 0 = no limit
+static bool ParallelUpdate = true;
+static sf::Clock UpdateClock;
+static thread_local int UpdateChecks = 0;
+static std::atomic<bool> BudgetExceeded(false);
+
+static bool UpdateOverBudget() {
+	if (UpdateBudget <= 0 || BudgetExceeded) return BudgetExceeded;
+	if (++UpdateChecks % 16 == 0)
+		BudgetExceeded = UpdateClock.getElapsedTime().asMicroseconds() > UpdateBudget;
+	return BudgetExceeded;
+}
+
+// A test compares the distance d with error * DetailThreshold, magnified
+// below ERROR_MAGNIFICATION_THRESHOLD. Its result can only change when the
+// viewer moves at least as far as d is from one of these limits.
+static void UpdateSlack(float& slack, float d, float error) {
+	float limit = error * DetailThreshold;
+	slack = std::min(slack, std::fabs(d - limit));
+	slack = std::min(slack, std::fabs(d - limit * ERROR_MAGNIFICATION_AMOUNT));
+	slack = std::min(slack, std::fabs(d - ERROR_MAGNIFICATION_THRESHOLD));
+}
 
 bool quadsquare::VertexTest(int x, float y, int z, float error,
-                            const float Viewer[3], int level, vertex_loc_t vertex_loc) const {
+                            const float Viewer[3], int level, vertex_loc_t vertex_loc, float& slack) const {
 	float	dx = std::fabs(x - Viewer[0]) * std::fabs(ScaleX);
 	float	dy = std::fabs(y - Viewer[1]);
 	float	dz = std::fabs(z - Viewer[2]) * std::fabs(ScaleZ);
 	float	d = std::max(dx, std::max(dy, dz));
 
+	UpdateSlack(slack, d, error);
+	if ((vertex_loc == South && ForceSouthVert) || (vertex_loc == East && ForceEastVert))
+		slack = std::min(slack, std::fabs(d - VERTEX_FORCE_THRESHOLD));
+
 	if (vertex_loc == South && ForceSouthVert && d < VERTEX_FORCE_THRESHOLD) {
 		return true;
 	}
@@ -586,13 +825,16 @@ bool quadsquare::VertexTest(int x, float y, int z, float error,
 	return error * DetailThreshold  > d;
 }
 
-bool quadsquare::BoxTest(int x, int z, float size, float miny, float maxy, float error, const float Viewer[3]) {
+bool quadsquare::BoxTest(int x, int z, float size, float miny, float maxy, float error,
+                         const float Viewer[3], float& slack) {
 	float	half = size * 0.5f;
 	float	dx = (std::fabs(x + half - Viewer[0]) - half) * std::fabs(ScaleX);
 	float	dy = std::fabs((miny + maxy) * 0.5f - Viewer[1]) - (maxy - miny) * 0.5f;
 	float	dz = (std::fabs(z + half - Viewer[2]) - half) * std::fabs(ScaleZ);
 	float	d = std::max(dx, std::max(dy, dz));
 
+	UpdateSlack(slack, d, error);
+
 	if (d < ERROR_MAGNIFICATION_THRESHOLD) {
 		error *= ERROR_MAGNIFICATION_AMOUNT;
 	}
@@ -608,14 +850,37 @@ bool quadsquare::BoxTest(int x, int z, float size, float miny, float maxy, float
 	return false;
 }
 
-void quadsquare::Update(const quadcornerdata& cd, const TVector3d& ViewerLocation, float Detail) {
+// Distance between two viewer locations as the tests measure it
+float quadsquare::ViewerDistance(const float a[3], const float b[3]) {
+	float	dx = std::fabs(a[0] - b[0]) * std::fabs(ScaleX);
+	float	dy = std::fabs(a[1] - b[1]);
+	float	dz = std::fabs(a[2] - b[2]) * std::fabs(ScaleZ);
+	return std::max(dx, std::max(dy, dz));
+}
+
+float quadsquare::RemainingSlack(const float Viewer[3]) const {
+	return Slack - ViewerDistance(SlackViewer, Viewer);
+}
+
+bool quadsquare::Update(const quadcornerdata& cd, const TVector3d& ViewerLocation, float Detail,
+                        int BudgetMicroseconds, bool parallel) {
 	float Viewer[3];
 
 	DetailThreshold = Detail;
 	Viewer[0] = ViewerLocation.x / ScaleX;
 	Viewer[1] = ViewerLocation.y;
 	Viewer[2] = ViewerLocation.z / ScaleZ;
+
+	// the slack of the nodes is only valid for the detail it was found with
+	IncrementalUpdate = BudgetMicroseconds > 0 && Detail == SlackDetail;
+	SlackDetail = Detail;
+	UpdateBudget = IncrementalUpdate ? BudgetMicroseconds : 0;
+	ParallelUpdate = parallel;
+	UpdateChecks = 0;
+	BudgetExceeded = false;
+	UpdateClock.restart();
 	UpdateAux(cd, Viewer, 0, SomeClip);
+	return !BudgetExceeded;
 }
 
 
@@ -628,187 +893,397 @@ void quadsquare::UpdateAux(const quadcornerdata& cd,
 			return;
 		}
 	}
+	if (IncrementalUpdate) {
+		// Nothing can have changed, or no time left for this node. A node
+		// whose own tests can't have changed is only passed through on the
+		// way to its children. It doesn't count against the budget, else
+		// the nodes above subtrees which are out of view or not updated yet
+		// could use it up in every frame.
+		if (!Dirty && RemainingSlack(ViewerLocation) > 0) return;
+		bool own_work = Dirty || OwnSlack - ViewerDistance(SlackViewer, ViewerLocation) <= 0;
+		if (own_work && UpdateOverBudget()) return;
+	}
 	if (Dirty) {
 		RecomputeError(cd);
 	}
 
+	const unsigned char OldFlags = EnabledFlags;
+	const unsigned char OldCount0 = SubEnabledCount[0];
+	const unsigned char OldCount1 = SubEnabledCount[1];
+	float slack = FLT_MAX;
+	unsigned char ChildrenUpdated = 0;
+
 	int	half = 1 << cd.Level;
 	int	whole = half << 1;
 	if ((EnabledFlags & 1) == 0 &&
 	        VertexTest(cd.xorg + whole, Vertex[1].Y, cd.zorg + half,
-	                   Error[0], ViewerLocation, cd.Level, East) == true) {
+	                   Error[0], ViewerLocation, cd.Level, East, slack) == true) {
 		EnableEdgeVertex(0, false, cd);
 	}
 
 	if ((EnabledFlags & 8) == 0 &&
 	        VertexTest(cd.xorg + half, Vertex[4].Y, cd.zorg + whole,
-	                   Error[1], ViewerLocation, cd.Level, South) == true) {
+	                   Error[1], ViewerLocation, cd.Level, South, slack) == true) {
 		EnableEdgeVertex(3, false, cd);
 	}
 
 	if (cd.Level > 0) {
 		if ((EnabledFlags & 32) == 0) {
 			if (BoxTest(cd.xorg, cd.zorg, half, MinY, MaxY, Error[3],
-			            ViewerLocation) == true) EnableChild(1, cd);
+			            ViewerLocation, slack) == true) EnableChild(1, cd);
 		}
 		if ((EnabledFlags & 16) == 0) {
 			if (BoxTest(cd.xorg + half, cd.zorg, half, MinY, MaxY,
-			            Error[2], ViewerLocation) == true) EnableChild(0, cd);
+			            Error[2], ViewerLocation, slack) == true) EnableChild(0, cd);
 		}
 		if ((EnabledFlags & 64) == 0) {
 			if (BoxTest(cd.xorg, cd.zorg + half, half, MinY, MaxY,
-			            Error[4], ViewerLocation) == true) EnableChild(2, cd);
+			            Error[4], ViewerLocation, slack) == true) EnableChild(2, cd);
 		}
 		if ((EnabledFlags & 128) == 0) {
 			if (BoxTest(cd.xorg + half, cd.zorg + half, half, MinY, MaxY,
-			            Error[5], ViewerLocation) == true) EnableChild(3, cd);
+			            Error[5], ViewerLocation, slack) == true) EnableChild(3, cd);
 		}
 
-		quadcornerdata	q;
+		ChildrenUpdated = EnabledFlags & 0xf0;
+		if (cd.Parent == nullptr) {
+			UpdateRootChildren(cd, ViewerLocation, vis);
+		} else {
+			quadcornerdata	q;
 
-		if (EnabledFlags & 32) {
-			SetupCornerData(&q, cd, 1);
-			Child[1]->UpdateAux(q, ViewerLocation, Error[3], vis);
-		}
-		if (EnabledFlags & 16) {
-			SetupCornerData(&q, cd, 0);
-			Child[0]->UpdateAux(q, ViewerLocation, Error[2], vis);
-		}
-		if (EnabledFlags & 64) {
-			SetupCornerData(&q, cd, 2);
-			Child[2]->UpdateAux(q, ViewerLocation, Error[4], vis);
-		}
-		if (EnabledFlags & 128) {
-			SetupCornerData(&q, cd, 3);
-			Child[3]->UpdateAux(q, ViewerLocation, Error[5], vis);
+			if (EnabledFlags & 32) {
+				SetupCornerData(&q, cd, 1);
+				Child[1]->UpdateAux(q, ViewerLocation, Error[3], vis);
+			}
+			if (EnabledFlags & 16) {
+				SetupCornerData(&q, cd, 0);
+				Child[0]->UpdateAux(q, ViewerLocation, Error[2], vis);
+			}
+			if (EnabledFlags & 64) {
+				SetupCornerData(&q, cd, 2);
+				Child[2]->UpdateAux(q, ViewerLocation, Error[4], vis);
+			}
+			if (EnabledFlags & 128) {
+				SetupCornerData(&q, cd, 3);
+				Child[3]->UpdateAux(q, ViewerLocation, Error[5], vis);
+			}
 		}
 	}
 	if ((EnabledFlags & 1) &&
 	        SubEnabledCount[0] == 0 &&
 	        VertexTest(cd.xorg + whole, Vertex[1].Y, cd.zorg + half,
-	                   Error[0], ViewerLocation, cd.Level, East) == false) {
+	                   Error[0], ViewerLocation, cd.Level, East, slack) == false) {
 		EnabledFlags &= ~1;
-		quadsquare*	s = GetNeighbor(0, cd);
-		if (s) s->EnabledFlags &= ~4;
+		DisableNeighborVertex(0, cd);
 	}
 
 	if ((EnabledFlags & 8) &&
 	        SubEnabledCount[1] == 0 &&
 	        VertexTest(cd.xorg + half, Vertex[4].Y, cd.zorg + whole,
-	                   Error[1], ViewerLocation, cd.Level, South) == false) {
+	                   Error[1], ViewerLocation, cd.Level, South, slack) == false) {
 		EnabledFlags &= ~8;
-		quadsquare*	s = GetNeighbor(3, cd);
-		if (s) s->EnabledFlags &= ~2;
+		DisableNeighborVertex(3, cd);
 	}
 
 	if (EnabledFlags == 0 &&
 	        cd.Parent != nullptr &&
 	        BoxTest(cd.xorg, cd.zorg, whole, MinY, MaxY, CenterError,
-	                ViewerLocation) == false) {
+	                ViewerLocation, slack) == false) {
 		cd.Parent->Square->NotifyChildDisable(*cd.Parent, cd.ChildIndex);
 	}
+
+	if (EnabledFlags != OldFlags || SubEnabledCount[0] != OldCount0 || SubEnabledCount[1] != OldCount1)
+		slack = 0;
+	OwnSlack = slack;
+
+	// A subtree is only stable if this update changed nothing in it. The
+	// children are checked after all of them are done, as updating one can
+	// change another. A child enabled here can disable itself again by a
+	// test of its own, so it counts as well.
+	for (int i = 0; i < 4; i++) {
+		if ((EnabledFlags | ChildrenUpdated) & (16 << i))
+			slack = std::min(slack, Child[i]->RemainingSlack(ViewerLocation));
+	}
+	Slack = slack;
+	SlackViewer[0] = ViewerLocation[0];
+	SlackViewer[1] = ViewerLocation[1];
+	SlackViewer[2] = ViewerLocation[2];
 }
 
-GLuint VertexIndices[9];
-int VertexTerrains[9];
+// Updates each root child on its own worker. The subtrees are disjoint, and
+// the changes that reach into another root child are queued, see
+// ApplyDeferred. Without parallel the children are updated in turn, with
+// the same result.
+void quadsquare::UpdateRootChildren(const quadcornerdata& cd,
+                                    const float ViewerLocation[3], clip_result_t vis) {
+	// the order of the serial traversal
+	static const int order[4] = { 1, 0, 2, 3 };
+
+	const unsigned char flags = EnabledFlags;
+	quadcornerdata q[4];
+	for (int i = 0; i < 4; i++) {
+		deferred_ops[i].clear();
+		if (flags & (16 << i))
+			SetupCornerData(&q[i], cd, i);
+	}
+
+	auto update = [&](std::size_t j) {
+		int i = order[j];
+		if ((flags & (16 << i)) == 0) return;
+		DeferredOps = &deferred_ops[i];
+		Child[i]->UpdateAux(q[i], ViewerLocation, Error[i + 2], vis);
+		DeferredOps = nullptr;
+	};
+	if (ParallelUpdate) {
+		ParallelFor(4, update);
+	} else {
+		for (std::size_t j = 0; j < 4; j++)
+			update(j);
+	}
+
+	for (int j = 0; j < 4; j++) {
+		const std::vector<quaddeferred>& ops = deferred_ops[order[j]];
+		for (std::size_t k = 0; k < ops.size(); k++)
+			ApplyDeferred(cd, ops[k]);
+	}
+}
 
-void quadsquare::InitVert(int i, int x, int z) {
+void quadsquare::InitVert(quadextract& ex, int i, int x, int z) {
 	if (x >= RowSize) x = RowSize-1;
 	if (z >= NumRows) z = NumRows - 1;
 
 	int idx = x + RowSize * z;
 
-	VertexIndices[i] = idx;
-	VertexTerrains[i] = Fields[idx].terrain;
+	ex.VertexIndices[i] = idx;
+	ex.VertexTerrains[i] = Fields->terrain[idx];
 }
 
-GLubyte *VNCArray;
+static GLubyte *ColArray;
+static const GLfloat *VNArray;
+
+// The merged index lists of the passes of a frame
+static std::vector<quadtrilist> render_lists;
+
+#ifndef USE_GL4ES
+// Buffer object the index lists of a frame are streamed into, 0 if not
+// available, and where the list of each pass starts in it
+static GLuint index_buffer = 0;
+static std::vector<GLsizeiptr> index_offsets;
+#else
+// De-indexed copy of the vertices, kept to avoid an allocation per draw
+static std::vector<GLfloat> ovn_array;
+static std::vector<GLubyte> ocol_array;
+#endif
+
+// Uploads the index lists of all passes into the index buffer at once,
+// orphaning the one of the last frame so the driver needn't wait for it.
+// The buffer stays bound until EndTris, a list drawn several times (like
+// the one of the blended triangles) is uploaded only once.
+static void BeginTris() {
+#ifndef USE_GL4ES
+	if (!HaveBufferObjects())
+		return;
+	index_offsets.resize(render_lists.size());
+	GLsizeiptr size = 0;
+	for (std::size_t p = 0; p < render_lists.size(); p++) {
+		index_offsets[p] = size;
+		size += render_lists[p].indices.size() * sizeof(GLuint);
+	}
+	if (size == 0)
+		return;
+	if (index_buffer == 0)
+		glGenBuffers_p(1, &index_buffer);
+	glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBufferData_p(GL_ELEMENT_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	for (std::size_t p = 0; p < render_lists.size(); p++) {
+		const std::vector<GLuint>& indices = render_lists[p].indices;
+		if (!indices.empty())
+			glBufferSubData_p(GL_ELEMENT_ARRAY_BUFFER, index_offsets[p],
+			                  indices.size() * sizeof(GLuint), &indices[0]);
+	}
+#endif
+}
+
+static void EndTris() {
+#ifndef USE_GL4ES
+	if (HaveBufferObjects())
+		glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, 0);
+#endif
+}
 
-void quadsquare::DrawTris() {
+void quadsquare::DrawTris(std::size_t pass) {
+	const quadtrilist& list = render_lists[pass];
+	GLsizei count = (GLsizei)list.indices.size();
 #ifndef USE_GL4ES
-	int tmp_min_idx = VertexArrayMinIdx;
+	if (HaveBufferObjects()) {
+		glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (const GLvoid*)index_offsets[pass]);
+		return;
+	}
+
+	int tmp_min_idx = list.min_idx;
 
 	if (glLockArraysEXT_p) {
 		if (tmp_min_idx == 0) tmp_min_idx = 1;
-		glLockArraysEXT_p(tmp_min_idx, VertexArrayMaxIdx - tmp_min_idx + 1);
+		glLockArraysEXT_p(tmp_min_idx, list.max_idx - tmp_min_idx + 1);
 	}
 
-	glDrawElements(GL_TRIANGLES, VertexArrayCounter,
-	               GL_UNSIGNED_INT, VertexArrayIndices);
+	glDrawElements(GL_TRIANGLES, count,
+	               GL_UNSIGNED_INT, &list.indices[0]);
 	if (glUnlockArraysEXT_p) glUnlockArraysEXT_p();
 #else
 	// TODO gl4es handling uint indices
-    GLbyte *ovnc_array = new GLbyte[VertexArrayCounter * STRIDE_GL_ARRAY];
-
-	for (int i = 0; i < VertexArrayCounter; i++)
-	    memcpy(ovnc_array + i * STRIDE_GL_ARRAY, VNCArray + VertexArrayIndices[i] * STRIDE_GL_ARRAY, STRIDE_GL_ARRAY);
+	if (ocol_array.size() < (std::size_t)count * 4) {
+		ovn_array.resize(count * 6);
+		ocol_array.resize(count * 4);
+	}
 
-	glVertexPointer(3, GL_FLOAT, STRIDE_GL_ARRAY, ovnc_array);
-	glNormalPointer(GL_FLOAT, STRIDE_GL_ARRAY, ovnc_array + 4 * sizeof(GLfloat));
-	glColorPointer(4, GL_UNSIGNED_BYTE, STRIDE_GL_ARRAY, ovnc_array + 8 * sizeof(GLfloat));
-    glDrawArrays(GL_TRIANGLES, 0, VertexArrayCounter);
+	for (GLsizei i = 0; i < count; i++) {
+		memcpy(&ovn_array[i * 6], VNArray + list.indices[i] * 6, STRIDE_GL_ARRAY);
+		memcpy(&ocol_array[i * 4], ColArray + list.indices[i] * 4, 4);
+	}
 
-    delete[] ovnc_array;
+	glVertexPointer(3, GL_FLOAT, STRIDE_GL_ARRAY, &ovn_array[0]);
+	glNormalPointer(GL_FLOAT, STRIDE_GL_ARRAY, &ovn_array[3]);
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, &ocol_array[0]);
+	glDrawArrays(GL_TRIANGLES, 0, count);
 #endif
 }
 
-void quadsquare::InitArrayCounters() {
-	VertexArrayCounter = 0;
-	VertexArrayMinIdx = INT_MAX;
-	VertexArrayMaxIdx = 0;
+#define ALL_TERRAINS -2
+
+// One extraction per root child, filled by the workers, and one for the
+// triangles of the root itself.
+static quadextract child_extract[4];
+static quadextract root_extract;
+
+void quadsquare::ExtractTris(const quadcornerdata& cd, bool parallel) {
+	std::size_t numPasses = render_passes.size();
+	render_lists.resize(numPasses);
+	for (std::size_t p = 0; p < numPasses; p++)
+		render_lists[p].Clear();
+
+	clip_result_t vis = ClipSquare(cd);
+	if (vis == NotVisible) return;
+
+	quadcornerdata q[4];
+	int	flags = 0;
+	for (int i = 0; i < 4; i++) {
+		child_extract[i].Clear(numPasses);
+		if (EnabledFlags & (16 << i))
+			SetupCornerData(&q[i], cd, i);
+		else
+			flags |= 1 << i;
+	}
+
+	// The subtrees are only read here, and each one writes to its own
+	// lists. Merging them in child order afterwards gives exactly the
+	// triangle order of a sequential traversal.
+	auto extract = [&](std::size_t i) {
+		if (EnabledFlags & (16 << i))
+			Child[i]->RenderAux(q[i], vis, child_extract[i]);
+	};
+	if (parallel) {
+		ParallelFor(4, extract);
+	} else {
+		for (std::size_t i = 0; i < 4; i++)
+			extract(i);
+	}
+
+	root_extract.Clear(numPasses);
+	if (flags != 0)
+		EmitTris(cd, flags, root_extract);
+
+	for (std::size_t p = 0; p < numPasses; p++) {
+		for (int i = 0; i < 4; i++)
+			render_lists[p].Append(child_extract[i].lists[p]);
+		render_lists[p].Append(root_extract.lists[p]);
+	}
 }
 
-void quadsquare::Render(const quadcornerdata& cd, GLubyte *vnc_array) {
-	VNCArray = vnc_array;
+void quadsquare::Render(const quadcornerdata& cd, GLubyte *col_array, const GLfloat *vn_array) {
+	ColArray = col_array;
+	VNArray = vn_array;
+	render_passes.clear();
+
+	// single pass: all visible triangles at once, blended by the shader
+	if (BeginTerrainShader(Fields, RowSize, NumRows, ScaleX, ScaleZ)) {
+		render_passes.push_back({ALL_TERRAINS, MakeAnyTri});
+		ExtractTris(cd);
+		if (!render_lists[0].indices.empty()) {
+			BeginTris();
+			DrawTris(0);
+			EndTris();
+		}
+		EndTerrainShader();
+		return;
+	}
 
 	std::size_t numTerrains = Course.TerrList.size();
+	for (std::size_t j=0; j<numTerrains; j++) {
+		if (Course.TerrList[j].texture != nullptr)
+			render_passes.push_back({(int)j, param.perf_level > 1 ? MakeTri : MakeNoBlendTri});
+	}
+	if (param.perf_level > 1)
+		render_passes.push_back({-1, MakeSpecialTri});
+
+	ExtractTris(cd);
+	BeginTris();
+
+	std::size_t pass = 0;
 	for (std::size_t j=0; j<numTerrains; j++) {
 		if (Course.TerrList[j].texture != nullptr) {
-			InitArrayCounters();
-			RenderAux(cd, SomeClip, (int)j);
-			if (VertexArrayCounter == 0) continue;
+			const quadtrilist& list = render_lists[pass];
+			if (list.indices.empty()) {
+				pass++;
+				continue;
+			}
 
+			for (std::size_t i=0; i<list.indices.size(); i++) {
+				GLuint idx = list.indices[i];
+				colorval(idx, 3) = ((int)j <= Fields->terrain[idx]) ? 255 : 0;
+			}
 			Course.TerrList[j].texture->Bind();
-			DrawTris();
+			DrawTris(pass++);
 		}
 	}
 
 	if (param.perf_level > 1) {
-		InitArrayCounters();
-		RenderAux(cd, SomeClip, -1);
+		const quadtrilist& list = render_lists[pass];
+		std::size_t count = list.indices.size();
 
-		if (VertexArrayCounter != 0) {
+		if (count != 0) {
 			glDisable(GL_FOG);
-			for (GLuint i=0; i<VertexArrayCounter; i++) {
-				colorval(VertexArrayIndices[i], 0) = 0;
-				colorval(VertexArrayIndices[i], 1) = 0;
-				colorval(VertexArrayIndices[i], 2) = 0;
-				colorval(VertexArrayIndices[i], 3) = 255;
+			for (std::size_t i=0; i<count; i++) {
+				colorval(list.indices[i], 0) = 0;
+				colorval(list.indices[i], 1) = 0;
+				colorval(list.indices[i], 2) = 0;
+				colorval(list.indices[i], 3) = 255;
 			}
 			Course.TerrList[0].texture->Bind();
-			DrawTris();
+			DrawTris(pass);
 			//if (fog_on)
 			glEnable(GL_FOG);
 			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-			for (GLuint i=0; i<VertexArrayCounter; i++) {
-				colorval(VertexArrayIndices[i], 0) = 255;
-				colorval(VertexArrayIndices[i], 1) = 255;
-				colorval(VertexArrayIndices[i], 2) = 255;
+			for (std::size_t i=0; i<count; i++) {
+				colorval(list.indices[i], 0) = 255;
+				colorval(list.indices[i], 1) = 255;
+				colorval(list.indices[i], 2) = 255;
 			}
 
 			for (std::size_t j=0; j<numTerrains; j++) {
 				if (Course.TerrList[j].texture != nullptr) {
 					Course.TerrList[j].texture->Bind();
 
-					for (GLuint i=0; i<VertexArrayCounter; i++) {
-						colorval(VertexArrayIndices[i], 3) =
-						    (Fields[VertexArrayIndices[i]].terrain == (char)j) ? 255 : 0;
+					for (std::size_t i=0; i<count; i++) {
+						colorval(list.indices[i], 3) =
+						    (Fields->terrain[list.indices[i]] == (char)j) ? 255 : 0;
 					}
-					DrawTris();
+					DrawTris(pass);
 				}
 			}
 		}
 	}
+	EndTris();
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
@@ -854,58 +1329,49 @@ clip_result_t quadsquare::ClipSquare(const quadcornerdata& cd) {
 }
 
 
-inline void quadsquare::MakeTri(int a, int b, int c, int terrain) {
-	if ((VertexTerrains[a] == terrain ||
-	        VertexTerrains[b] == terrain ||
-	        VertexTerrains[c] == terrain)) {
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[a];
-		setalphaval(a);
-		update_min_max(VertexIndices[a]);
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[b];
-		setalphaval(b);
-		update_min_max(VertexIndices[b]);
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[c];
-		setalphaval(c);
-		update_min_max(VertexIndices[c]);
+// The alpha values of the vertices are set when the list is drawn, so
+// the extraction itself doesn't write to the vertex array.
+void quadsquare::MakeTri(const quadextract& ex, quadtrilist& list, int a, int b, int c, int terrain) {
+	if ((ex.VertexTerrains[a] == terrain ||
+	        ex.VertexTerrains[b] == terrain ||
+	        ex.VertexTerrains[c] == terrain)) {
+		list.Add(ex.VertexIndices[a]);
+		list.Add(ex.VertexIndices[b]);
+		list.Add(ex.VertexIndices[c]);
 	}
 }
 
 
-inline void quadsquare::MakeSpecialTri(int a, int b, int c, int terrain) {
-	if (VertexTerrains[a] != VertexTerrains[b] &&
-	        VertexTerrains[a] != VertexTerrains[c] &&
-	        VertexTerrains[b] != VertexTerrains[c]) {
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[a];
-		update_min_max(VertexIndices[a]);
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[b];
-		update_min_max(VertexIndices[b]);
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[c];
-		update_min_max(VertexIndices[c]);
+void quadsquare::MakeSpecialTri(const quadextract& ex, quadtrilist& list, int a, int b, int c, int terrain) {
+	if (ex.VertexTerrains[a] != ex.VertexTerrains[b] &&
+	        ex.VertexTerrains[a] != ex.VertexTerrains[c] &&
+	        ex.VertexTerrains[b] != ex.VertexTerrains[c]) {
+		list.Add(ex.VertexIndices[a]);
+		list.Add(ex.VertexIndices[b]);
+		list.Add(ex.VertexIndices[c]);
 	}
 }
 
-inline void quadsquare::MakeNoBlendTri(int a, int b, int c, int terrain) {
-	if ((VertexTerrains[a] == terrain ||
-	        VertexTerrains[b] == terrain ||
-	        VertexTerrains[c] == terrain) &&
-	        (VertexTerrains[a] >= terrain &&
-	         VertexTerrains[b] >= terrain &&
-	         VertexTerrains[c] >= terrain)) {
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[a];
-		setalphaval(a);
-		update_min_max(VertexIndices[a]);
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[b];
-		setalphaval(b);
-		update_min_max(VertexIndices[b]);
-		VertexArrayIndices[VertexArrayCounter++] = VertexIndices[c];
-		setalphaval(c);
-		update_min_max(VertexIndices[c]);
+void quadsquare::MakeAnyTri(const quadextract& ex, quadtrilist& list, int a, int b, int c, int terrain) {
+	list.Add(ex.VertexIndices[a]);
+	list.Add(ex.VertexIndices[b]);
+	list.Add(ex.VertexIndices[c]);
+}
+
+void quadsquare::MakeNoBlendTri(const quadextract& ex, quadtrilist& list, int a, int b, int c, int terrain) {
+	if ((ex.VertexTerrains[a] == terrain ||
+	        ex.VertexTerrains[b] == terrain ||
+	        ex.VertexTerrains[c] == terrain) &&
+	        (ex.VertexTerrains[a] >= terrain &&
+	         ex.VertexTerrains[b] >= terrain &&
+	         ex.VertexTerrains[c] >= terrain)) {
+		list.Add(ex.VertexIndices[a]);
+		list.Add(ex.VertexIndices[b]);
+		list.Add(ex.VertexIndices[c]);
 	}
 }
 
-void quadsquare::RenderAux(const quadcornerdata& cd, clip_result_t vis, int terrain) {
-	int	half = 1 << cd.Level;
-	int	whole = 2 << cd.Level;
+void quadsquare::RenderAux(const quadcornerdata& cd, clip_result_t vis, quadextract& ex) {
 	if (vis != NoClip) {
 		vis = ClipSquare(cd);
 		if (vis == NotVisible) return;
@@ -918,31 +1384,33 @@ void quadsquare::RenderAux(const quadcornerdata& cd, clip_result_t vis, int terr
 	for (int i = 0; i < 4; i++, mask <<= 1) {
 		if (EnabledFlags & (16 << i)) {
 			SetupCornerData(&q, cd, i);
-			Child[i]->RenderAux(q, vis, terrain);
+			Child[i]->RenderAux(q, vis, ex);
 		} else {
 			flags |= mask;
 		}
 	}
 
 	if (flags == 0) return;
+	EmitTris(cd, flags, ex);
+}
 
-	InitVert(0, cd.xorg + half, cd.zorg + half);
-	InitVert(1, cd.xorg + whole, cd.zorg + half);
-	InitVert(2, cd.xorg + whole, cd.zorg);
-	InitVert(3, cd.xorg + half, cd.zorg);
-	InitVert(4, cd.xorg, cd.zorg);
-	InitVert(5, cd.xorg, cd.zorg + half);
-	InitVert(6, cd.xorg, cd.zorg + whole);
-	InitVert(7, cd.xorg + half, cd.zorg + whole);
-	InitVert(8, cd.xorg + whole, cd.zorg + whole);
-	if (terrain == -1) {
-		make_tri_list(MakeSpecialTri, EnabledFlags, flags, terrain);
-	} else if (param.perf_level > 1) {
-		make_tri_list(MakeTri, EnabledFlags, flags, terrain);
-	} else {
-		make_tri_list(MakeNoBlendTri, EnabledFlags, flags, terrain);
-	}
+void quadsquare::EmitTris(const quadcornerdata& cd, int flags, quadextract& ex) {
+	int	half = 1 << cd.Level;
+	int	whole = 2 << cd.Level;
 
+	InitVert(ex, 0, cd.xorg + half, cd.zorg + half);
+	InitVert(ex, 1, cd.xorg + whole, cd.zorg + half);
+	InitVert(ex, 2, cd.xorg + whole, cd.zorg);
+	InitVert(ex, 3, cd.xorg + half, cd.zorg);
+	InitVert(ex, 4, cd.xorg, cd.zorg);
+	InitVert(ex, 5, cd.xorg, cd.zorg + half);
+	InitVert(ex, 6, cd.xorg, cd.zorg + whole);
+	InitVert(ex, 7, cd.xorg + half, cd.zorg + whole);
+	InitVert(ex, 8, cd.xorg + whole, cd.zorg + whole);
+	for (std::size_t p = 0; p < render_passes.size(); p++) {
+		const quadpass& pass = render_passes[p];
+		make_tri_list(pass.tri_func, ex, ex.lists[p], EnabledFlags, flags, pass.terrain);
+	}
 }
 
 
@@ -1001,12 +1469,6 @@ void quadsquare::AddHeightMap(const quadcornerdata& cd, const HeightMapInfo& hm)
 	RowSize = hm.RowWidth;
 	NumRows = hm.ZSize;
 
-	if (cd.Parent == nullptr) {
-		if (VertexArrayIndices != nullptr) {
-			delete[] VertexArrayIndices;
-		}
-		VertexArrayIndices = new GLuint[6 * RowSize * NumRows];
-	}
 	int	BlockSize = 2 << cd.Level;
 	if (cd.xorg > hm.XOrigin + ((hm.XSize + 2) << hm.Scale) ||
 	        cd.xorg + BlockSize < hm.XOrigin - (1 << hm.Scale) ||
@@ -1065,8 +1527,10 @@ void quadsquare::SetScale(double x, double z) {
 }
 
 CourseFields* quadsquare::Fields;
-void quadsquare::SetFields(CourseFields* fields) {
+std::size_t quadsquare::NumTerrains;
+void quadsquare::SetFields(CourseFields* fields, std::size_t num_terrains) {
 	Fields = fields;
+	NumTerrains = num_terrains;
 }
 
 float HeightMapInfo::Sample(int x, int z) const {
@@ -1076,7 +1540,7 @@ float HeightMapInfo::Sample(int x, int z) const {
 	if (z >= ZSize) {
 		z = ZSize - 1;
 	}
-	return Data[ x + z * RowWidth ].elevation;
+	return Data->elevation[ x + z * RowWidth ];
 }
 
 // --------------------------------------------------------------------
@@ -1089,10 +1553,9 @@ static quadsquare *root = (quadsquare*) nullptr;
 static quadcornerdata root_corner_data = {(quadcornerdata*)nullptr };
 
 void ResetQuadtree() {
-	if (root != nullptr) {
-		delete root;
-		root = (quadsquare*) nullptr;
-	}
+	// the nodes hold no other resources, so they needn't be destroyed
+	root = (quadsquare*) nullptr;
+	pool.Reset();
 }
 
 static int get_root_level(int nx, int nz) {
@@ -1100,7 +1563,7 @@ static int get_root_level(int nx, int nz) {
 }
 
 
-void InitQuadtree(CourseFields* fields, int nx, int nz,
+void InitQuadtree(CourseFields* fields, std::size_t num_terrains, int nx, int nz,
                   double scalex, double scalez, const TVector3d& view_pos, double detail) {
 	HeightMapInfo hm;
 
@@ -1123,10 +1586,11 @@ void InitQuadtree(CourseFields* fields, int nx, int nz,
 		root_corner_data.Verts[i].Y = 0;
 	}
 
+	ResetTerrainShader();
 	root = new quadsquare(&root_corner_data);
 	root->AddHeightMap(root_corner_data, hm);
 	root->SetScale(scalex, scalez);
-	root->SetFields(&Course.Fields[0]);
+	root->SetFields(fields, num_terrains);
 
 	root->StaticCullData(root_corner_data, CULL_DETAIL_FACTOR);
 
@@ -1135,25 +1599,66 @@ void InitQuadtree(CourseFields* fields, int nx, int nz,
 	}
 }
 
-void UpdateQuadtree(const TVector3d& view_pos, float detail) {
-	root->Update(root_corner_data, view_pos, detail);
+void GetQuadtreeStats(std::size_t* nodes, std::size_t* bytes, std::size_t* reserved) {
+	*nodes = pool.NodeCount();
+	*bytes = pool.Bytes();
+	*reserved = pool.ReservedBytes();
+}
+
+bool UpdateQuadtree(const TVector3d& view_pos, float detail, int budget, bool parallel) {
+	return root->Update(root_corner_data, view_pos, detail, budget, parallel);
+}
+
+void quadsquare::GetFlags(std::vector<unsigned char>& flags) const {
+	flags.push_back(EnabledFlags);
+	for (int i = 0; i < 4; i++) {
+		if (EnabledFlags & (16 << i))
+			Child[i]->GetFlags(flags);
+	}
+}
+
+void GetQuadtreeFlags(std::vector<unsigned char>& flags) {
+	flags.clear();
+	root->GetFlags(flags);
+}
+
+void ExtractQuadtreeTris(std::vector<std::vector<GLuint> >& lists, bool parallel) {
+	render_passes.clear();
+	for (std::size_t j = 0; j < quadsquare::NumTerrains; j++)
+		render_passes.push_back({(int)j, quadsquare::MakeTri});
+	render_passes.push_back({-1, quadsquare::MakeSpecialTri});
+
+	root->ExtractTris(root_corner_data, parallel);
+	lists.resize(render_lists.size());
+	for (std::size_t p = 0; p < render_lists.size(); p++)
+		lists[p] = render_lists[p].indices;
 }
 
 void RenderQuadtree() {
-	GLubyte *vnc_array = Course.GetGLArrays();
+	GLubyte *col_array = Course.GetColorArray();
+
+	// positions and normals come from the static buffer if there is one
+	const GLfloat* vn_array = nullptr;
+#ifndef USE_GL4ES
+	if (!Course.BindGLBuffer())
+#endif
+		vn_array = Course.GetVertexArray();
+	const GLubyte* vn_base = reinterpret_cast<const GLubyte*>(vn_array);
 
 	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(3, GL_FLOAT, STRIDE_GL_ARRAY, vnc_array);
+	glVertexPointer(3, GL_FLOAT, STRIDE_GL_ARRAY, vn_base);
 
 	glEnableClientState(GL_NORMAL_ARRAY);
 	glNormalPointer(GL_FLOAT, STRIDE_GL_ARRAY,
-	                vnc_array + 4 * sizeof(GLfloat));
+	                vn_base + 3 * sizeof(GLfloat));
+
+	if (HaveBufferObjects())
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
 
 	glEnableClientState(GL_COLOR_ARRAY);
-	glColorPointer(4, GL_UNSIGNED_BYTE, STRIDE_GL_ARRAY,
-	               vnc_array + 8 * sizeof(GLfloat));
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, col_array);
 
-	root->Render(root_corner_data, vnc_array);
+	root->Render(root_corner_data, col_array, vn_array);
 
 	glDisableClientState(GL_VERTEX_ARRAY);
 	glDisableClientState(GL_NORMAL_ARRAY);
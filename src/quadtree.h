@@ -45,6 +45,9 @@ struct HeightMapInfo {
 
 struct	VertInfo { float Y; };
 struct quadsquare;
+struct quadtrilist;
+struct quadextract;
+struct quaddeferred;
 
 class quadcornerdata {
 public:
@@ -70,34 +73,46 @@ struct quadsquare {
 	bool ForceEastVert;
 	bool ForceSouthVert;
 
+	// How far the viewer may move from SlackViewer before a LOD decision
+	// in this subtree can change. Zero or less if it must be updated.
+	// OwnSlack is the same for the tests of this node alone.
+	float	Slack;
+	float	OwnSlack;
+	float	SlackViewer[3];
+
 	static double ScaleX, ScaleZ;
 	static int RowSize, NumRows;
 	static CourseFields* Fields;
+	static std::size_t NumTerrains;
 
-	static GLuint *VertexArrayIndices;
-	static GLuint VertexArrayCounter;
-	static GLuint VertexArrayMinIdx;
-	static GLuint VertexArrayMaxIdx;
-
-	static void MakeTri(int a, int b, int c, int terrain);
-	static void MakeSpecialTri(int a, int b, int c, int terrain);
-	static void MakeNoBlendTri(int a, int b, int c, int terrain);
+	static void MakeTri(const quadextract& ex, quadtrilist& list, int a, int b, int c, int terrain);
+	static void MakeSpecialTri(const quadextract& ex, quadtrilist& list, int a, int b, int c, int terrain);
+	static void MakeNoBlendTri(const quadextract& ex, quadtrilist& list, int a, int b, int c, int terrain);
+	static void MakeAnyTri(const quadextract& ex, quadtrilist& list, int a, int b, int c, int terrain);
 
-	static void DrawTris();
-	static void InitArrayCounters();
+	// draws the index list of a pass of the frame
+	static void DrawTris(std::size_t pass);
 
 	explicit quadsquare(quadcornerdata* pcd);
 	~quadsquare();
 
+	// nodes are allocated from a pool, see quadtree.cpp
+	static void* operator new(std::size_t size);
+	static void operator delete(void* node);
+
 	void	AddHeightMap(const quadcornerdata& cd, const HeightMapInfo& hm);
 	void	StaticCullData(const quadcornerdata& cd, float ThresholdDetail);
 	float	RecomputeError(const quadcornerdata& cd);
 	int		CountNodes();
-	void	Update(const quadcornerdata& cd, const TVector3d& ViewerLocation, float Detail);
-	void	Render(const quadcornerdata& cd, GLubyte *vnc_array);
+	bool	Update(const quadcornerdata& cd, const TVector3d& ViewerLocation, float Detail,
+	               int BudgetMicroseconds = 0, bool parallel = true);
+	void	Render(const quadcornerdata& cd, GLubyte *col_array, const GLfloat *vn_array);
+	// fills the index lists of the passes set up for the frame
+	void	ExtractTris(const quadcornerdata &cd, bool parallel = true);
 	float	GetHeight(const quadcornerdata& cd, float x, float z);
 	void	SetScale(double x, double z);
-	void	SetFields(CourseFields* fields);
+	void	SetFields(CourseFields* fields, std::size_t num_terrains);
+	void	GetFlags(std::vector<unsigned char>& flags) const;
 
 private:
 	quadsquare*	EnableDescendant(int count, int path[],
@@ -109,6 +124,8 @@ private:
 	                         const quadcornerdata &cd);
 	void	EnableChild(int index, const quadcornerdata &cd);
 	void	NotifyChildDisable(const quadcornerdata& cd, int index);
+	void	DisableNeighborVertex(int dir, const quadcornerdata& cd);
+	void	ApplyDeferred(const quadcornerdata& cd, const quaddeferred& d);
 	void	ResetTree();
 	void	StaticCullAux(const quadcornerdata &cd, float ThresholdDetail,
 	                      int TargetLevel);
@@ -117,14 +134,19 @@ private:
 	                        int ChildIndex);
 	void	UpdateAux(const quadcornerdata &cd, const float ViewerLocation[3],
 	                  float CenterError, clip_result_t vis);
+	void	UpdateRootChildren(const quadcornerdata &cd, const float ViewerLocation[3],
+	                           clip_result_t vis);
 	void	RenderAux(const quadcornerdata &cd, clip_result_t vis,
-	                  int terrain);
+	                  quadextract& ex);
+	void	EmitTris(const quadcornerdata &cd, int flags, quadextract& ex);
 	void	SetStatic(const quadcornerdata &cd);
-	void	InitVert(int i, int x, int z);
+	void	InitVert(quadextract& ex, int i, int x, int z);
 	bool	VertexTest(int x, float y, int z, float error, const float Viewer[3],
-	                   int level, vertex_loc_t vertex_loc) const;
+	                   int level, vertex_loc_t vertex_loc, float& slack) const;
 	static bool BoxTest(int x, int z, float size, float miny, float maxy,
-	                    float error, const float Viewer[3]);
+	                    float error, const float Viewer[3], float& slack);
+	static float ViewerDistance(const float a[3], const float b[3]);
+	float	RemainingSlack(const float Viewer[3]) const;
 };
 
 // --------------------------------------------------------------------
@@ -132,12 +154,33 @@ private:
 // --------------------------------------------------------------------
 
 void ResetQuadtree();
-void InitQuadtree(CourseFields* fields, int nx, int nz,
+void InitQuadtree(CourseFields* fields, std::size_t num_terrains, int nx, int nz,
                   double scalex, double scalez,
                   const TVector3d& view_pos, double detail);
 
-void UpdateQuadtree(const TVector3d& view_pos, float detail);
+// With a budget > 0 only the subtrees whose LOD can have changed since
+// their last update are visited, and the update stops when the budget (in
+// microseconds) is used up. The remaining subtrees follow in later frames.
+// Returns false if the budget was used up.
+// The root children are updated on the worker pool. Changes that reach
+// from one of them into another are queued and applied afterwards in a
+// fixed order, so with parallel = false, on this thread only, the result
+// is the same.
+bool UpdateQuadtree(const TVector3d& view_pos, float detail, int budget = 0,
+                    bool parallel = true);
 void RenderQuadtree();
 
+// The index lists of the terrain passes as RenderQuadtree draws them
+// without the terrain shader, one list per terrain and one for the
+// triangles with three terrains. Needs the view frustum, but no OpenGL
+// context. With parallel = false the tree is traversed on this thread.
+void ExtractQuadtreeTris(std::vector<std::vector<GLuint> >& lists, bool parallel);
+
+// The enabled flags of the nodes in use, depth first
+void GetQuadtreeFlags(std::vector<unsigned char>& flags);
+
+// the nodes of the quadtree and the memory of its pool
+void GetQuadtreeStats(std::size_t* nodes, std::size_t* bytes, std::size_t* reserved);
+
 
 #endif
@@ -37,6 +37,8 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "physics.h"
 #include "tux.h"
+#include "intro.h"
+#include "replay.h"
 #include <algorithm>
 
 #define MAX_JUMP_AMT 1.0
@@ -45,6 +47,30 @@ GNU General Public License for more details.
 
 CRacing Racing;
 
+// The events of the races of the game
+class CGameEvents : public CSimEvents {
+public:
+	void TreeHit() {
+		Sound.Play("tree_hit", 0);
+	}
+	void ItemCollected() {
+		Sound.Play("pickup1", 0);
+		Sound.Play("pickup2", 0);
+		Sound.Play("pickup3", 0);
+	}
+	void Spray(const CControl* ctrl, double dtime, const TVector3d& pos, double speed) {
+		if (param.perf_level > 2) generate_particles(ctrl, dtime, pos, speed);
+	}
+	void RaceOver() {
+		State::manager.RequestEnterState(GameOver);
+	}
+};
+
+static CGameEvents game_events;
+
+// the shape is set when the race begins, see CIntro::Enter
+TSimContext GameContext(&Course, &Wind, nullptr, &game_events);
+
 static bool right_turn;
 static bool left_turn;
 static bool stick_turn;
@@ -55,7 +81,6 @@ static bool key_charging;
 static bool stick_charging;
 static bool key_braking;
 static bool stick_braking;
-static double charge_start_time;
 static bool trick_modifier;
 
 static bool sky = true;
@@ -224,13 +249,11 @@ void CRacing::Jbutt(int button, bool pressed) {
 	}
 }
 
-static void CalcJumpEnergy(float time_step) {
-	CControl *ctrl = g_game.player->ctrl;
-
+static void CalcJumpEnergy(CControl *ctrl, float time_step) {
 	if (ctrl->jump_charging) {
-		ctrl->jump_amt = std::min(MAX_JUMP_AMT, g_game.time - charge_start_time);
+		ctrl->jump_amt = std::min(MAX_JUMP_AMT, ctrl->ctx->time - ctrl->charge_start_time);
 	} else if (ctrl->jumping) {
-		ctrl->jump_amt *= (1.0 - (g_game.time - ctrl->jump_start_time) /
+		ctrl->jump_amt *= (1.0 - (ctrl->ctx->time - ctrl->jump_start_time) /
 		                   JUMP_FORCE_DURATION);
 	} else {
 		ctrl->jump_amt = 0;
@@ -259,12 +282,11 @@ void CRacing::Enter() {
 	}
 	set_view_mode(ctrl, param.view_mode);
 
-	ctrl->turn_fact = 0.0;
-	ctrl->turn_animation = 0.0;
-	ctrl->is_braking = false;
-	ctrl->is_paddling = false;
-	ctrl->jumping = false;
-	ctrl->jump_charging = false;
+	bool start = State::manager.PreviousState() == &Intro;
+	bool init = State::manager.PreviousState() != &Paused;
+	if (start) Replay.Start(ctrl);
+	EnterRace(ctrl, start, init);
+	Replay.AddEnter(start, init);
 
 	key_paddling = false;
 	key_braking = false;
@@ -285,14 +307,11 @@ void CRacing::Enter() {
 	lastsound = -1;
 	newsound = -1;
 
-	if (State::manager.PreviousState() != &Paused) ctrl->Init();
 	g_game.raceaborted = false;
 
 	SetSoundVolumes();
 	Music.PlayTheme(g_game.theme_id, MUS_RACING);
 
-	g_game.finish = false;
-
 	Winsys.KeyRepeat(false);
 
 #ifdef MOBILE
@@ -333,14 +352,9 @@ static void PlayTerrainSound(CControl *ctrl, bool airborne) {
 }
 
 // ----------------------- controls -----------------------------------
-static void CalcSteeringControls(CControl *ctrl, float time_step) {
-	if (stick_turn) {
-		ctrl->turn_fact = stick_turnfact;
-		ctrl->turn_animation += ctrl->turn_fact * 2 * time_step;
-		ctrl->turn_animation = clamp(-1.0, ctrl->turn_animation, 1.0);
-	} else if (left_turn ^ right_turn) {
-		if (left_turn) ctrl->turn_fact = -1.0;
-		else ctrl->turn_fact = 1.0;
+static void CalcSteeringControls(CControl *ctrl, const TRaceInput& input, float time_step) {
+	if (input.turn != 0.f) {
+		ctrl->turn_fact = input.turn;
 		ctrl->turn_animation += ctrl->turn_fact * 2 * time_step;
 		ctrl->turn_animation = clamp(-1.0, ctrl->turn_animation, 1.0);
 	} else {
@@ -352,23 +366,19 @@ static void CalcSteeringControls(CControl *ctrl, float time_step) {
 		}
 	}
 
-	bool paddling = key_paddling || stick_paddling;
-	if (paddling && ctrl->is_paddling == false) {
+	if (input.paddle && ctrl->is_paddling == false) {
 		ctrl->is_paddling = true;
-		ctrl->paddle_time = g_game.time;
+		ctrl->paddle_time = ctrl->ctx->time;
 	}
 
-	bool braking = key_braking || stick_braking;
-	ctrl->is_braking = braking;
+	ctrl->is_braking = input.brake;
 
-	bool charge = key_charging || stick_charging;
-	bool invcharge = !key_charging && !stick_charging;
-	CalcJumpEnergy(time_step);
-	if ((charge) && !ctrl->jump_charging && !ctrl->jumping) {
+	CalcJumpEnergy(ctrl, time_step);
+	if (input.charge && !ctrl->jump_charging && !ctrl->jumping) {
 		ctrl->jump_charging = true;
-		charge_start_time = g_game.time;
+		ctrl->charge_start_time = ctrl->ctx->time;
 	}
-	if ((invcharge) && ctrl->jump_charging) {
+	if (!input.charge && ctrl->jump_charging) {
 		ctrl->jump_charging = false;
 		ctrl->begin_jump = true;
 	}
@@ -393,11 +403,11 @@ static void CalcFinishControls(CControl *ctrl, float timestep, bool airborne) {
 
 // ----------------------- trick --------------------------------------
 
-static void CalcTrickControls(CControl *ctrl, float time_step, bool airborne) {
-	if (airborne && trick_modifier) {
-		if (left_turn) ctrl->roll_left = true;
-		if (right_turn) ctrl->roll_right = true;
-		if (key_paddling) ctrl->front_flip = true;
+static void CalcTrickControls(CControl *ctrl, const TRaceInput& input, float time_step, bool airborne) {
+	if (airborne && input.trick) {
+		if (input.turn < 0.f) ctrl->roll_left = true;
+		if (input.turn > 0.f) ctrl->roll_right = true;
+		if (input.paddle) ctrl->front_flip = true;
 		if (ctrl->is_braking) ctrl->back_flip = true;
 	}
 
@@ -417,28 +427,76 @@ static void CalcTrickControls(CControl *ctrl, float time_step, bool airborne) {
 	}
 }
 
+bool IsAirborne(const CControl *ctrl) {
+	double ycoord = ctrl->ctx->course->FindYCoord(ctrl->cpos.x, ctrl->cpos.z);
+	return ctrl->cpos.y > (ycoord + JUMP_MAX_START_HEIGHT);
+}
+
+// The player state when CRacing is entered. start is set when the race
+// begins after the intro, init unless the race goes on after a pause.
+void EnterRace(CControl *ctrl, bool start, bool init) {
+	if (start) {
+		// the intro has changed the wind and the character's joints
+		ctrl->ctx->wind->Restart();
+		ctrl->ctx->shape->ResetRoot();
+		ctrl->ctx->shape->ResetJoints();
+	}
+
+	ctrl->turn_fact = 0.0;
+	ctrl->turn_animation = 0.0;
+	ctrl->is_braking = false;
+	ctrl->is_paddling = false;
+	ctrl->jumping = false;
+	ctrl->jump_charging = false;
+
+	if (init) ctrl->Init();
+	ctrl->ctx->finish = false;
+}
+
+// Everything of a race frame that changes the physical state. Replays
+// run through this function, so it must not depend on anything else.
+void StepRace(CControl *ctrl, const TRaceInput& input, float time_step, bool airborne) {
+	CalcTrickControls(ctrl, input, time_step, airborne);
+
+	TSimContext* ctx = ctrl->ctx;
+	if (!ctx->finish) CalcSteeringControls(ctrl, input, time_step);
+	else CalcFinishControls(ctrl, time_step, airborne);
+
+	ctrl->UpdatePlayerPos(time_step);
+	ctx->wind->Update(time_step);
+	if (ctx->finish == false) ctx->time += time_step;
+}
+
+static TRaceInput GetRaceInput() {
+	TRaceInput input;
+	if (stick_turn) input.turn = stick_turnfact;
+	else if (left_turn ^ right_turn) input.turn = left_turn ? -1.f : 1.f;
+	input.paddle = key_paddling || stick_paddling;
+	input.brake = key_braking || stick_braking;
+	input.charge = key_charging || stick_charging;
+	input.trick = trick_modifier;
+	return input;
+}
+
 // ====================================================================
 //					loop
 // ====================================================================
 
 void CRacing::Loop(float time_step) {
 	CControl *ctrl = g_game.player->ctrl;
-	double ycoord = Course.FindYCoord(ctrl->cpos.x, ctrl->cpos.z);
-	bool airborne = (bool)(ctrl->cpos.y > (ycoord + JUMP_MAX_START_HEIGHT));
+	bool airborne = IsAirborne(ctrl);
+	TRaceInput input = GetRaceInput();
 
 	ClearRenderContext();
 	Env.SetupFog();
-	CalcTrickControls(ctrl, time_step, airborne);
-
-	if (!g_game.finish) CalcSteeringControls(ctrl, time_step);
-	else CalcFinishControls(ctrl, time_step, airborne);
 	PlayTerrainSound(ctrl, airborne);
 
 //  >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-	ctrl->UpdatePlayerPos(time_step);
+	StepRace(ctrl, input, time_step, airborne);
+	Replay.AddRace(time_step, input);
 //  >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
-	if (g_game.finish) IncCameraDistance(time_step);
+	if (ctrl->ctx->finish) IncCameraDistance(time_step);
 	update_view(ctrl, time_step);
 	UpdateTrackmarks(ctrl);
 
@@ -450,18 +508,16 @@ void CRacing::Loop(float time_step) {
 	DrawTrackmarks();
 	if (trees) DrawTrees();
 	if (param.perf_level > 2) {
-		update_particles(time_step);
+		update_particles(*ctrl->ctx->course, time_step);
 		draw_particles(ctrl);
 	}
 	g_game.character->shape->Draw();
-	UpdateWind(time_step);
 	UpdateSnow(time_step, ctrl);
 	DrawSnow(ctrl);
 	DrawHud(ctrl);
 
 	Reshape(Winsys.resolution.width, Winsys.resolution.height);
 	Winsys.SwapBuffers();
-	if (g_game.finish == false) g_game.time += time_step;
 }
 
 void CRacing::Exit() {
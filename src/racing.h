@@ -21,6 +21,18 @@ GNU General Public License for more details.
 #include "bh.h"
 #include "states.h"
 
+// The steering input of one race step. It comes from the keyboard and the
+// joystick or, in --simulate mode, from a script.
+struct TRaceInput {
+	float turn;		// -1 (left) ... 1 (right), 0 for straight on
+	bool paddle;
+	bool brake;
+	bool charge;	// charging a jump, the jump starts when it's released
+	bool trick;
+
+	TRaceInput() : turn(0.f), paddle(false), brake(false), charge(false), trick(false) {}
+};
+
 class CRacing final : public State {
 	void Enter();
 	void Loop(float time_step);
@@ -36,4 +48,8 @@ public:
 
 extern CRacing Racing;
 
+bool IsAirborne(const CControl *ctrl);
+void EnterRace(CControl *ctrl, bool start, bool init);
+void StepRace(CControl *ctrl, const TRaceInput& input, float time_step, bool airborne);
+
 #endif
@@ -0,0 +1,282 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include <sys/stat.h>
+#include "replay.h"
+#include "course.h"
+#include "game_ctrl.h"
+#include "physics.h"
+#include "reset.h"
+#include "particles.h"
+#include <fstream>
+#include <cstring>
+
+// raised with every change to the race physics, as the replays of older
+// versions no longer play back the same
+#define REPLAY_VERSION 3
+#define REPLAY_ENDIAN 0x01020304
+
+CReplay Replay;
+
+struct TReplayHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t endian;
+	char group[32];
+	char course[64];
+	char character[32];
+	uint32_t mirrored;
+	int32_t wind_id;
+	int32_t snow_id;
+	uint32_t seed;
+	int32_t treesize;
+	int32_t treevar;
+	double start_pos[3];
+	double end_pos[3];
+	float time;
+	int32_t herring;
+	uint32_t num_frames;
+	uint32_t pad;
+};
+
+static bool CopyName(char* dest, std::size_t size, const std::string& name) {
+	if (name.size() >= size)
+		return false;
+	std::memset(dest, 0, size);
+	std::memcpy(dest, name.c_str(), name.size());
+	return true;
+}
+
+template<typename T>
+static bool SameBits(T a, T b) {
+	return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+CReplay::CReplay()
+	: recording(false), mirrored(false), wind_id(0), snow_id(0), seed(0)
+	, treesize(3), treevar(3)
+	, time(0.f), herring(0) {
+}
+
+// --------------------------------------------------------------------
+//					recording
+// --------------------------------------------------------------------
+
+void CReplay::Start(const CControl *ctrl) {
+	group = Course.currentCourseList->name;
+	course = g_game.course->dir;
+	character = g_game.character->dir;
+	mirrored = g_game.mirrorred;
+	wind_id = g_game.wind_id;
+	snow_id = g_game.snow_id;
+	seed = g_game.seed;
+	treesize = g_game.treesize;
+	treevar = g_game.treevar;
+	Record(ctrl);
+}
+
+void CReplay::Record(const CControl *ctrl) {
+	recording = true;
+	start_pos = ctrl->cpos;
+	frames.clear();
+}
+
+void CReplay::AddEnter(bool start, bool init) {
+	if (!recording) return;
+	TReplayFrame frame = {0.f, 0.f, REPLAY_ENTER, 0, 0};
+	if (start) frame.flags |= REPLAY_START;
+	if (init) frame.flags |= REPLAY_INIT;
+	frames.push_back(frame);
+}
+
+void CReplay::AddRace(float time_step, const TRaceInput& input) {
+	if (!recording) return;
+	TReplayFrame frame = {time_step, input.turn, REPLAY_RACE, 0, 0};
+	if (input.paddle) frame.flags |= REPLAY_PADDLE;
+	if (input.brake) frame.flags |= REPLAY_BRAKE;
+	if (input.charge) frame.flags |= REPLAY_CHARGE;
+	if (input.trick) frame.flags |= REPLAY_TRICK;
+	frames.push_back(frame);
+}
+
+void CReplay::AddReset(float time_step, bool reposition) {
+	if (!recording) return;
+	TReplayFrame frame = {time_step, 0.f, REPLAY_RESET, 0, 0};
+	if (reposition) frame.flags |= REPLAY_REPOSITION;
+	frames.push_back(frame);
+}
+
+void CReplay::Finish(const CControl *ctrl) {
+	recording = false;
+	end_pos = ctrl->cpos;
+	time = ctrl->ctx->time;
+	herring = ctrl->ctx->herring;
+}
+
+// --------------------------------------------------------------------
+//					file
+// --------------------------------------------------------------------
+
+bool CReplay::Save(const std::string& file) const {
+	TReplayHeader head;
+	std::memset(&head, 0, sizeof(head));
+	std::memcpy(head.magic, "ETRR", 4);
+	head.version = REPLAY_VERSION;
+	head.endian = REPLAY_ENDIAN;
+	if (!CopyName(head.group, sizeof(head.group), group)
+	        || !CopyName(head.course, sizeof(head.course), course)
+	        || !CopyName(head.character, sizeof(head.character), character)) {
+		Message("course or character name too long for a replay");
+		return false;
+	}
+	head.mirrored = mirrored;
+	head.wind_id = wind_id;
+	head.snow_id = snow_id;
+	head.seed = seed;
+	head.treesize = treesize;
+	head.treevar = treevar;
+	head.start_pos[0] = start_pos.x;
+	head.start_pos[1] = start_pos.y;
+	head.start_pos[2] = start_pos.z;
+	head.end_pos[0] = end_pos.x;
+	head.end_pos[1] = end_pos.y;
+	head.end_pos[2] = end_pos.z;
+	head.time = time;
+	head.herring = herring;
+	head.num_frames = (uint32_t)frames.size();
+
+	std::ofstream out(file, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(&head), sizeof(head));
+	if (!frames.empty())
+		out.write(reinterpret_cast<const char*>(&frames[0]), sizeof(TReplayFrame) * frames.size());
+	if (!out) {
+		Message("could not write replay", file);
+		return false;
+	}
+	return true;
+}
+
+bool CReplay::Load(const std::string& file) {
+	std::ifstream in(file, std::ios::binary);
+	TReplayHeader head;
+	if (!in || !in.read(reinterpret_cast<char*>(&head), sizeof(head))
+	        || std::memcmp(head.magic, "ETRR", 4) != 0
+	        || head.version != REPLAY_VERSION
+	        || head.endian != REPLAY_ENDIAN) {
+		Message("not a replay of this version", file);
+		return false;
+	}
+
+	head.group[sizeof(head.group) - 1] = 0;
+	head.course[sizeof(head.course) - 1] = 0;
+	head.character[sizeof(head.character) - 1] = 0;
+	group = head.group;
+	course = head.course;
+	character = head.character;
+	mirrored = head.mirrored != 0;
+	wind_id = head.wind_id;
+	snow_id = head.snow_id;
+	seed = head.seed;
+	treesize = head.treesize;
+	treevar = head.treevar;
+	start_pos = TVector3d(head.start_pos[0], head.start_pos[1], head.start_pos[2]);
+	end_pos = TVector3d(head.end_pos[0], head.end_pos[1], head.end_pos[2]);
+	time = head.time;
+	herring = head.herring;
+
+	frames.resize(head.num_frames);
+	if (!frames.empty() && !in.read(reinterpret_cast<char*>(&frames[0]), sizeof(TReplayFrame) * frames.size())) {
+		Message("replay is truncated", file);
+		frames.clear();
+		return false;
+	}
+	recording = false;
+	return true;
+}
+
+std::string ReplayFileName() {
+	std::string path = param.replay_dir;
+
+#if !defined (OS_WIN32_MINGW) && !defined (OS_WIN32_MSC)
+	const char *cpath = path.c_str();
+
+	if (!DirExists(cpath)) {
+		mkdir(cpath, 0775);
+	}
+#endif /* WIN32 */
+
+	path += SEP;
+	path += g_game.course->dir;
+	path += '_';
+	path += GetTimeString();
+	path += ".etrr";
+	return path;
+}
+
+// --------------------------------------------------------------------
+//					playing
+// --------------------------------------------------------------------
+
+void CReplay::Play(CControl *ctrl) const {
+	// the state after the intro
+	TSimContext* ctx = ctrl->ctx;
+	ctx->wind->Init(wind_id, seed);
+	ctx->Reset();
+	ctx->course->ResetItems();
+	ctrl->cpos = start_pos;
+
+	for (std::size_t i = 0; i < frames.size(); i++) {
+		const TReplayFrame& frame = frames[i];
+		switch (frame.type) {
+			case REPLAY_ENTER:
+				EnterRace(ctrl, (frame.flags & REPLAY_START) != 0, (frame.flags & REPLAY_INIT) != 0);
+				break;
+			case REPLAY_RACE: {
+				TRaceInput input;
+				input.turn = frame.turn;
+				input.paddle = (frame.flags & REPLAY_PADDLE) != 0;
+				input.brake = (frame.flags & REPLAY_BRAKE) != 0;
+				input.charge = (frame.flags & REPLAY_CHARGE) != 0;
+				input.trick = (frame.flags & REPLAY_TRICK) != 0;
+				StepRace(ctrl, input, frame.time_step, IsAirborne(ctrl));
+				break;
+			}
+			case REPLAY_RESET:
+				StepReset(ctrl, frame.time_step, (frame.flags & REPLAY_REPOSITION) != 0);
+				break;
+		}
+	}
+}
+
+bool CReplay::Matches(const CControl *ctrl) const {
+	return SameBits(ctrl->cpos.x, end_pos.x)
+	       && SameBits(ctrl->cpos.y, end_pos.y)
+	       && SameBits(ctrl->cpos.z, end_pos.z)
+	       && SameBits(ctrl->ctx->time, time)
+	       && ctrl->ctx->herring == herring;
+}
+
+float CReplay::Duration() const {
+	float duration = 0.f;
+	for (std::size_t i = 0; i < frames.size(); i++)
+		duration += frames[i].time_step;
+	return duration;
+}
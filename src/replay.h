@@ -0,0 +1,98 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "bh.h"
+#include "mathlib.h"
+#include "racing.h"
+#include <vector>
+
+enum TReplayFrameType {
+	REPLAY_ENTER,	// CRacing::Enter, see EnterRace
+	REPLAY_RACE,	// a frame of CRacing::Loop, see StepRace
+	REPLAY_RESET	// a frame of CReset::Loop, see StepReset
+};
+
+// flags of the frames
+#define REPLAY_START		1	// ENTER: the race begins
+#define REPLAY_INIT			2	// ENTER: the controls are initialized
+#define REPLAY_REPOSITION	1	// RESET: the player is moved to the reset point
+#define REPLAY_PADDLE		1	// RACE: the buttons of TRaceInput
+#define REPLAY_BRAKE		2
+#define REPLAY_CHARGE		4
+#define REPLAY_TRICK		8
+
+struct TReplayFrame {
+	float time_step;
+	float turn;
+	uint8_t type;
+	uint8_t flags;
+	uint16_t pad;
+};
+
+// The setup and the input of a race. Played through the same functions
+// as the race itself, it ends with the same position and time, bit for bit.
+class CReplay {
+	bool recording;
+public:
+	// setup
+	std::string group;
+	std::string course;
+	std::string character;
+	bool mirrored;
+	int wind_id;
+	int snow_id;
+	uint32_t seed;
+	int treesize;			// for courses whose trees are made from trees.png
+	int treevar;
+	TVector3d start_pos;	// where the intro has left the player
+	std::vector<TReplayFrame> frames;
+
+	// result
+	TVector3d end_pos;
+	float time;
+	int herring;
+
+	CReplay();
+
+	// recording of the current race. Start takes the setup from the game,
+	// Record keeps the setup fields as they are.
+	void Start(const CControl *ctrl);
+	void Record(const CControl *ctrl);
+	void AddEnter(bool start, bool init);
+	void AddRace(float time_step, const TRaceInput& input);
+	void AddReset(float time_step, bool reposition);
+	void Finish(const CControl *ctrl);
+	bool Recording() const { return recording; }
+
+	bool Save(const std::string& file) const;
+	bool Load(const std::string& file);
+
+	// The course of the replay has to be loaded into ctrl->ctx. Afterwards
+	// Matches tells whether the race of ctrl has ended like the recorded one.
+	void Play(CControl *ctrl) const;
+	bool Matches(const CControl *ctrl) const;
+	float Duration() const;	// the race time the frames cover
+};
+
+extern CReplay Replay;
+
+std::string ReplayFileName();
+
+#endif
@@ -33,6 +33,7 @@ GNU General Public License for more details.
 #include "racing.h"
 #include "winsys.h"
 #include "physics.h"
+#include "replay.h"
 
 #define BLINK_IN_PLACE_TIME 0.5
 #define TOTAL_RESET_TIME 1.0
@@ -49,15 +50,55 @@ void CReset::Enter() {
 	position_reset = false;
 }
 
+// Moves the player to the next reset point up the course
+void ResetPlayerPosition(CControl *ctrl) {
+	const CCourse* course = ctrl->ctx->course;
+	const std::vector<TItem>& items = course->NocollArr;
+	int best_loc = -1;
+	for (std::size_t i = 0; i < items.size(); i++) {
+		if (items[i].type.reset_point && items[i].pt.z > ctrl->cpos.z) {
+			if (best_loc == -1 || items[i].pt.z < items[best_loc].pt.z) {
+				best_loc = (int)i;
+			}
+		}
+	}
+
+	if (best_loc == -1) { // Fallback in case there are no reset points
+		ctrl->cpos.x = course->GetDimensions().x/2.0;
+		ctrl->cpos.z = std::min(ctrl->cpos.z + 10, -1.0);
+	} else if (items[best_loc].pt.z <= ctrl->cpos.z) {
+		ctrl->cpos.x = course->GetDimensions().x/2.0;
+		ctrl->cpos.z = std::min(ctrl->cpos.z + 10, -1.0);
+	} else {
+		ctrl->cpos.x = items[best_loc].pt.x;
+		ctrl->cpos.z = items[best_loc].pt.z;
+	}
+
+	ctrl->view_init = false;
+	ctrl->Init();
+}
+
+// The physical part of a reset frame, see StepRace
+void StepReset(CControl *ctrl, float time_step, bool reposition) {
+	ctrl->UpdatePlayerPos(EPS);
+	if (reposition) ResetPlayerPosition(ctrl);
+	ctrl->ctx->time += time_step;
+}
+
 void CReset::Loop(float time_step) {
 	CControl *ctrl = g_game.player->ctrl;
 	float elapsed_time = reset_timer.getElapsedTime().asSeconds();
 	static bool tux_visible = true;
 	static int tux_visible_count = 0;
 
+	// Tux blinks in place for a while before he is moved
+	bool reposition = elapsed_time > BLINK_IN_PLACE_TIME && !position_reset;
+	StepReset(ctrl, time_step, reposition);
+	Replay.AddReset(time_step, reposition);
+	if (reposition) position_reset = true;
+
 	ClearRenderContext();
 	Env.SetupFog();
-	ctrl->UpdatePlayerPos(EPS);
 	update_view(ctrl, EPS);
 	SetupViewFrustum(ctrl);
 	Env.DrawSkybox(ctrl->viewpos);
@@ -67,33 +108,6 @@ void CReset::Loop(float time_step) {
 	DrawTrackmarks();
 	DrawTrees();
 
-	if (elapsed_time > BLINK_IN_PLACE_TIME && !position_reset) {
-		// Determine optimal location for reset
-		int best_loc = -1;
-		for (std::size_t i = 0; i < Course.NocollArr.size(); i++) {
-			if (Course.NocollArr[i].type.reset_point && Course.NocollArr[i].pt.z > ctrl->cpos.z) {
-				if (best_loc == -1 || Course.NocollArr[i].pt.z < Course.NocollArr[best_loc].pt.z) {
-					best_loc = (int)i;
-				}
-			}
-		}
-
-		if (best_loc == -1) { // Fallback in case there are no reset points
-			ctrl->cpos.x = Course.GetDimensions().x/2.0;
-			ctrl->cpos.z = std::min(ctrl->cpos.z + 10, -1.0);
-		} else if (Course.NocollArr[best_loc].pt.z <= ctrl->cpos.z) {
-			ctrl->cpos.x = Course.GetDimensions().x/2.0;
-			ctrl->cpos.z = std::min(ctrl->cpos.z + 10, -1.0);
-		} else {
-			ctrl->cpos.x = Course.NocollArr[best_loc].pt.x;
-			ctrl->cpos.z = Course.NocollArr[best_loc].pt.z;
-		}
-
-		ctrl->view_init = false;
-		ctrl->Init();
-		position_reset = true;
-	}
-
 	if (tux_visible) g_game.character->shape->Draw();
 
 	if (++tux_visible_count > 3) {
@@ -104,7 +118,6 @@ void CReset::Loop(float time_step) {
 	DrawHud(ctrl);
 	Reshape(Winsys.resolution.width, Winsys.resolution.height);
 	Winsys.SwapBuffers();
-	g_game.time += time_step;
 
 	if (elapsed_time > TOTAL_RESET_TIME) {
 		State::manager.RequestEnterState(Racing);
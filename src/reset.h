@@ -29,4 +29,7 @@ public:
 
 extern CReset Reset;
 
+void ResetPlayerPosition(CControl *ctrl);
+void StepReset(CControl *ctrl, float time_step, bool reposition);
+
 #endif
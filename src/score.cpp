@@ -27,6 +27,7 @@ GNU General Public License for more details.
 #include "game_ctrl.h"
 #include "translation.h"
 #include "course.h"
+#include "sim_context.h"
 #include "spx.h"
 #include "winsys.h"
 
@@ -142,20 +143,20 @@ bool CScore::LoadHighScore() {
 int CScore::CalcRaceResult() {
 	g_game.race_result = -1;
 	if (g_game.game_type == CUPRACING) {
-		if (g_game.time <= g_game.race->time.x &&
-		        g_game.herring >= g_game.race->herrings.x) g_game.race_result = 0;
-		if (g_game.time <= g_game.race->time.y &&
-		        g_game.herring >= g_game.race->herrings.y) g_game.race_result = 1;
-		if (g_game.time <= g_game.race->time.z &&
-		        g_game.herring >= g_game.race->herrings.z) g_game.race_result = 2;
+		if (GameContext.time <= g_game.race->time.x &&
+		        GameContext.herring >= g_game.race->herrings.x) g_game.race_result = 0;
+		if (GameContext.time <= g_game.race->time.y &&
+		        GameContext.herring >= g_game.race->herrings.y) g_game.race_result = 1;
+		if (GameContext.time <= g_game.race->time.z &&
+		        GameContext.herring >= g_game.race->herrings.z) g_game.race_result = 2;
 	}
 
-	int herringpt = g_game.herring * 10;
-	double timept = Course.GetDimensions().y - (g_game.time * 10);
+	int herringpt = GameContext.herring * 10;
+	double timept = Course.GetDimensions().y - (GameContext.time * 10);
 	g_game.score = (int)(herringpt + timept);
 	if (g_game.score < 0) g_game.score = 0;
 
-	return AddScore(Course.currentCourseList->name, g_game.course->dir, TScore(g_game.player->name, g_game.score, g_game.herring, g_game.time));
+	return AddScore(Course.currentCourseList->name, g_game.course->dir, TScore(g_game.player->name, g_game.score, GameContext.herring, GameContext.time));
 }
 
 // --------------------------------------------------------------------
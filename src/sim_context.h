@@ -0,0 +1,71 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifndef SIM_CONTEXT_H
+#define SIM_CONTEXT_H
+
+#include "bh.h"
+
+class CCourse;
+class CWind;
+class CCharShape;
+class CControl;
+
+// The events of a race which concern more than the physics, like sounds
+// and changes of the game state. The handlers do nothing by default.
+class CSimEvents {
+public:
+	virtual ~CSimEvents() {}
+	virtual void TreeHit() {}
+	virtual void ItemCollected() {}
+	// Tux slides through the snow at pos, for the snow spray
+	virtual void Spray(const CControl* ctrl, double dtime, const TVector3d& pos, double speed) {}
+	virtual void Finish() {}		// the player has passed the finish line
+	// right after Finish, or once Tux has stopped on courses with a finish
+	// animation; may come several times
+	virtual void RaceOver() {}
+};
+
+// Everything the physics of a race works on. The game races in
+// GameContext; a simulation has a context of its own, so several races
+// can be stepped at the same time on different threads.
+struct TSimContext {
+	CCourse* course;
+	CWind* wind;
+	CCharShape* shape;		// of the character
+	CSimEvents* events;
+
+	// the clock and the result of the race
+	float time;
+	int herring;
+	bool finish;			// the finish line is passed, Tux brakes
+
+	TSimContext(CCourse* course_, CWind* wind_, CCharShape* shape_, CSimEvents* events_)
+		: course(course_), wind(wind_), shape(shape_), events(events_),
+		  time(0.f), herring(0), finish(false) {}
+
+	// before the race starts
+	void Reset() {
+		time = 0.f;
+		herring = 0;
+		finish = false;
+	}
+};
+
+extern TSimContext GameContext;
+
+#endif
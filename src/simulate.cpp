@@ -0,0 +1,218 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "simulate.h"
+#include "course.h"
+#include "game_ctrl.h"
+#include "physics.h"
+#include "racing.h"
+#include "replay.h"
+#include "env.h"
+#include "tux.h"
+#include "spx.h"
+#include <algorithm>
+#include <stdexcept>
+
+#define SIM_TIME_STEP (1.f / 60.f)
+#define SIM_MAX_TIME 600.f
+
+struct TInputEvent {
+	float time;
+	TRaceInput input;
+};
+
+static bool LoadInputScript(const std::string& file, std::vector<TInputEvent>& script) {
+	CSPList list;
+
+	if (!list.Load(file)) {
+		Message("could not load input script", file);
+		return false;
+	}
+
+	for (CSPList::const_iterator line = list.cbegin(); line != list.cend(); ++line) {
+		TInputEvent ev;
+		ev.time = SPFloatN(*line, "time", 0.f);
+		ev.input.turn = clamp(-1.f, SPFloatN(*line, "turn", 0.f), 1.f);
+		ev.input.paddle = SPBoolN(*line, "paddle", false);
+		ev.input.brake = SPBoolN(*line, "brake", false);
+		ev.input.charge = SPBoolN(*line, "jump", false);
+		ev.input.trick = SPBoolN(*line, "trick", false);
+		script.push_back(ev);
+	}
+	std::stable_sort(script.begin(), script.end(),
+	[](const TInputEvent& a, const TInputEvent& b) { return a.time < b.time; });
+	return true;
+}
+
+// --------------------------------------------------------------------
+//				CSimulation
+// --------------------------------------------------------------------
+
+bool LoadSimulationResources() {
+	return Env.LoadEnvironmentList();
+}
+
+CSimulation::CSimulation()
+	: course(true)
+	, ctx(&course, &wind, nullptr, &events)
+	, ctrl(&ctx) {
+}
+
+CSimulation::~CSimulation() {
+}
+
+bool CSimulation::Load(const std::string& group, const std::string& course_dir,
+                       const std::string& character, bool mirrored) {
+	if (course.TerrList.empty()) {
+		course.MakeStandardPolyhedrons();
+		if (!course.LoadObjectTypes() || !course.LoadTerrainTypes() || !course.LoadCourseList(false)) {
+			course.TerrList.clear();
+			return false;
+		}
+	}
+
+	if (shape == nullptr || char_dir != character) {
+		shape.reset(new CCharShape);
+		if (!shape->Load(MakePathStr(param.char_dir, character), "shape.lst", false)) {
+			Message("could not load the character shape", character);
+			shape.reset();
+			return false;
+		}
+		char_dir = character;
+	}
+	ctx.shape = shape.get();
+
+	TCourse* crs;
+	try {
+		crs = course.GetCourse(group, course_dir);
+		course.currentCourseList = &course.CourseLists.at(group);
+	} catch (std::out_of_range&) {
+		Message("unknown course", group + "/" + course_dir);
+		return false;
+	}
+
+	if (course.BeginLoadCourse(crs) && !course.PrepareCourse()) {
+		course.ResetCourse();
+		return false;
+	}
+	course.SetMirrored(mirrored);
+
+	ctrl = CControl(&ctx);
+	return true;
+}
+
+void CSimulation::StartRace(int wind_id, uint32_t seed) {
+	const TVector2d& start_pt = course.GetStartPoint();
+	ctrl.cpos.x = start_pt.x;
+	ctrl.cpos.z = start_pt.y;
+	wind.Init(wind_id, seed);
+	course.ResetItems();
+	ctx.Reset();
+}
+
+// --------------------------------------------------------------------
+//				headless races
+// --------------------------------------------------------------------
+
+int RunSimulation(const std::string& course, const std::string& script) {
+	std::vector<TInputEvent> events;
+	if (!script.empty() && !LoadInputScript(script, events))
+		return -1;
+
+	std::size_t sep = course.find('/');
+	if (sep == std::string::npos) {
+		Message("usage: etr --simulate <group>/<course> [script]");
+		return -1;
+	}
+	if (!LoadSimulationResources() || !Char.LoadCharacterList(false) || Char.CharList.empty()) {
+		Message("could not load the characters");
+		return -1;
+	}
+
+	std::unique_ptr<CSimulation> sim(new CSimulation);
+	if (!sim->Load(course.substr(0, sep), course.substr(sep + 1), Char.CharList[0].dir, false))
+		return -1;
+	CControl* ctrl = &sim->ctrl;
+	TSimContext* ctx = ctrl->ctx;
+	const CCourse& crs = sim->RaceCourse();
+
+	// the race starts like after the intro
+	sim->StartRace(0, 0);
+	EnterRace(ctrl, true, true);
+
+	const TVector2d& play_size = crs.GetPlayDimensions();
+	TRaceInput input;
+	std::size_t next_event = 0;
+	std::size_t steps = 0;
+	bool finished = false;
+
+	sf::Clock clock;
+	while (ctx->time < SIM_MAX_TIME) {
+		while (next_event < events.size() && events[next_event].time <= ctx->time)
+			input = events[next_event++].input;
+
+		StepRace(ctrl, input, SIM_TIME_STEP, IsAirborne(ctrl));
+		steps++;
+		if (ctx->finish || -ctrl->cpos.z >= play_size.y) {
+			finished = true;
+			break;
+		}
+	}
+	float elapsed = std::max(clock.getElapsedTime().asSeconds(), 0.001f);
+
+	Message("course:", course + (finished ? "" : " (not finished)"));
+	Message("race time:", Float_StrN(ctx->time, 2) + " s");
+	Message("herrings:", Int_StrN(ctx->herring));
+	Message("steps:", Int_StrN((int)steps) + ", " + Int_StrN((int)(steps / elapsed)) + " steps/s");
+	return finished ? 0 : 1;
+}
+
+bool PlayReplay(CSimulation& sim, const CReplay& replay, float* elapsed) {
+	sim.SetTreeSize(replay.treesize, replay.treevar);
+	if (!sim.Load(replay.group, replay.course, replay.character, replay.mirrored))
+		return false;
+
+	sf::Clock clock;
+	replay.Play(&sim.ctrl);
+	*elapsed = clock.getElapsedTime().asSeconds();
+	return true;
+}
+
+int RunReplay(const std::string& file) {
+	CReplay replay;
+	if (!replay.Load(file) || !LoadSimulationResources())
+		return -1;
+
+	std::unique_ptr<CSimulation> sim(new CSimulation);
+	float elapsed;
+	if (!PlayReplay(*sim, replay, &elapsed))
+		return -1;
+	elapsed = std::max(elapsed, 0.001f);
+	bool valid = replay.Matches(&sim->ctrl);
+	const TSimContext& ctx = sim->Context();
+
+	Message("replay:", replay.group + "/" + replay.course + (valid ? " - valid" : " - MISMATCH"));
+	Message("race time:", Float_StrN(ctx.time, 2) + " s, recorded " + Float_StrN(replay.time, 2) + " s");
+	Message("herrings:", Int_StrN(ctx.herring) + ", recorded " + Int_StrN(replay.herring));
+	Message("frames:", Int_StrN((int)replay.frames.size()) + ", "
+	        + Int_StrN((int)(replay.frames.size() / elapsed)) + " frames/s");
+	return valid ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#include "bh.h"
+#include "course.h"
+#include "particles.h"
+#include "physics.h"
+#include "sim_context.h"
+#include <memory>
+
+// A headless race with its own course, wind and character shape. The
+// events are ignored. Simulations running on different threads share
+// nothing but the lists loaded by LoadSimulationResources.
+class CSimulation {
+	CCourse course;
+	CWind wind;
+	std::unique_ptr<CCharShape> shape;
+	std::string char_dir;
+	CSimEvents events;
+	TSimContext ctx;
+public:
+	CControl ctrl;
+
+	CSimulation();
+	~CSimulation();
+
+	// Loads the course and the character unless they are loaded already
+	// and gives the race a fresh CControl
+	bool Load(const std::string& group, const std::string& course_dir,
+	          const std::string& character, bool mirrored);
+	void SetTreeSize(int size, int var) { course.SetTreeSize(size, var); }
+	const CCourse& RaceCourse() const { return course; }
+	// Puts Tux on the start point and sets the race up like the intro does
+	void StartRace(int wind_id, uint32_t seed);
+	const TSimContext& Context() const { return ctx; }
+};
+
+class CReplay;
+
+// Loads the course of the replay into sim and plays it. elapsed is set to
+// the wall clock time of the playing.
+bool PlayReplay(CSimulation& sim, const CReplay& replay, float* elapsed);
+
+// The global lists the courses refer to. Must be loaded once before the
+// first simulation.
+bool LoadSimulationResources();
+
+// Runs a race on the course "<group>/<course>" without a window or an
+// OpenGL context. The controls are read from script, a list of lines like
+//   *[time] 2.5 [turn] -1 [paddle] 1 [brake] 0 [jump] 0 [trick] 0
+// each of them holds from its time on until the next one. Without a script
+// Tux just slides down. Returns the exit code of the program.
+int RunSimulation(const std::string& course, const std::string& script);
+
+// Plays a replay file through the physics and checks whether the race ends
+// with the recorded position, time and herrings. Returns 0 if it does.
+int RunReplay(const std::string& file);
+
+#endif
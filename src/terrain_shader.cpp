@@ -0,0 +1,305 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "terrain_shader.h"
+#include "course.h"
+#include "textures.h"
+#include "ogl.h"
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#ifndef GL_MAX_TEXTURE_IMAGE_UNITS
+#define GL_MAX_TEXTURE_IMAGE_UNITS 0x8872
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+#define MAX_SHADER_TERRAINS 8
+
+static const char* vertex_source =
+    "uniform vec2 weight_scale;\n"
+    "uniform vec2 weight_offset;\n"
+    "uniform float lights_on[4];\n"
+    "uniform int fog_mode;\n"
+    "varying vec2 tex_coord;\n"
+    "varying vec2 weight_coord;\n"
+    "varying vec3 light;\n"
+    "varying float fog;\n"
+    "void main() {\n"
+    "	vec4 ec = gl_ModelViewMatrix * gl_Vertex;\n"
+    "	vec3 n = normalize(gl_NormalMatrix * gl_Normal);\n"
+    "	vec3 c = gl_LightModel.ambient.rgb;\n"
+    "	for (int i = 0; i < 4; i++) {\n"
+    "		vec4 pos = gl_LightSource[i].position;\n"
+    "		vec3 l = normalize(pos.xyz - ec.xyz * pos.w);\n"
+    "		c += lights_on[i] * (gl_LightSource[i].ambient.rgb\n"
+    "		    + gl_LightSource[i].diffuse.rgb * max(dot(n, l), 0.0));\n"
+    "	}\n"
+    "	light = clamp(c, 0.0, 1.0);\n"
+    "	tex_coord = vec2(dot(gl_Vertex, gl_ObjectPlaneS[0]), dot(gl_Vertex, gl_ObjectPlaneT[0]));\n"
+    "	weight_coord = gl_Vertex.xz * weight_scale + weight_offset;\n"
+    "	float z = abs(ec.z);\n"
+    "	if (fog_mode == 1)\n"
+    "		fog = (gl_Fog.end - z) * gl_Fog.scale;\n"
+    "	else if (fog_mode == 2)\n"
+    "		fog = exp(-gl_Fog.density * z);\n"
+    "	else if (fog_mode == 3)\n"
+    "		fog = exp(-(gl_Fog.density * z) * (gl_Fog.density * z));\n"
+    "	else\n"
+    "		fog = 1.0;\n"
+    "	fog = clamp(fog, 0.0, 1.0);\n"
+    "	gl_Position = ftransform();\n"
+    "}\n";
+
+struct TTerrainShader {
+	bool valid;				// built for the current course
+	bool usable;			// false if building failed
+	GLuint program;
+	std::vector<GLuint> weight_maps;
+	std::vector<std::size_t> terrains;	// terrain indices with a texture
+	GLint weight_scale;
+	GLint weight_offset;
+	GLint lights_on[4];
+	GLint fog_mode;
+	GLfloat scale[2];
+	GLfloat offset[2];
+};
+
+static TTerrainShader shader = { false, false, 0 };
+
+void ResetTerrainShader() {
+	shader.valid = false;
+}
+
+static std::string FragmentSource(std::size_t num_terrains) {
+	std::size_t num_maps = (num_terrains + 3) / 4;
+	static const char channels[] = "rgba";
+	std::ostringstream os;
+	for (std::size_t k = 0; k < num_terrains; k++)
+		os << "uniform sampler2D terrain" << k << ";\n";
+	for (std::size_t m = 0; m < num_maps; m++)
+		os << "uniform sampler2D weights" << m << ";\n";
+	os << "varying vec2 tex_coord;\n"
+	   "varying vec2 weight_coord;\n"
+	   "varying vec3 light;\n"
+	   "varying float fog;\n"
+	   "void main() {\n";
+	for (std::size_t m = 0; m < num_maps; m++)
+		os << "	vec4 w" << m << " = texture2D(weights" << m << ", weight_coord);\n";
+	os << "	vec3 c = vec3(0.0);\n";
+	for (std::size_t k = 0; k < num_terrains; k++)
+		os << "	c += w" << k / 4 << '.' << channels[k % 4]
+		   << " * texture2D(terrain" << k << ", tex_coord).rgb;\n";
+	os << "	gl_FragColor = vec4(mix(gl_Fog.color.rgb, c * light, fog), 1.0);\n"
+	   "}\n";
+	return os.str();
+}
+
+static GLuint CompileShader(GLenum type, const char* source) {
+	GLuint obj = glCreateShader_p(type);
+	glShaderSource_p(obj, 1, &source, nullptr);
+	glCompileShader_p(obj);
+	GLint status = GL_FALSE;
+	glGetShaderiv_p(obj, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		char log[1024];
+		glGetShaderInfoLog_p(obj, sizeof(log), nullptr, log);
+		Message("terrain shader does not compile: ", log);
+		glDeleteShader_p(obj);
+		return 0;
+	}
+	return obj;
+}
+
+static bool BuildProgram(std::size_t num_terrains) {
+	if (shader.program != 0) {
+		glDeleteProgram_p(shader.program);
+		shader.program = 0;
+	}
+
+	std::string fragment_source = FragmentSource(num_terrains);
+	GLuint vs = CompileShader(GL_VERTEX_SHADER, vertex_source);
+	GLuint fs = CompileShader(GL_FRAGMENT_SHADER, fragment_source.c_str());
+	if (vs == 0 || fs == 0) {
+		if (vs != 0) glDeleteShader_p(vs);
+		if (fs != 0) glDeleteShader_p(fs);
+		return false;
+	}
+
+	shader.program = glCreateProgram_p();
+	glAttachShader_p(shader.program, vs);
+	glAttachShader_p(shader.program, fs);
+	glLinkProgram_p(shader.program);
+	glDeleteShader_p(vs);
+	glDeleteShader_p(fs);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv_p(shader.program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		char log[1024];
+		glGetProgramInfoLog_p(shader.program, sizeof(log), nullptr, log);
+		Message("terrain shader does not link: ", log);
+		glDeleteProgram_p(shader.program);
+		shader.program = 0;
+		return false;
+	}
+
+	// the samplers never change, the terrain textures come first
+	glUseProgram_p(shader.program);
+	std::size_t num_maps = (num_terrains + 3) / 4;
+	for (std::size_t k = 0; k < num_terrains; k++) {
+		std::ostringstream name;
+		name << "terrain" << k;
+		glUniform1i_p(glGetUniformLocation_p(shader.program, name.str().c_str()), (GLint)k);
+	}
+	for (std::size_t m = 0; m < num_maps; m++) {
+		std::ostringstream name;
+		name << "weights" << m;
+		glUniform1i_p(glGetUniformLocation_p(shader.program, name.str().c_str()), (GLint)(num_terrains + m));
+	}
+	glUseProgram_p(0);
+
+	shader.weight_scale = glGetUniformLocation_p(shader.program, "weight_scale");
+	shader.weight_offset = glGetUniformLocation_p(shader.program, "weight_offset");
+	for (int i = 0; i < 4; i++) {
+		std::ostringstream name;
+		name << "lights_on[" << i << ']';
+		shader.lights_on[i] = glGetUniformLocation_p(shader.program, name.str().c_str());
+	}
+	shader.fog_mode = glGetUniformLocation_p(shader.program, "fog_mode");
+	return true;
+}
+
+// One RGBA texel per course vertex, channel k % 4 of map k / 4 holds the
+// weight of the k-th textured terrain
+static void BuildWeightMaps(const CourseFields* fields, int nx, int nz) {
+	std::vector<int> channel(Course.TerrList.size(), -1);
+	for (std::size_t k = 0; k < shader.terrains.size(); k++)
+		channel[shader.terrains[k]] = (int)k;
+
+	std::size_t num_maps = (shader.terrains.size() + 3) / 4;
+	if (!shader.weight_maps.empty())
+		glDeleteTextures((GLsizei)shader.weight_maps.size(), &shader.weight_maps[0]);
+	shader.weight_maps.resize(num_maps);
+	glGenTextures((GLsizei)num_maps, &shader.weight_maps[0]);
+
+	std::vector<GLubyte> pixels(4 * nx * nz);
+	for (std::size_t m = 0; m < num_maps; m++) {
+		std::fill(pixels.begin(), pixels.end(), 0);
+		for (int i = 0; i < nx * nz; i++) {
+			int k = fields->terrain[i] < channel.size() ? channel[fields->terrain[i]] : -1;
+			if (k >= 0 && (std::size_t)k / 4 == m)
+				pixels[4 * i + k % 4] = 255;
+		}
+
+		glBindTexture(GL_TEXTURE_2D, shader.weight_maps[m]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, nx, nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static bool BuildTerrainShader(const CourseFields* fields, int nx, int nz,
+                               double scalex, double scalez) {
+	shader.terrains.clear();
+	for (std::size_t j = 0; j < Course.TerrList.size(); j++) {
+		if (Course.TerrList[j].texture != nullptr)
+			shader.terrains.push_back(j);
+	}
+	std::size_t num_terrains = shader.terrains.size();
+	std::size_t num_maps = (num_terrains + 3) / 4;
+
+	GLint max_units = 0, max_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units);
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	if (num_terrains == 0 || num_terrains > MAX_SHADER_TERRAINS
+	        || (GLint)(num_terrains + num_maps) > max_units
+	        || nx > max_size || nz > max_size) {
+		Message("terrain shader not usable for this course");
+		return false;
+	}
+
+	if (!BuildProgram(num_terrains))
+		return false;
+	BuildWeightMaps(fields, nx, nz);
+
+	// the texel centers lie on the course vertices
+	shader.scale[0] = (GLfloat)(1.0 / (scalex * nx));
+	shader.scale[1] = (GLfloat)(1.0 / (scalez * nz));
+	shader.offset[0] = 0.5f / nx;
+	shader.offset[1] = 0.5f / nz;
+	return true;
+}
+
+bool BeginTerrainShader(const CourseFields* fields, int nx, int nz,
+                        double scalex, double scalez) {
+	if (!param.terrain_shader || !HaveShaders())
+		return false;
+
+	if (!shader.valid) {
+		shader.usable = BuildTerrainShader(fields, nx, nz, scalex, scalez);
+		shader.valid = true;
+	}
+	if (!shader.usable)
+		return false;
+
+	std::size_t num_terrains = shader.terrains.size();
+	for (std::size_t k = 0; k < num_terrains; k++) {
+		glActiveTexture_p(GL_TEXTURE0 + (GLenum)k);
+		Course.TerrList[shader.terrains[k]].texture->Bind();
+	}
+	for (std::size_t m = 0; m < shader.weight_maps.size(); m++) {
+		glActiveTexture_p(GL_TEXTURE0 + (GLenum)(num_terrains + m));
+		glBindTexture(GL_TEXTURE_2D, shader.weight_maps[m]);
+	}
+	glActiveTexture_p(GL_TEXTURE0);
+
+	glUseProgram_p(shader.program);
+	glUniform2f_p(shader.weight_scale, shader.scale[0], shader.scale[1]);
+	glUniform2f_p(shader.weight_offset, shader.offset[0], shader.offset[1]);
+	for (int i = 0; i < 4; i++)
+		glUniform1f_p(shader.lights_on[i], glIsEnabled(GL_LIGHT0 + i) ? 1.f : 0.f);
+
+	GLint fog_mode = 0;
+	if (glIsEnabled(GL_FOG)) {
+		GLint mode = GL_LINEAR;
+		glGetIntegerv(GL_FOG_MODE, &mode);
+		fog_mode = mode == GL_EXP ? 2 : mode == GL_EXP2 ? 3 : 1;
+	}
+	glUniform1i_p(shader.fog_mode, fog_mode);
+	return true;
+}
+
+void EndTerrainShader() {
+	glUseProgram_p(0);
+	std::size_t units = shader.terrains.size() + shader.weight_maps.size();
+	for (std::size_t u = units; u-- > 1;) {
+		glActiveTexture_p(GL_TEXTURE0 + (GLenum)u);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	glActiveTexture_p(GL_TEXTURE0);
+}
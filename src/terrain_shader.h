@@ -0,0 +1,37 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifndef TERRAIN_SHADER_H
+#define TERRAIN_SHADER_H
+
+#include "bh.h"
+
+struct CourseFields;
+
+// Optional single pass renderer for the course terrain. At the first use
+// after a course change a weight map with one channel per terrain is built
+// from the course fields. The shader blends all terrain textures with the
+// filtered weights, so the visible mesh is drawn only once instead of once
+// per terrain. If shaders are not available or the course has too many
+// terrains, BeginTerrainShader returns false and the normal passes are used.
+
+void ResetTerrainShader();
+bool BeginTerrainShader(const CourseFields* fields, int nx, int nz,
+                        double scalex, double scalez);
+void EndTerrainShader();
+
+#endif
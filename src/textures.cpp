@@ -24,6 +24,7 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "ogl.h"
 #include "gui.h"
+#include "thread_pool.h"
 #include <cctype>
 
 
@@ -49,6 +50,12 @@ bool TTexture::Load(const std::string& dir, const std::string& filename, bool re
 	return Load(MakePathStr(dir, filename), repeatable);
 }
 
+bool TTexture::LoadFromImage(const sf::Image& image, bool repeatable) {
+	texture.setSmooth(true);
+	texture.setRepeated(repeatable);
+	return texture.loadFromImage(image);
+}
+
 void TTexture::Bind() {
 	sf::Texture::bind(&texture);
 }
@@ -302,3 +309,78 @@ void CTexture::DrawNumStr(const std::string& s, int x, int y, float size, const
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glDisableClientState(GL_VERTEX_ARRAY);
 }
+
+// --------------------------------------------------------------------
+//				class CTextureQueue
+// --------------------------------------------------------------------
+
+CTextureQueue TexQueue;
+
+CTextureQueue::CTextureQueue() : next_upload(0), total(0), decoded(0), uploaded(0) {
+}
+
+void CTextureQueue::Add(TTexture* texture, const std::string& file, bool repeatable, const std::string& fallback) {
+	std::lock_guard<std::mutex> lock(mutex);
+	TEntry entry;
+	entry.texture = texture;
+	entry.file = file;
+	entry.fallback = fallback;
+	entry.repeatable = repeatable;
+	entry.decoded = false;
+	entries.push_back(entry);
+	total++;
+}
+
+void CTextureQueue::Decode() {
+	std::vector<TEntry*> todo;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (std::size_t i = next_upload; i < entries.size(); i++) {
+			if (!entries[i].decoded)
+				todo.push_back(&entries[i]);
+		}
+	}
+
+	ParallelFor(todo.size(), [&](std::size_t i) {
+		TEntry& entry = *todo[i];
+		if (!entry.image.loadFromFile(entry.file) && !entry.fallback.empty())
+			entry.image.loadFromFile(entry.fallback);
+		decoded++;
+	});
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::size_t i = 0; i < todo.size(); i++)
+		todo[i]->decoded = true;
+}
+
+bool CTextureQueue::UploadNext() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (next_upload >= entries.size() || !entries[next_upload].decoded)
+		return false;
+
+	TEntry& entry = entries[next_upload++];
+	if (entry.image.getSize().x == 0)
+		Message("could not load texture", entry.file);
+	else if (!entry.texture->LoadFromImage(entry.image, entry.repeatable))
+		Message("could not create texture", entry.file);
+	uploaded++;
+
+	if (next_upload == entries.size()) {
+		entries.clear();
+		next_upload = 0;
+		total = decoded = uploaded = 0;
+	}
+	return true;
+}
+
+void CTextureQueue::LoadAll() {
+	Decode();
+	while (UploadNext()) {}
+}
+
+void CTextureQueue::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	next_upload = 0;
+	total = decoded = uploaded = 0;
+}
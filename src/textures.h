@@ -20,6 +20,9 @@ GNU General Public License for more details.
 
 #include "bh.h"
 #include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
 
 #define TEXLOGO 0
 #define SNOW_START 1
@@ -69,6 +72,7 @@ public:
 	bool Load(const std::string& filename, bool repeatable = false);
 	bool Load(const std::string& dir, const std::string& filename, bool repeatable = false);
 	bool Load(const std::string& dir, const char* filename, bool repeatable = false) { return Load(dir, std::string(filename), repeatable); }
+	bool LoadFromImage(const sf::Image& image, bool repeatable = false);
 
 	void Bind();
 	void Draw();
@@ -103,5 +107,43 @@ public:
 
 extern CTexture Tex;
 
+// --------------------------------------------------------------------
+//				class CTextureQueue
+// --------------------------------------------------------------------
+
+// Textures whose images are decoded on worker threads, while the GL
+// textures are created on the main thread. Add may be called from any
+// thread, Decode from one thread at a time and Upload from the main thread.
+class CTextureQueue {
+	struct TEntry {
+		TTexture* texture;
+		std::string file;
+		std::string fallback;	// tried if file can't be read
+		bool repeatable;
+		sf::Image image;
+		bool decoded;
+	};
+	std::deque<TEntry> entries;	// Add keeps the other entries in place
+	std::mutex mutex;
+	std::size_t next_upload;
+	std::atomic<std::size_t> total;
+	std::atomic<std::size_t> decoded;
+	std::atomic<std::size_t> uploaded;
+public:
+	CTextureQueue();
+
+	void Add(TTexture* texture, const std::string& file, bool repeatable, const std::string& fallback = "");
+	void Decode();
+	bool UploadNext();		// false if no decoded texture is waiting
+	void LoadAll();			// Decode and Upload everything at once
+	void Clear();			// drops the waiting textures, they stay empty
+
+	std::size_t Total() const { return total; }
+	std::size_t Decoded() const { return decoded; }
+	std::size_t Uploaded() const { return uploaded; }
+};
+
+extern CTextureQueue TexQueue;
+
 
 #endif
@@ -0,0 +1,148 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "thread_pool.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+
+#define MAX_WORKER_THREADS 7
+
+class CThreadPool {
+	std::vector<std::thread> threads;
+	bool started;
+	bool stop;
+
+	std::mutex run_mutex;		// one ParallelFor at a time
+	std::mutex mutex;			// guards the job state below
+	std::condition_variable work_cond;
+	std::condition_variable done_cond;
+	const std::function<void(std::size_t)>* job;
+	std::size_t count;
+	std::size_t next;
+	std::size_t pending;
+	unsigned int generation;
+
+	void Start();
+	void WorkerLoop();
+	void RunJobs(std::unique_lock<std::mutex>& lock);
+public:
+	CThreadPool() : started(false), stop(false), job(nullptr), count(0), next(0), pending(0), generation(0) {}
+	~CThreadPool();
+
+	void Run(std::size_t num, const std::function<void(std::size_t)>& func);
+	std::size_t Threads();
+};
+
+static CThreadPool pool;
+static thread_local bool in_job = false;
+
+CThreadPool::~CThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	work_cond.notify_all();
+	for (std::size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+void CThreadPool::Start() {
+	started = true;
+	unsigned int cores = std::thread::hardware_concurrency();
+	unsigned int num = cores > 1 ? std::min(cores - 1, (unsigned int)MAX_WORKER_THREADS) : 0;
+	for (unsigned int i = 0; i < num; i++)
+		threads.emplace_back(&CThreadPool::WorkerLoop, this);
+}
+
+std::size_t CThreadPool::Threads() {
+	std::lock_guard<std::mutex> lock(run_mutex);
+	if (!started)
+		Start();
+	return threads.size() + 1;
+}
+
+// Takes job indices until none are left; called with the lock held
+void CThreadPool::RunJobs(std::unique_lock<std::mutex>& lock) {
+	while (next < count) {
+		std::size_t idx = next++;
+		const std::function<void(std::size_t)>& func = *job;
+		lock.unlock();
+		in_job = true;
+		func(idx);
+		in_job = false;
+		lock.lock();
+		if (--pending == 0)
+			done_cond.notify_all();
+	}
+}
+
+void CThreadPool::WorkerLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	unsigned int seen = generation;
+	for (;;) {
+		work_cond.wait(lock, [&] { return stop || generation != seen; });
+		if (stop) return;
+		seen = generation;
+		RunJobs(lock);
+	}
+}
+
+void CThreadPool::Run(std::size_t num, const std::function<void(std::size_t)>& func) {
+	if (in_job || num <= 1) {
+		for (std::size_t i = 0; i < num; i++)
+			func(i);
+		return;
+	}
+
+	std::unique_lock<std::mutex> run_lock(run_mutex);
+	if (!started)
+		Start();
+	if (threads.empty()) {
+		run_lock.unlock();
+		for (std::size_t i = 0; i < num; i++)
+			func(i);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	job = &func;
+	count = num;
+	next = 0;
+	pending = num;
+	generation++;
+	work_cond.notify_all();
+
+	RunJobs(lock);
+	done_cond.wait(lock, [&] { return pending == 0; });
+	job = nullptr;
+	count = 0;
+}
+
+void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& job) {
+	pool.Run(count, job);
+}
+
+std::size_t ParallelThreads() {
+	return pool.Threads();
+}
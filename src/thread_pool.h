@@ -0,0 +1,34 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "bh.h"
+#include <functional>
+
+// Runs job(0) ... job(count-1) on a pool of worker threads and returns when
+// all of them are done. The calling thread takes part in the work. Jobs
+// that call ParallelFor themselves run their inner jobs directly, so nested
+// calls can't deadlock. The pool is started at the first call with one
+// thread less than the number of CPU cores.
+void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& job);
+
+// Number of threads ParallelFor can use, including the calling one
+std::size_t ParallelThreads();
+
+#endif
@@ -24,7 +24,8 @@ GNU General Public License for more details.
 #include "textures.h"
 #include "course.h"
 #include "physics.h"
-#include <list>
+#include <vector>
+#include <cstddef>
 
 #define TRACK_WIDTH 0.7
 #define MAX_TRACK_MARKS 10000
@@ -40,17 +41,55 @@ enum track_types_t {
 	NUM_TRACK_TYPES
 };
 
-struct track_quad_t {
-	TVector3d v1, v2, v3, v4;
-	TVector2d t1, t2, t3, t4;
-	TVector3d n1, n2, n3, n4;
-	track_types_t track_type;
-	uint8_t alpha;
+// The vertices of a quad are v1 = left, v2 = right at the start and
+// v3 = left, v4 = right at the end of the quad
+struct track_vertex_t {
+	GLfloat pos[3];
+	GLfloat nml[3];
+	GLfloat tex[2];
+	GLubyte col[4];
+};
+
+// Index ring of the quads of one track type in the order they were added.
+// Quads always join and leave at the back, except the oldest quad which is
+// dropped from the front when its slot is reused.
+struct track_index_ring_t {
+	std::vector<GLuint> indices;
+	std::size_t first;
+	std::size_t count;
+
+	void Clear() {
+		indices.resize(MAX_TRACK_MARKS * 4);
+		first = count = 0;
+	}
+	void PushBack(std::size_t slot) {
+		static const GLuint order[4] = { 0, 1, 3, 2 };
+		std::size_t pos = ((first + count) % MAX_TRACK_MARKS) * 4;
+		for (int i = 0; i < 4; i++)
+			indices[pos + i] = (GLuint)(slot * 4 + order[i]);
+		count++;
+	}
+	void PopBack() { count--; }
+	void PopFront() { first = (first + 1) % MAX_TRACK_MARKS; count--; }
+	void Draw() const {
+		if (count == 0) return;
+		std::size_t part = std::min(count, MAX_TRACK_MARKS - first);
+		glDrawElements(GL_QUADS, (GLsizei)(part * 4), GL_UNSIGNED_INT, &indices[first * 4]);
+		if (part < count)
+			glDrawElements(GL_QUADS, (GLsizei)((count - part) * 4), GL_UNSIGNED_INT, &indices[0]);
+	}
 };
 
 struct track_marks_t {
-	std::list<track_quad_t> quads;
-	std::list<track_quad_t>::iterator current_mark;
+	std::vector<track_vertex_t> vertices;	// 4 per quad slot
+	std::vector<track_types_t> types;		// one per quad slot
+	track_index_ring_t rings[NUM_TRACK_TYPES];
+	std::size_t oldest;		// slot of the oldest quad
+	std::size_t count;		// number of used slots
+	int current_mark;		// slot of the newest quad, -1 if none
+	std::vector<std::size_t> dirty;	// slots not uploaded yet
+	GLuint buffer;
+	bool buffer_valid;
 };
 
 static track_marks_t track_marks;
@@ -67,37 +106,90 @@ void SetTrackIDs(int id1, int id2, int id3) {
 }
 
 void init_track_marks() {
-	track_marks.quads.clear();
-	track_marks.current_mark = track_marks.quads.begin();
+	track_marks.vertices.resize(MAX_TRACK_MARKS * 4);
+	track_marks.types.resize(MAX_TRACK_MARKS);
+	for (int t = 0; t < NUM_TRACK_TYPES; t++)
+		track_marks.rings[t].Clear();
+	track_marks.oldest = 0;
+	track_marks.count = 0;
+	track_marks.current_mark = -1;
+	track_marks.dirty.clear();
+	track_marks.buffer_valid = false;
 	continuing_track = false;
 }
 
-template<typename T>
-static T incrementRingIterator(T q) {
-	T ret = q;
-	++ret;
-	if (ret == track_marks.quads.end())
-		ret = track_marks.quads.begin();
-	return ret;
+// Returns the slot before the given one or -1 if it is the oldest
+static int PrevSlot(int slot) {
+	if (slot < 0 || track_marks.count == 0 || (std::size_t)slot == track_marks.oldest)
+		return -1;
+	return slot == 0 ? MAX_TRACK_MARKS - 1 : slot - 1;
+}
+
+static void SetTrackType(std::size_t slot, track_types_t type) {
+	track_types_t& old_type = track_marks.types[slot];
+	if (old_type == type) return;
+	track_marks.rings[old_type].PopBack();
+	track_marks.rings[type].PushBack(slot);
+	old_type = type;
 }
 
-template<typename T>
-static T decrementRingIterator(T q) {
-	T ret = q;
-	if (ret == track_marks.quads.begin())
-		return track_marks.quads.end();
-	--ret;
-	return ret;
+// Remembers a changed quad for the next upload. Too many changes are
+// cheaper to upload at once.
+static void MarkDirty(std::size_t slot) {
+	if (!track_marks.buffer_valid) return;
+	if (track_marks.dirty.size() >= 256) {
+		track_marks.buffer_valid = false;
+		track_marks.dirty.clear();
+	} else {
+		track_marks.dirty.push_back(slot);
+	}
+}
+
+static track_vertex_t* QuadVertices(std::size_t slot) {
+	return &track_marks.vertices[slot * 4];
+}
+
+static void SetVertex(track_vertex_t& v, const TVector3d& pos, const TVector3d& nml,
+                      GLfloat s, GLfloat t, uint8_t alpha) {
+	v.pos[0] = (GLfloat)pos.x;
+	v.pos[1] = (GLfloat)pos.y;
+	v.pos[2] = (GLfloat)pos.z;
+	v.nml[0] = (GLfloat)nml.x;
+	v.nml[1] = (GLfloat)nml.y;
+	v.nml[2] = (GLfloat)nml.z;
+	v.tex[0] = s;
+	v.tex[1] = t;
+	v.col[0] = v.col[1] = v.col[2] = 255;
+	v.col[3] = alpha;
+}
+
+static void UploadTrackmarks() {
+	const std::size_t vertex_size = sizeof(track_vertex_t);
+	if (!track_marks.buffer_valid) {
+		if (track_marks.buffer == 0)
+			glGenBuffers_p(1, &track_marks.buffer);
+		glBindBuffer_p(GL_ARRAY_BUFFER, track_marks.buffer);
+		glBufferData_p(GL_ARRAY_BUFFER, track_marks.vertices.size() * vertex_size,
+		               &track_marks.vertices[0], GL_DYNAMIC_DRAW);
+		track_marks.buffer_valid = true;
+	} else {
+		glBindBuffer_p(GL_ARRAY_BUFFER, track_marks.buffer);
+		for (std::size_t i = 0; i < track_marks.dirty.size(); i++) {
+			std::size_t slot = track_marks.dirty[i];
+			glBufferSubData_p(GL_ARRAY_BUFFER, slot * 4 * vertex_size, 4 * vertex_size,
+			                  QuadVertices(slot));
+		}
+	}
+	track_marks.dirty.clear();
 }
 
 void DrawTrackmarks() {
-	if (param.perf_level < 3 || track_marks.quads.empty())
+	if (param.perf_level < 3 || track_marks.count == 0)
 		return;
 
 	TTexture* textures[NUM_TRACK_TYPES];
 
-	sf::Color track_colour = colWhite;
-	set_material(track_colour, colBlack, 1.0);
+	set_material(colWhite, colBlack, 1.0);
 	ScopedRenderMode rm(TRACK_MARKS);
 
 	textures[TRACK_HEAD] = Tex.GetTexture(trackid1);
@@ -106,91 +198,58 @@ void DrawTrackmarks() {
 
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
-	for (std::list<track_quad_t>::const_iterator q = track_marks.quads.begin(); q != track_marks.quads.end(); ++q) {
-		if (q->alpha != track_colour.a) {
-			track_colour.a = q->alpha;
-			set_material_diffuse(track_colour);
-		}
-		textures[q->track_type]->Bind();
-
-		if ((q->track_type == TRACK_HEAD) || (q->track_type == TRACK_TAIL)) {
-			glBegin(GL_QUADS);
-
-			glNormal3(q->n1);
-			glTexCoord2(q->t1);
-			glVertex3(q->v1);
-
-			glNormal3(q->n2);
-			glTexCoord2(q->t2);
-			glVertex3(q->v2);
-
-			glNormal3(q->n4);
-			glTexCoord2(q->t4);
-			glVertex3(q->v4);
-
-			glNormal3(q->n3);
-			glTexCoord2(q->t3);
-			glVertex3(q->v3);
-
-			glEnd();
-
-		} else {
-			glBegin(GL_QUAD_STRIP);
-			glNormal3(q->n2);
-			glTexCoord2(q->t2);
-			glVertex3(q->v2);
-
-			glNormal3(q->n1);
-			glTexCoord2(q->t1);
-			glVertex3(q->v1);
-
-			glNormal3(q->n4);
-			glTexCoord2(q->t4);
-			glVertex3(q->v4);
-
-			glNormal3(q->n3);
-			glTexCoord2(q->t3);
-			glVertex3(q->v3);
-
-			std::list<track_quad_t>::const_iterator qnext = q;
-			++qnext;
-			while (qnext != track_marks.quads.end() && qnext->track_type != TRACK_TAIL) {
-				q = qnext;
-				if (q->alpha != track_colour.a) {
-					track_colour.a = q->alpha;
-					set_material_diffuse(track_colour);
-				}
-
-				glNormal3(q->n4);
-				glTexCoord2(q->t4);
-				glVertex3(q->v4);
-
-				glNormal3(q->n3);
-				glTexCoord2(q->t3);
-				glVertex3(q->v3);
-
-				++qnext;
-			}
-			glEnd();
-		}
+	const GLsizei stride = sizeof(track_vertex_t);
+	const GLubyte* base;
+	if (HaveBufferObjects()) {
+		UploadTrackmarks();
+		base = nullptr;
+	} else {
+		base = reinterpret_cast<const GLubyte*>(&track_marks.vertices[0]);
 	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, stride, base + offsetof(track_vertex_t, pos));
+	glNormalPointer(GL_FLOAT, stride, base + offsetof(track_vertex_t, nml));
+	glTexCoordPointer(2, GL_FLOAT, stride, base + offsetof(track_vertex_t, tex));
+	glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(track_vertex_t, col));
+
+	for (int t = 0; t < NUM_TRACK_TYPES; t++) {
+		if (track_marks.rings[t].count == 0) continue;
+		textures[t]->Bind();
+		track_marks.rings[t].Draw();
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (HaveBufferObjects())
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
+	glColor(colWhite);
 }
 
 void break_track_marks() {
 	if (!continuing_track)
 		return;
 
-	std::list<track_quad_t>::iterator q = track_marks.current_mark;
-	if (q != track_marks.quads.end()) {
-		q->track_type = TRACK_TAIL;
-		q->t1 = TVector2d(0.0, 0.0);
-		q->t2 = TVector2d(1.0, 0.0);
-		q->t3 = TVector2d(0.0, 1.0);
-		q->t4 = TVector2d(1.0, 1.0);
-		std::list<track_quad_t>::iterator qprev = decrementRingIterator(q);
-		if (qprev != track_marks.quads.end()) {
-			qprev->t3.y = std::max(qprev->t3.y+0.5, qprev->t1.y+1.0);
-			qprev->t4.y = std::max(qprev->t3.y+0.5, qprev->t1.y+1.0);
+	int q = track_marks.current_mark;
+	if (q >= 0) {
+		SetTrackType(q, TRACK_TAIL);
+		track_vertex_t* v = QuadVertices(q);
+		v[0].tex[0] = 0.f; v[0].tex[1] = 0.f;
+		v[1].tex[0] = 1.f; v[1].tex[1] = 0.f;
+		v[2].tex[0] = 0.f; v[2].tex[1] = 1.f;
+		v[3].tex[0] = 1.f; v[3].tex[1] = 1.f;
+		MarkDirty(q);
+		int qprev = PrevSlot(q);
+		if (qprev >= 0) {
+			track_vertex_t* pv = QuadVertices(qprev);
+			pv[2].tex[1] = std::max(pv[2].tex[1] + 0.5f, pv[0].tex[1] + 1.f);
+			pv[3].tex[1] = std::max(pv[2].tex[1] + 0.5f, pv[0].tex[1] + 1.f);
+			MarkDirty(qprev);
 		}
 	}
 	continuing_track = false;
@@ -200,7 +259,8 @@ void add_track_mark(const CControl *ctrl, int *id) {
 	if (param.perf_level < 3)
 		return;
 
-	*id = Course.GetTerrainIdx(ctrl->cpos.x, ctrl->cpos.z, 0.5);
+	TSurfaceSample surf = Course.SampleSurface(ctrl->cpos.x, ctrl->cpos.z);
+	*id = surf.TerrainIdx(0.5);
 	if (*id < 1) {
 		break_track_marks();
 		return;
@@ -228,15 +288,17 @@ void add_track_mark(const CControl *ctrl, int *id) {
 	TVector3d right_vector = -TRACK_WIDTH/2.0 * width_vector;
 	TVector3d left_wing =  ctrl->cpos - left_vector;
 	TVector3d right_wing = ctrl->cpos - right_vector;
-	double left_y = Course.FindYCoord(left_wing.x, left_wing.z);
-	double right_y = Course.FindYCoord(right_wing.x, right_wing.z);
+	TSurfaceSample left_surf = Course.SampleSurface(left_wing.x, left_wing.z);
+	TSurfaceSample right_surf = Course.SampleSurface(right_wing.x, right_wing.z);
+	double left_y = left_surf.elevation;
+	double right_y = right_surf.elevation;
 
 	if (std::fabs(left_y-right_y) > MAX_TRACK_DEPTH) {
 		break_track_marks();
 		return;
 	}
 
-	TPlane surf_plane = Course.GetLocalCoursePlane(ctrl->cpos);
+	TPlane surf_plane = surf.Plane(ctrl->cpos.x, ctrl->cpos.z);
 	double dist_from_surface = DistanceToPlane(surf_plane, ctrl->cpos);
 	double comp_depth = 0.1;
 	if (dist_from_surface >= (2 * comp_depth)) {
@@ -244,48 +306,45 @@ void add_track_mark(const CControl *ctrl, int *id) {
 		return;
 	}
 
-	if (track_marks.quads.size() < MAX_TRACK_MARKS)
-		track_marks.quads.emplace_back();
-	std::list<track_quad_t>::iterator qprev = track_marks.current_mark;
-	if (track_marks.current_mark == track_marks.quads.end())
-		track_marks.current_mark = track_marks.quads.begin();
-	else
-		track_marks.current_mark = incrementRingIterator(track_marks.current_mark);
-	std::list<track_quad_t>::iterator q = track_marks.current_mark;
-
-	if (!continuing_track) {
-		q->track_type = TRACK_HEAD;
-		q->v1 = TVector3d(left_wing.x, left_y + TRACK_HEIGHT, left_wing.z);
-		q->v2 = TVector3d(right_wing.x, right_y + TRACK_HEIGHT, right_wing.z);
-		q->v3 = TVector3d(left_wing.x, left_y + TRACK_HEIGHT, left_wing.z);
-		q->v4 = TVector3d(right_wing.x, right_y + TRACK_HEIGHT, right_wing.z);
-		q->n1 = Course.FindCourseNormal(q->v1.x, q->v1.z);
-		q->n2 = Course.FindCourseNormal(q->v2.x, q->v2.z);
-		q->n3 = Course.FindCourseNormal(q->v3.x, q->v3.z);
-		q->n4 = Course.FindCourseNormal(q->v4.x, q->v4.z);
-		q->t1 = TVector2d(0.0, 0.0);
-		q->t2 = TVector2d(1.0, 0.0);
-		q->t3 = TVector2d(0.0, 1.0);
-		q->t4 = TVector2d(1.0, 1.0);
+	if (track_marks.vertices.empty())
+		init_track_marks();
+
+	int qprev = track_marks.current_mark;
+	std::size_t q = qprev < 0 ? track_marks.oldest : (qprev + 1) % MAX_TRACK_MARKS;
+	if (track_marks.count == MAX_TRACK_MARKS) {
+		// reuse the slot of the oldest quad
+		track_marks.rings[track_marks.types[q]].PopFront();
+		track_marks.oldest = (track_marks.oldest + 1) % MAX_TRACK_MARKS;
+	} else {
+		track_marks.count++;
+	}
+	track_marks.current_mark = (int)q;
+
+	uint8_t alpha = std::min(static_cast<int>((2*comp_depth-dist_from_surface)/(4*comp_depth)*255), 255);
+	TVector3d left_pt(left_wing.x, left_y + TRACK_HEIGHT, left_wing.z);
+	TVector3d right_pt(right_wing.x, right_y + TRACK_HEIGHT, right_wing.z);
+	track_vertex_t* v = QuadVertices(q);
+
+	if (!continuing_track || qprev < 0) {
+		track_marks.types[q] = TRACK_HEAD;
+		SetVertex(v[0], left_pt, left_surf.normal, 0.f, 0.f, alpha);
+		SetVertex(v[1], right_pt, right_surf.normal, 1.f, 0.f, alpha);
+		SetVertex(v[2], left_pt, left_surf.normal, 0.f, 1.f, alpha);
+		SetVertex(v[3], right_pt, right_surf.normal, 1.f, 1.f, alpha);
 	} else {
-		q->track_type = TRACK_TAIL;
-		q->v1 = qprev->v3;
-		q->v2 = qprev->v4;
-		q->v3 = TVector3d(left_wing.x, left_y + TRACK_HEIGHT, left_wing.z);
-		q->v4 = TVector3d(right_wing.x, right_y + TRACK_HEIGHT, right_wing.z);
-		q->n1 = qprev->n3;
-		q->n2 = qprev->n4;
-		q->n3 = Course.FindCourseNormal(q->v3.x, q->v3.z);
-		q->n4 = Course.FindCourseNormal(q->v4.x, q->v4.z);
-		q->t1 = qprev->t3;
-		q->t2 = qprev->t4;
-		double tex_end = speed*g_game.time_step/TRACK_WIDTH;
-		q->t3 = TVector2d(0.0, q->t1.y + tex_end);
-		q->t4 = TVector2d(1.0, q->t2.y + tex_end);
-		if (qprev->track_type == TRACK_TAIL)
-			qprev->track_type = TRACK_MARK;
+		// the start of the quad continues the end of the previous one
+		const track_vertex_t* pv = QuadVertices(qprev);
+		track_marks.types[q] = TRACK_TAIL;
+		v[0] = pv[2];
+		v[1] = pv[3];
+		GLfloat tex_end = (GLfloat)(speed*g_game.time_step/TRACK_WIDTH);
+		SetVertex(v[2], left_pt, left_surf.normal, 0.f, v[0].tex[1] + tex_end, alpha);
+		SetVertex(v[3], right_pt, right_surf.normal, 1.f, v[1].tex[1] + tex_end, alpha);
+		if (track_marks.types[qprev] == TRACK_TAIL)
+			SetTrackType(qprev, TRACK_MARK);
 	}
-	q->alpha = std::min(static_cast<int>((2*comp_depth-dist_from_surface)/(4*comp_depth)*255), 255);
+	track_marks.rings[track_marks.types[q]].PushBack(q);
+	MarkDirty(q);
 	continuing_track = true;
 }
 
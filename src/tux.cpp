@@ -30,12 +30,8 @@ still shaped with spheres.
 #include "textures.h"
 #include "course.h"
 #include "physics.h"
-#if !defined(MACOS)
-#include <GL/glu.h>
-#else
-#include <OpenGL/glu.h>
-#endif
 #include <algorithm>
+#include <mutex>
 
 #define MAX_ARM_ANGLE2 30.0
 #define MAX_PADDLING_ANGLE2 35.0
@@ -69,6 +65,8 @@ CCharShape::CCharShape() {
 	useHighlighting = false;
 	highlighted = false;
 	highlight_node = -1;
+	draw_stats.triangles = 0;
+	draw_stats.draw_calls = 0;
 }
 
 CCharShape::~CCharShape() {
@@ -367,13 +365,69 @@ void CCharShape::CreateMaterial(const std::string& line) {
 //				drawing
 // --------------------------------------------------------------------
 
-void CCharShape::DrawCharSphere(int num_divisions) const {
-	GLUquadricObj *qobj = gluNewQuadric();
-	gluQuadricDrawStyle(qobj, GLU_FILL);
-	gluQuadricOrientation(qobj, GLU_OUTSIDE);
-	gluQuadricNormals(qobj, GLU_SMOOTH);
-	gluSphere(qobj, 1.0, (GLint)2.0 * num_divisions, num_divisions);
-	gluDeleteQuadric(qobj);
+// The unit spheres of all division levels are tessellated once, with
+// the same layout as gluSphere (2*div slices, div stacks). Position and
+// normal of a vertex are the same vector.
+struct TSphereMesh {
+	std::vector<GLfloat> vtx;
+	std::vector<GLushort> idx;
+};
+
+static TSphereMesh sphere_meshes[MAX_SPHERE_DIV + 1];
+static std::once_flag sphere_meshes_built;
+
+static void BuildSphereMeshes() {
+	for (int div = MIN_SPHERE_DIV; div <= MAX_SPHERE_DIV; div++) {
+		TSphereMesh& mesh = sphere_meshes[div];
+		int stacks = div;
+		int slices = 2 * div;
+		for (int i = 0; i <= stacks; i++) {
+			double phi = M_PI * i / stacks;
+			for (int j = 0; j <= slices; j++) {
+				double theta = 2.0 * M_PI * (j % slices) / slices;
+				mesh.vtx.push_back(std::sin(theta) * std::sin(phi));
+				mesh.vtx.push_back(std::cos(theta) * std::sin(phi));
+				mesh.vtx.push_back(std::cos(phi));
+			}
+		}
+		for (int i = 0; i < stacks; i++) {
+			for (int j = 0; j < slices; j++) {
+				GLushort a = i * (slices + 1) + j;
+				GLushort b = a + 1;
+				GLushort c = a + slices + 1;
+				GLushort d = c + 1;
+				if (i > 0) {	// triangles touching a pole have no area
+					mesh.idx.push_back(a);
+					mesh.idx.push_back(b);
+					mesh.idx.push_back(c);
+				}
+				if (i < stacks - 1) {
+					mesh.idx.push_back(b);
+					mesh.idx.push_back(d);
+					mesh.idx.push_back(c);
+				}
+			}
+		}
+	}
+}
+
+// Shapes can be loaded on several threads at once, see CSimulation
+static void InitSphereMeshes() {
+	std::call_once(sphere_meshes_built, BuildSphereMeshes);
+}
+
+static const TSphereMesh& GetSphereMesh(int num_divisions) {
+	return sphere_meshes[clamp(MIN_SPHERE_DIV, num_divisions, MAX_SPHERE_DIV)];
+}
+
+void CCharShape::DrawCharSphere(int num_divisions) {
+	const TSphereMesh& mesh = GetSphereMesh(num_divisions);
+	glVertexPointer(3, GL_FLOAT, 0, &mesh.vtx[0]);
+	glNormalPointer(GL_FLOAT, 0, &mesh.vtx[0]);
+	glDrawElements(GL_TRIANGLES, (GLsizei)mesh.idx.size(), GL_UNSIGNED_SHORT, &mesh.idx[0]);
+
+	draw_stats.triangles += mesh.idx.size() / 3;
+	draw_stats.draw_calls++;
 }
 
 void CCharShape::DrawNodes(const TCharNode *node) {
@@ -415,7 +469,15 @@ void CCharShape::Draw() {
 	const TCharNode *node = GetNode(0);
 	if (node == nullptr) return;
 
+	InitSphereMeshes();
+	draw_stats.triangles = 0;
+	draw_stats.draw_calls = 0;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
 	DrawNodes(node);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 	glDisable(GL_NORMALIZE);
 	if (param.perf_level > 2 && g_game.argument == 0) DrawShadow();
 	highlighted = false;
@@ -427,6 +489,7 @@ bool CCharShape::Load(const std::string& dir, const std::string& filename, bool
 	CSPList list;
 
 	useActions = with_actions;
+	InitSphereMeshes();
 	CreateRootNode();
 	newActions = true;
 
@@ -642,99 +705,37 @@ bool CCharShape::Collision(const TVector3d& pos, const TPolyhedron& ph) {
 //				shadow
 // --------------------------------------------------------------------
 
-void CCharShape::DrawShadowVertex(double x, double y, double z, const TMatrix<4, 4>& mat) const {
-	TVector3d pt(x, y, z);
-	pt = TransformPoint(mat, pt);
-	double old_y = pt.y;
-	TVector3d nml = Course.FindCourseNormal(pt.x, pt.z);
-	pt.y = Course.FindYCoord(pt.x, pt.z) + SHADOW_HEIGHT;
-	if (pt.y > old_y) pt.y = old_y;
-	glNormal3(nml);
-	glVertex3(pt);
-}
-
-void CCharShape::DrawShadowSphere(const TMatrix<4, 4>& mat) const {
-	double theta, phi, d_theta, d_phi, eps, twopi;
-	double x, y, z;
-	int div = param.tux_shadow_sphere_divisions;
-
-	eps = 1e-15;
-	twopi = M_PI * 2.0;
-	d_theta = d_phi = M_PI / div;
-
-	for (phi = 0.0; phi + eps < M_PI; phi += d_phi) {
-		double cos_theta, sin_theta;
-		double sin_phi, cos_phi;
-		double sin_phi_d_phi, cos_phi_d_phi;
-
-		sin_phi = std::sin(phi);
-		cos_phi = std::cos(phi);
-		sin_phi_d_phi = std::sin(phi + d_phi);
-		cos_phi_d_phi = std::cos(phi + d_phi);
-
-		if (phi <= eps) {
-			glBegin(GL_TRIANGLE_FAN);
-			DrawShadowVertex(0., 0., 1., mat);
-
-			for (theta = 0.0; theta + eps < twopi; theta += d_theta) {
-				sin_theta = std::sin(theta);
-				cos_theta = std::cos(theta);
-
-				x = cos_theta * sin_phi_d_phi;
-				y = sin_theta * sin_phi_d_phi;
-				z = cos_phi_d_phi;
-				DrawShadowVertex(x, y, z, mat);
-			}
-			x = sin_phi_d_phi;
-			y = 0.0;
-			z = cos_phi_d_phi;
-			DrawShadowVertex(x, y, z, mat);
-			glEnd();
-		} else if (phi + d_phi + eps >= M_PI) {
-			glBegin(GL_TRIANGLE_FAN);
-			DrawShadowVertex(0., 0., -1., mat);
-			for (theta = twopi; theta - eps > 0; theta -= d_theta) {
-				sin_theta = std::sin(theta);
-				cos_theta = std::cos(theta);
-				x = cos_theta * sin_phi;
-				y = sin_theta * sin_phi;
-				z = cos_phi;
-				DrawShadowVertex(x, y, z, mat);
-			}
-			x = sin_phi;
-			y = 0.0;
-			z = cos_phi;
-			DrawShadowVertex(x, y, z, mat);
-			glEnd();
-		} else {
-			glBegin(GL_TRIANGLE_STRIP);
-			for (theta = 0.0; theta + eps < twopi; theta += d_theta) {
-				sin_theta = std::sin(theta);
-				cos_theta = std::cos(theta);
-				x = cos_theta * sin_phi;
-				y = sin_theta * sin_phi;
-				z = cos_phi;
-				DrawShadowVertex(x, y, z, mat);
-
-				x = cos_theta * sin_phi_d_phi;
-				y = sin_theta * sin_phi_d_phi;
-				z = cos_phi_d_phi;
-				DrawShadowVertex(x, y, z, mat);
-			}
-			x = sin_phi;
-			y = 0.0;
-			z = cos_phi;
-			DrawShadowVertex(x, y, z, mat);
-			x = sin_phi_d_phi;
-			y = 0.0;
-			z = cos_phi_d_phi;
-			DrawShadowVertex(x, y, z, mat);
-			glEnd();
-		}
+void CCharShape::DrawShadowSphere(const TMatrix<4, 4>& mat) {
+	static std::vector<GLfloat> vtx;
+	static std::vector<GLfloat> nml;
+
+	const TSphereMesh& mesh = GetSphereMesh(param.tux_shadow_sphere_divisions);
+	std::size_t num = mesh.vtx.size() / 3;
+	vtx.resize(mesh.vtx.size());
+	nml.resize(mesh.vtx.size());
+
+	// the sphere is projected onto the course surface below it
+	for (std::size_t i = 0; i < num; i++) {
+		TVector3d pt(mesh.vtx[i*3], mesh.vtx[i*3+1], mesh.vtx[i*3+2]);
+		pt = TransformPoint(mat, pt);
+		TSurfaceSample surf = Course.SampleSurface(pt.x, pt.z);
+		vtx[i*3] = pt.x;
+		vtx[i*3+1] = std::min(surf.elevation + SHADOW_HEIGHT, pt.y);
+		vtx[i*3+2] = pt.z;
+		nml[i*3] = surf.normal.x;
+		nml[i*3+1] = surf.normal.y;
+		nml[i*3+2] = surf.normal.z;
 	}
+
+	glVertexPointer(3, GL_FLOAT, 0, &vtx[0]);
+	glNormalPointer(GL_FLOAT, 0, &nml[0]);
+	glDrawElements(GL_TRIANGLES, (GLsizei)mesh.idx.size(), GL_UNSIGNED_SHORT, &mesh.idx[0]);
+
+	draw_stats.triangles += mesh.idx.size() / 3;
+	draw_stats.draw_calls++;
 }
 
-void CCharShape::TraverseDagForShadow(const TCharNode *node, const TMatrix<4, 4>& mat) const {
+void CCharShape::TraverseDagForShadow(const TCharNode *node, const TMatrix<4, 4>& mat) {
 	TMatrix<4, 4> new_matrix = mat * node->trans;
 	if (node->visible && node->render_shadow)
 		DrawShadowSphere(new_matrix);
@@ -746,7 +747,7 @@ void CCharShape::TraverseDagForShadow(const TCharNode *node, const TMatrix<4, 4>
 	}
 }
 
-void CCharShape::DrawShadow() const {
+void CCharShape::DrawShadow() {
 	if (g_game.light_id == 1 || g_game.light_id == 3) return;
 
 	ScopedRenderMode rm(TUX_SHADOW);
@@ -757,7 +758,12 @@ void CCharShape::DrawShadow() const {
 		Message("couldn't find tux's root node");
 		return;
 	}
+	InitSphereMeshes();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
 	TraverseDagForShadow(node, TMatrix<4, 4>::getIdentity());
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 // --------------------------------------------------------------------
@@ -69,6 +69,12 @@ struct TCharNode {
 	bool visible;
 };
 
+// what the last Draw() of a character has cost
+struct TCharDrawStats {
+	std::size_t triangles;
+	std::size_t draw_calls;
+};
+
 class CCharShape {
 private:
 	TCharNode *Nodes[MAX_CHAR_NODES];
@@ -94,7 +100,7 @@ private:
 	void CreateMaterial(const std::string& line);
 
 	// drawing
-	void DrawCharSphere(int num_divisions) const;
+	void DrawCharSphere(int num_divisions);
 	void DrawNodes(const TCharNode *node);
 	TVector3d AdjustRollvector(const CControl *ctrl, const TVector3d& vel, const TVector3d& zvec);
 
@@ -104,9 +110,8 @@ private:
 	bool CheckCollision(const TPolyhedron& ph);
 
 	// shadow
-	void DrawShadowVertex(double x, double y, double z, const TMatrix<4, 4>& mat) const;
-	void DrawShadowSphere(const TMatrix<4, 4>& mat) const;
-	void TraverseDagForShadow(const TCharNode *node, const TMatrix<4, 4>& mat) const;
+	void DrawShadowSphere(const TMatrix<4, 4>& mat);
+	void TraverseDagForShadow(const TCharNode *node, const TMatrix<4, 4>& mat);
 
 	// testing and developing
 	void AddAction(std::size_t node_name, int type, const TVector3d& vec, double val);
@@ -117,6 +122,7 @@ public:
 	bool useHighlighting;
 	bool   highlighted;
 	std::size_t highlight_node;
+	TCharDrawStats draw_stats;
 	std::unordered_map<std::string, std::size_t> NodeIndex;
 
 	// nodes
@@ -132,7 +138,7 @@ public:
 	// global functions
 	void Reset();
 	void Draw();
-	void DrawShadow() const;
+	void DrawShadow();
 	bool Load(const std::string& dir, const std::string& filename, bool with_actions);
 
 	void AdjustOrientation(CControl *ctrl, double dtime,
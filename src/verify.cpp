@@ -0,0 +1,150 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "bh.h"
+#include "simulate.h"
+#include "replay.h"
+#include "spx.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <iostream>
+
+// etr-verify replays all the race recordings (.etrr) of a directory without
+// a window and checks whether each of them ends like the recorded race. The
+// replays are spread over one thread per CPU core; every thread has its own
+// CSimulation and keeps its course loaded for the following replays.
+
+enum TVerifyResult {
+	VERIFY_UNREADABLE,
+	VERIFY_FAILED,		// the course or the character couldn't be loaded
+	VERIFY_MISMATCH,
+	VERIFY_VALID
+};
+
+struct TVerifyJob {
+	std::string file;
+	CReplay replay;
+	TVerifyResult result;
+	float duration;		// simulated seconds
+	float elapsed;		// wall clock seconds
+};
+
+static const char* ResultName(TVerifyResult result) {
+	switch (result) {
+		case VERIFY_UNREADABLE:
+			return "unreadable";
+		case VERIFY_FAILED:
+			return "not loaded";
+		case VERIFY_MISMATCH:
+			return "MISMATCH";
+		default:
+			return "valid";
+	}
+}
+
+static std::string SimSpeed(float duration, float elapsed) {
+	return Float_StrN(duration / std::max(elapsed, 0.001f), 1) + " s/s";
+}
+
+// Replays of the same course follow each other, so a thread rarely has to
+// load another course
+static bool SameCourseFirst(const TVerifyJob* a, const TVerifyJob* b) {
+	if (a->replay.group != b->replay.group) return a->replay.group < b->replay.group;
+	if (a->replay.course != b->replay.course) return a->replay.course < b->replay.course;
+	if (a->replay.mirrored != b->replay.mirrored) return b->replay.mirrored;
+	if (a->replay.treesize != b->replay.treesize) return a->replay.treesize < b->replay.treesize;
+	if (a->replay.treevar != b->replay.treevar) return a->replay.treevar < b->replay.treevar;
+	return a->replay.character < b->replay.character;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		std::cout << "usage: etr-verify <replay directory>\n";
+		return -1;
+	}
+	InitConfig();
+	if (!LoadSimulationResources())
+		return -1;
+
+	std::string dir = argv[1];
+	std::vector<std::string> files;
+	if (!ListFiles(dir, ".etrr", files))
+		return -1;
+
+	std::vector<TVerifyJob> jobs(files.size());
+	std::vector<TVerifyJob*> queue;
+	for (std::size_t i = 0; i < files.size(); i++) {
+		jobs[i].file = files[i];
+		jobs[i].result = VERIFY_UNREADABLE;
+		jobs[i].duration = 0.f;
+		jobs[i].elapsed = 0.f;
+		if (jobs[i].replay.Load(MakePathStr(dir, files[i]))) {
+			jobs[i].duration = jobs[i].replay.Duration();
+			queue.push_back(&jobs[i]);
+		}
+	}
+	std::stable_sort(queue.begin(), queue.end(), SameCourseFirst);
+
+	// threads of its own, the pool of ParallelFor is limited and shared
+	// with the course loading
+	std::atomic<std::size_t> next(0);
+	std::size_t threads = std::min((std::size_t)std::max(std::thread::hardware_concurrency(), 1u), queue.size());
+	sf::Clock clock;
+	std::vector<std::thread> workers;
+	for (std::size_t t = 0; t < threads; t++) {
+		workers.emplace_back([&] {
+			std::unique_ptr<CSimulation> sim(new CSimulation);
+			for (std::size_t n = next++; n < queue.size(); n = next++) {
+				TVerifyJob* job = queue[n];
+				if (!PlayReplay(*sim, job->replay, &job->elapsed))
+					job->result = VERIFY_FAILED;
+				else
+					job->result = job->replay.Matches(&sim->ctrl) ? VERIFY_VALID : VERIFY_MISMATCH;
+			}
+		});
+	}
+	for (std::size_t t = 0; t < threads; t++)
+		workers[t].join();
+	float wall_time = clock.getElapsedTime().asSeconds();
+
+	std::size_t count[VERIFY_VALID + 1] = {0, 0, 0, 0};
+	float sim_time = 0.f;
+	for (std::size_t i = 0; i < jobs.size(); i++) {
+		const TVerifyJob& job = jobs[i];
+		count[job.result]++;
+		std::cout << job.file << "  " << ResultName(job.result);
+		if (job.result >= VERIFY_MISMATCH) {
+			sim_time += job.duration;
+			std::cout << "  " << Float_StrN(job.duration, 2) << " s, "
+			          << SimSpeed(job.duration, job.elapsed);
+		}
+		std::cout << '\n';
+	}
+
+	std::cout << "\nreplays: " << jobs.size() << ", valid " << count[VERIFY_VALID]
+	          << ", mismatches " << count[VERIFY_MISMATCH]
+	          << ", not verified " << count[VERIFY_UNREADABLE] + count[VERIFY_FAILED] << '\n';
+	std::cout << "simulated " << Float_StrN(sim_time, 1) << " s in "
+	          << Float_StrN(wall_time, 2) << " s on " << threads << " threads, "
+	          << SimSpeed(sim_time, wall_time) << '\n';
+	return count[VERIFY_VALID] == jobs.size() ? 0 : 1;
+}
@@ -390,6 +390,14 @@ clip_result_t clip_aabb_to_view_frustum(const TVector3d& min, const TVector3d& m
 	return NoClip;
 }
 
+bool sphere_in_view_frustum(const TVector3d& center, double radius) {
+	for (int i=0; i<6; i++) {
+		if (DotProduct(center, frustum_planes[i].nml) + frustum_planes[i].d > radius)
+			return false;
+	}
+	return true;
+}
+
 const TPlane& get_far_clip_plane() { return frustum_planes[1]; }
 const TPlane& get_left_clip_plane() { return frustum_planes[2]; }
 const TPlane& get_right_clip_plane() { return frustum_planes[3]; }
@@ -38,6 +38,7 @@ enum clip_result_t {
 
 void SetupViewFrustum(const CControl *ctrl);
 clip_result_t clip_aabb_to_view_frustum(const TVector3d& min, const TVector3d& max);
+bool sphere_in_view_frustum(const TVector3d& center, double radius);
 
 const TPlane& get_far_clip_plane();
 const TPlane& get_left_clip_plane();
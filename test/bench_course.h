@@ -0,0 +1,63 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#ifndef BENCH_COURSE_H
+#define BENCH_COURSE_H
+
+#include <benchmark/benchmark.h>
+#include "bh.h"
+#include "simulate.h"
+#include <random>
+
+// Some stock courses from small to large, for benchmarks taking the
+// course index as argument
+static const char* const bench_courses[] = {
+	"bunny_hill", "bumpy_ride", "frozen_river", "path_of_daggers", "wild_mountains"
+};
+#define NUM_BENCH_COURSES (sizeof(bench_courses) / sizeof(bench_courses[0]))
+
+// The simulation the benchmarks share; it keeps the course of the last
+// call loaded
+inline CSimulation* BenchSimulation(benchmark::State& state, const char* course) {
+	static CSimulation sim;
+	if (!sim.Load("default", course, "tux", false)) {
+		state.SkipWithError("course not loaded");
+		return nullptr;
+	}
+	state.SetLabel(course);
+	return &sim;
+}
+
+// n points spread over the play area of the course, the same on each run
+inline std::vector<TVector2d> BenchPoints(const CCourse& course, std::size_t n) {
+	std::mt19937 gen(4711);
+	const TVector2d& dim = course.GetDimensions();
+	const TVector2d& play = course.GetPlayDimensions();
+	double border = (dim.x - play.x) / 2.0;
+	std::uniform_real_distribution<double> xs(border, dim.x - border);
+	std::uniform_real_distribution<double> zs(-play.y, 0.0);
+	std::vector<TVector2d> points(n);
+	for (std::size_t i = 0; i < n; i++)
+		points[i] = TVector2d(xs(gen), zs(gen));
+	return points;
+}
+
+#endif
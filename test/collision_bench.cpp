@@ -0,0 +1,73 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "bench_course.h"
+#include "course.h"
+
+#define NUM_POINTS 4096
+#define PLAYER_RADIUS 0.6	// see CControl::CheckTreeCollisions
+
+// The bounding circle test of the tree collision, as the grid query of
+// CheckTreeCollisions runs it
+static void BM_TreeCandidatesGrid(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, bench_courses[state.range(0)]);
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	std::vector<TVector2d> points = BenchPoints(course, NUM_POINTS);
+	std::size_t p = 0;
+	for (auto _ : state) {
+		const TVector2d& pos = points[p++ % NUM_POINTS];
+		int hits = 0;
+		course.CollGrid.Query(pos.x, pos.y, PLAYER_RADIUS, [&](uint32_t i) {
+			const TCollidable& tree = course.CollArr[i];
+			double dx = tree.pt.x - pos.x;
+			double dz = tree.pt.z - pos.y;
+			double r = tree.diam / 2.0 + PLAYER_RADIUS;
+			hits += dx * dx + dz * dz <= r * r;
+		});
+		benchmark::DoNotOptimize(hits);
+	}
+	state.counters["trees"] = (double)course.CollArr.size();
+}
+BENCHMARK(BM_TreeCandidatesGrid)->DenseRange(0, NUM_BENCH_COURSES - 1);
+
+// The same test with the linear scan over all trees the grid replaced
+static void BM_TreeCandidatesScan(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, bench_courses[state.range(0)]);
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	std::vector<TVector2d> points = BenchPoints(course, NUM_POINTS);
+	std::size_t p = 0;
+	for (auto _ : state) {
+		const TVector2d& pos = points[p++ % NUM_POINTS];
+		int hits = 0;
+		for (std::size_t i = 0; i < course.CollArr.size(); i++) {
+			const TCollidable& tree = course.CollArr[i];
+			double dx = tree.pt.x - pos.x;
+			double dz = tree.pt.z - pos.y;
+			double r = tree.diam / 2.0 + PLAYER_RADIUS;
+			hits += dx * dx + dz * dz <= r * r;
+		}
+		benchmark::DoNotOptimize(hits);
+	}
+	state.counters["trees"] = (double)course.CollArr.size();
+}
+BENCHMARK(BM_TreeCandidatesScan)->DenseRange(0, NUM_BENCH_COURSES - 1);
@@ -0,0 +1,232 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+// before bh.h, which pulls in X11 macros like None
+#include <gtest/gtest.h>
+#include "bh.h"
+#include "simulate.h"
+#include "course.h"
+#include "quadtree.h"
+#include "view.h"
+#include "winsys.h"
+#include "game_config.h"
+#include "test_camera.h"
+
+static const CCourse& LoadedCourse(CSimulation& sim, const std::string& course) {
+	EXPECT_TRUE(sim.Load("default", course, "tux", false));
+	return sim.RaceCourse();
+}
+
+TEST(Course, BatchElevationMatchesSingle) {
+	CSimulation sim;
+	const CCourse& course = LoadedCourse(sim, "bumpy_ride");
+	const TVector2d& dim = course.GetDimensions();
+
+	// a grid of points including some off the course at the borders
+	std::vector<float> xs, zs;
+	for (int i = -2; i <= 52; i++) {
+		for (int j = -2; j <= 52; j++) {
+			xs.push_back((float)(dim.x * i / 50.0 + 0.37));
+			zs.push_back((float)(-dim.y * j / 50.0 - 0.81));
+		}
+	}
+	std::vector<float> ys(xs.size());
+	course.FindYCoordBatch(xs.data(), zs.data(), ys.data(), xs.size());
+	// the batch interpolates in float
+	for (std::size_t i = 0; i < xs.size(); i++)
+		ASSERT_NEAR(ys[i], course.FindYCoord(xs[i], zs[i]), 1e-3) << "at " << xs[i] << ", " << zs[i];
+}
+
+TEST(Course, PackedNormalsRoundTrip) {
+	// the course cache stores the normals packed, a course loaded from it
+	// must have the same normals as one computed from the maps
+	for (bool mirrored : { false, true }) {
+		CSimulation sim;
+		ASSERT_TRUE(sim.Load("default", "bumpy_ride", "tux", mirrored));
+		const CourseFields& fields = sim.RaceCourse().Fields;
+		std::vector<uint32_t> packed, repacked;
+		fields.PackNormals(packed);
+		CourseFields loaded;
+		loaded.resize(fields.size());
+		loaded.UnpackNormals(packed);
+		EXPECT_TRUE(loaded.normals == fields.normals) << "mirrored " << mirrored;
+		loaded.PackNormals(repacked);
+		EXPECT_TRUE(repacked == packed) << "mirrored " << mirrored;
+	}
+}
+
+TEST(Course, ParallelQuadtreeTrianglesMatchSerial) {
+	CSimulation sim;
+	const CCourse& course = LoadedCourse(sim, "frozen_river");
+	CourseFields fields = course.Fields;
+	int nx, ny;
+	course.GetDivisions(&nx, &ny);
+	const TVector2d& dim = course.GetDimensions();
+	const TVector2d& start = course.GetStartPoint();
+	CControl* ctrl = &sim.ctrl;
+	Winsys.resolution = TScreenRes(1280, 720);
+
+	TVector3d pos(start.x, course.FindYCoord(start.x, start.y) + 4.0, start.y);
+	InitQuadtree(&fields, course.TerrList.size(), nx, ny, dim.x / (nx - 1.0),
+	             -dim.y / (ny - 1.0), pos, param.course_detail_level);
+
+	// down the course, with the camera looking back uphill now and then
+	for (int step = 0; step < 8; step++) {
+		double z = start.y - step * dim.y / 10.0;
+		pos = TVector3d(dim.x / 2.0, course.FindYCoord(dim.x / 2.0, z) + 4.0, z);
+		SetTestCamera(ctrl, pos, TVector3d(0.3 * (step % 3 - 1), -0.3, step % 4 == 3 ? 1.0 : -1.0));
+		SetupViewFrustum(ctrl);
+		UpdateQuadtree(pos, param.course_detail_level);
+
+		std::vector<std::vector<GLuint> > serial, parallel;
+		ExtractQuadtreeTris(serial, false);
+		ExtractQuadtreeTris(parallel, true);
+		ASSERT_EQ(serial.size(), course.TerrList.size() + 1);
+		std::size_t total = 0;
+		for (std::size_t p = 0; p < serial.size(); p++) {
+			EXPECT_EQ(serial[p], parallel[p]) << "pass " << p << " at step " << step;
+			total += serial[p].size();
+		}
+		EXPECT_GT(total, 0u) << "at step " << step;
+	}
+	ResetQuadtree();
+}
+
+// The enabled flags and the triangles of the quadtree as it is
+struct TQuadtreeState {
+	std::vector<unsigned char> flags;
+	std::vector<std::vector<GLuint> > tris;
+
+	void Take() {
+		GetQuadtreeFlags(flags);
+		ExtractQuadtreeTris(tris, false);
+	}
+	bool operator==(const TQuadtreeState& other) const {
+		return flags == other.flags && tris == other.tris;
+	}
+};
+
+// Updates with the budget until an update uses less than the budget and
+// changes nothing; returns the number of updates
+static int SettleQuadtree(const TVector3d& pos, int budget) {
+	std::vector<unsigned char> flags, last;
+	GetQuadtreeFlags(last);
+	for (int updates = 1; updates < 100000; updates++) {
+		bool complete = UpdateQuadtree(pos, param.course_detail_level, budget);
+		GetQuadtreeFlags(flags);
+		if (complete && flags == last)
+			return updates;
+		last.swap(flags);
+	}
+	return -1;
+}
+
+TEST(Course, IncrementalQuadtreeUpdateMatchesFull) {
+	CSimulation sim;
+	const CCourse& course = LoadedCourse(sim, "frozen_river");
+	CourseFields fields = course.Fields;
+	int nx, ny;
+	course.GetDivisions(&nx, &ny);
+	const TVector2d& dim = course.GetDimensions();
+	const TVector2d& start = course.GetStartPoint();
+	CControl* ctrl = &sim.ctrl;
+	Winsys.resolution = TScreenRes(1280, 720);
+
+	auto camera = [&](double x, double z) {
+		TVector3d pos(x, course.FindYCoord(x, z) + 4.0, z);
+		SetTestCamera(ctrl, pos, TVector3d(0.2, -0.3, -1.0));
+		SetupViewFrustum(ctrl);
+		return pos;
+	};
+	// racing speed at 60 frames per second, one update with the budget
+	// per frame; a tight budget leaves many subtrees half updated
+	TVector3d pos;
+	TQuadtreeState incremental, full;
+	for (int budget : { 200, 2 }) {
+		pos = camera(start.x, start.y);
+		InitQuadtree(&fields, course.TerrList.size(), nx, ny, dim.x / (nx - 1.0),
+		             -dim.y / (ny - 1.0), pos, param.course_detail_level);
+		for (int frame = 1; frame <= 600; frame++) {
+			pos = camera(start.x + 10.0 * std::sin(frame * 0.01), start.y - frame * 0.3);
+			UpdateQuadtree(pos, param.course_detail_level, budget);
+			if (frame % 100 != 0) continue;
+
+			// once the budget does not bite any more, an update of the whole
+			// tree must not find anything the incremental updates left out
+			ASSERT_GT(SettleQuadtree(pos, budget), 0) << "at frame " << frame;
+			incremental.Take();
+			UpdateQuadtree(pos, param.course_detail_level);
+			full.Take();
+			EXPECT_TRUE(incremental == full) << "at frame " << frame << " with budget " << budget;
+		}
+	}
+
+	// a jump down the course leaves too much to do for one frame with a
+	// tiny budget; the work is spread over the following frames
+	pos = camera(dim.x / 2.0, -dim.y * 0.7);
+	int frames = SettleQuadtree(pos, 1);
+	EXPECT_GT(frames, 2);
+	incremental.Take();
+	UpdateQuadtree(pos, param.course_detail_level);
+	full.Take();
+	EXPECT_TRUE(incremental == full);
+	ResetQuadtree();
+}
+
+TEST(Course, ParallelQuadtreeUpdateMatchesSerial) {
+	CSimulation sim;
+	const CCourse& course = LoadedCourse(sim, "frozen_river");
+	CourseFields fields = course.Fields;
+	int nx, ny;
+	course.GetDivisions(&nx, &ny);
+	const TVector2d& dim = course.GetDimensions();
+	const TVector2d& start = course.GetStartPoint();
+	CControl* ctrl = &sim.ctrl;
+	Winsys.resolution = TScreenRes(1280, 720);
+
+	// the same flight down the course with both kinds of update, crossing
+	// the borders between the root children
+	std::vector<TQuadtreeState> serial;
+	for (int run = 0; run < 2; run++) {
+		bool parallel = run == 1;
+		TVector3d pos(start.x, course.FindYCoord(start.x, start.y) + 4.0, start.y);
+		SetTestCamera(ctrl, pos, TVector3d(0.0, -0.3, -1.0));
+		SetupViewFrustum(ctrl);
+		InitQuadtree(&fields, course.TerrList.size(), nx, ny, dim.x / (nx - 1.0),
+		             -dim.y / (ny - 1.0), pos, param.course_detail_level);
+		for (int step = 0; step < 40; step++) {
+			double x = dim.x * (0.5 + 0.4 * std::sin(step * 0.3));
+			double z = start.y - step * dim.y / 45.0;
+			pos = TVector3d(x, course.FindYCoord(x, z) + 4.0, z);
+			SetTestCamera(ctrl, pos, TVector3d(0.3 * (step % 3 - 1), -0.3, step % 4 == 3 ? 1.0 : -1.0));
+			SetupViewFrustum(ctrl);
+			UpdateQuadtree(pos, param.course_detail_level, 0, parallel);
+
+			TQuadtreeState state;
+			state.Take();
+			if (run == 0)
+				serial.push_back(state);
+			else
+				EXPECT_TRUE(state == serial[step]) << "at step " << step;
+		}
+		ResetQuadtree();
+	}
+}
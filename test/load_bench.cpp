@@ -0,0 +1,43 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "bench_course.h"
+#include "course.h"
+
+// Loading a stock course from its maps, without the cache: the elevation,
+// the normals and the terrain and tree maps. Another course is loaded in
+// between, untimed, so the course is really loaded each time. The counter
+// is the memory of the course fields.
+static void BM_LoadCourse(benchmark::State& state) {
+	const char* course = bench_courses[state.range(0)];
+	const char* other = state.range(0) == 0 ? bench_courses[1] : bench_courses[0];
+	CSimulation* sim = nullptr;
+	for (auto _ : state) {
+		state.PauseTiming();
+		if (BenchSimulation(state, other) == nullptr) return;
+		state.ResumeTiming();
+		sim = BenchSimulation(state, course);
+		if (sim == nullptr) return;
+	}
+	if (sim != nullptr)
+		state.counters["fields_KB"] = sim->RaceCourse().Fields.Bytes() / 1024.0;
+}
+BENCHMARK(BM_LoadCourse)->DenseRange(0, NUM_BENCH_COURSES - 1)->Unit(benchmark::kMillisecond);
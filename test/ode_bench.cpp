@@ -0,0 +1,208 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include <benchmark/benchmark.h>
+#include "bh.h"
+#include "mathlib.h"
+#include <cmath>
+
+// The integrator of the race physics on its own, with a cheap force
+// (gravity and quadratic drag) in place of CalcNetForce, so that the
+// cost of the solver itself is what is measured. BM_OdeStepTable is the
+// solver as it was before TOdeStep: a table of function pointers, called
+// once per component of position and velocity.
+
+namespace {
+
+const double BODY_MASS = 20.0;
+const double DRAG = 0.05;
+const int STEPS = 1000;
+const double STEP_SIZE = 0.01;
+
+TVector3d Force(const TVector3d& vel) {
+	double speed = std::sqrt(vel.x * vel.x + vel.y * vel.y + vel.z * vel.z);
+	return TVector3d(-DRAG * speed * vel.x,
+	                 -BODY_MASS * 9.81 - DRAG * speed * vel.y,
+	                 -DRAG * speed * vel.z);
+}
+
+// --------------------------------------------------------------------
+//		the former solver
+// --------------------------------------------------------------------
+
+struct TOdeData {
+	double k[4];
+	double init_val;
+	double h;
+};
+
+const double ode23_coeff_mat[][4] = {
+	{0.0, 1./2.,   0.0,  2./9.},
+	{0.0,   0.0, 3./4.,  1./3.},
+	{0.0,   0.0,   0.0,  4./9.},
+	{0.0,   0.0,   0.0,    0.0}
+};
+const double ode23_error_mat[] = {-5./72., 1./12., 1./9., -1./8. };
+
+int ode23_NumEstimates() {return 4; }
+
+void ode23_InitOdeData(TOdeData *data, double init_val, double h) {
+	data->init_val = init_val;
+	data->h = h;
+}
+
+double ode23_NextValue(TOdeData *data, int step) {
+	double val = data->init_val;
+	for (int i=0; i<step; i++)
+		val += ode23_coeff_mat[i][step] * data->k[i];
+	return val;
+}
+
+void ode23_UpdateEstimate(TOdeData *data, int step, double val) {
+	data->k[step] = data->h * val;
+}
+
+double ode23_FinalEstimate(TOdeData *data) {
+	double val = data->init_val;
+	for (int i=0; i<3; i++)
+		val += ode23_coeff_mat[i][3] * data->k[i];
+	return val;
+}
+
+double ode23_EstimateError(TOdeData *data) {
+	double err=0.;
+	for (int i=0; i<4; i++)
+		err += ode23_error_mat[i] * data->k[i];
+	return std::fabs(err);
+}
+
+struct TOdeSolver {
+	int (*NumEstimates)();
+	void (*InitOdeData)(TOdeData *, double init_val, double h);
+	double (*NextValue)(TOdeData *, int step);
+	void (*UpdateEstimate)(TOdeData *, int step, double val);
+	double (*FinalEstimate)(TOdeData *);
+	double (*EstimateError)(TOdeData *);
+	TOdeSolver() {
+		NumEstimates = ode23_NumEstimates;
+		InitOdeData = ode23_InitOdeData;
+		NextValue = ode23_NextValue;
+		UpdateEstimate = ode23_UpdateEstimate;
+		FinalEstimate = ode23_FinalEstimate;
+		EstimateError = ode23_EstimateError;
+	}
+};
+
+// the table was filled in by a constructor in mathlib.cpp, so the compiler
+// couldn't see through the calls; the volatile pointer keeps it that way
+const TOdeSolver table_solver;
+const TOdeSolver* volatile table_solver_ptr = &table_solver;
+
+double TableStep(TVector3d& pos, TVector3d& vel, double h) {
+	const TOdeSolver& solver = *table_solver_ptr;
+	TOdeData x, y, z, vx, vy, vz;
+	solver.InitOdeData(&x, pos.x, h);
+	solver.InitOdeData(&y, pos.y, h);
+	solver.InitOdeData(&z, pos.z, h);
+	solver.InitOdeData(&vx, vel.x, h);
+	solver.InitOdeData(&vy, vel.y, h);
+	solver.InitOdeData(&vz, vel.z, h);
+
+	TVector3d f = Force(vel);
+	solver.UpdateEstimate(&x, 0, vel.x);
+	solver.UpdateEstimate(&y, 0, vel.y);
+	solver.UpdateEstimate(&z, 0, vel.z);
+	solver.UpdateEstimate(&vx, 0, f.x / BODY_MASS);
+	solver.UpdateEstimate(&vy, 0, f.y / BODY_MASS);
+	solver.UpdateEstimate(&vz, 0, f.z / BODY_MASS);
+
+	for (int i=1; i < solver.NumEstimates(); i++) {
+		pos.x = solver.NextValue(&x, i);
+		pos.y = solver.NextValue(&y, i);
+		pos.z = solver.NextValue(&z, i);
+		vel.x = solver.NextValue(&vx, i);
+		vel.y = solver.NextValue(&vy, i);
+		vel.z = solver.NextValue(&vz, i);
+
+		solver.UpdateEstimate(&x, i, vel.x);
+		solver.UpdateEstimate(&y, i, vel.y);
+		solver.UpdateEstimate(&z, i, vel.z);
+		f = Force(vel);
+		solver.UpdateEstimate(&vx, i, f.x / BODY_MASS);
+		solver.UpdateEstimate(&vy, i, f.y / BODY_MASS);
+		solver.UpdateEstimate(&vz, i, f.z / BODY_MASS);
+	}
+
+	pos.x = solver.FinalEstimate(&x);
+	pos.y = solver.FinalEstimate(&y);
+	pos.z = solver.FinalEstimate(&z);
+	vel.x = solver.FinalEstimate(&vx);
+	vel.y = solver.FinalEstimate(&vy);
+	vel.z = solver.FinalEstimate(&vz);
+
+	double pos_err[3] = { solver.EstimateError(&x), solver.EstimateError(&y), solver.EstimateError(&z) };
+	double vel_err[3] = { solver.EstimateError(&vx), solver.EstimateError(&vy), solver.EstimateError(&vz) };
+	double tot_pos_err = 0., tot_vel_err = 0.;
+	for (int i=0; i<3; i++) {
+		tot_pos_err += pos_err[i] * pos_err[i];
+		tot_vel_err += vel_err[i] * vel_err[i];
+	}
+	return std::sqrt(tot_pos_err) + std::sqrt(tot_vel_err);
+}
+
+// --------------------------------------------------------------------
+
+double TemplateStep(TVector3d& pos, TVector3d& vel, double h) {
+	TOdeStep<TOde23> step(pos, vel, h);
+	TVector3d f = Force(vel);
+	step.UpdateEstimate(0, vel, TVector3d(f.x / BODY_MASS, f.y / BODY_MASS, f.z / BODY_MASS));
+	for (int i=1; i < TOde23::NumEstimates; i++) {
+		step.NextValue(i, pos, vel);
+		f = Force(vel);
+		step.UpdateEstimate(i, vel, TVector3d(f.x / BODY_MASS, f.y / BODY_MASS, f.z / BODY_MASS));
+	}
+	step.FinalEstimate(pos, vel);
+	double pos_err, vel_err;
+	step.EstimateError(pos_err, vel_err);
+	return pos_err + vel_err;
+}
+
+template<double (*Step)(TVector3d&, TVector3d&, double)>
+void BM_OdeStep(benchmark::State& state) {
+	for (auto _ : state) {
+		TVector3d pos(0, 100, 0);
+		TVector3d vel(12, 3, -20);
+		double err = 0;
+		for (int i=0; i<STEPS; i++)
+			err += Step(pos, vel, STEP_SIZE);
+		benchmark::DoNotOptimize(pos);
+		benchmark::DoNotOptimize(vel);
+		benchmark::DoNotOptimize(err);
+	}
+	state.SetItemsProcessed(state.iterations() * STEPS);
+}
+
+}  // namespace
+
+static void BM_OdeStepTable(benchmark::State& state) { BM_OdeStep<TableStep>(state); }
+static void BM_OdeStepTemplate(benchmark::State& state) { BM_OdeStep<TemplateStep>(state); }
+BENCHMARK(BM_OdeStepTable);
+BENCHMARK(BM_OdeStepTemplate);
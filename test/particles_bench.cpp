@@ -0,0 +1,55 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "bench_course.h"
+#include "course.h"
+#include "particles.h"
+#include "physics.h"
+
+#define PARTICLE_FRAME (1.f / 60.f)
+#define BRAKE_SPEED 40.0
+
+// A frame of Tux braking at full speed in the snow, which sprays the most
+// particles: the new particles are sprayed and all are updated.
+static void BM_BrakeParticles(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, "bunny_hill");
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	sim->StartRace(0, 0);
+	CControl* ctrl = &sim->ctrl;
+	const TVector2d& start = course.GetStartPoint();
+	TVector3d pos(start.x, course.FindYCoord(start.x, start.y) - 0.1, start.y);
+	ctrl->cdirection = TVector3d(0, 0, -1);
+	ctrl->plane_nml = course.FindCourseNormal(pos.x, pos.z);
+	ctrl->is_braking = true;
+
+	clear_particles();
+	for (int i = 0; i < 60; i++) {
+		generate_particles(ctrl, PARTICLE_FRAME, pos, BRAKE_SPEED);
+		update_particles(course, PARTICLE_FRAME);
+	}
+	for (auto _ : state) {
+		generate_particles(ctrl, PARTICLE_FRAME, pos, BRAKE_SPEED);
+		update_particles(course, PARTICLE_FRAME);
+	}
+	clear_particles();
+}
+BENCHMARK(BM_BrakeParticles);
@@ -0,0 +1,97 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "bench_course.h"
+#include "course.h"
+#include "quadtree.h"
+#include "physics.h"
+#include "test_camera.h"
+#include "view.h"
+#include "winsys.h"
+#include "game_config.h"
+#include "thread_pool.h"
+
+// Builds the quadtree of a stock course like FinishLoadCourse does, with
+// the camera at the start. The counters give the size of the tree.
+static void BM_InitQuadtree(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, bench_courses[state.range(0)]);
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	CourseFields fields = course.Fields;
+	int nx, ny;
+	course.GetDivisions(&nx, &ny);
+	const TVector2d& dim = course.GetDimensions();
+	const TVector2d& start = course.GetStartPoint();
+	TVector3d view_pos(start.x, course.FindYCoord(start.x, start.y) + 4.0, start.y + 5.0);
+
+	for (auto _ : state) {
+		InitQuadtree(&fields, course.TerrList.size(), nx, ny, dim.x / (nx - 1.0),
+		             -dim.y / (ny - 1.0), view_pos, param.course_detail_level);
+		state.PauseTiming();
+		std::size_t nodes, bytes, reserved;
+		GetQuadtreeStats(&nodes, &bytes, &reserved);
+		state.counters["nodes"] = (double)nodes;
+		state.counters["KB"] = bytes / 1024.0;
+		state.counters["KB_reserved"] = reserved / 1024.0;
+		ResetQuadtree();
+		state.ResumeTiming();
+	}
+}
+BENCHMARK(BM_InitQuadtree)->DenseRange(0, NUM_BENCH_COURSES - 1)->Unit(benchmark::kMillisecond);
+
+// Full LOD updates on a flight down the largest stock course, one per
+// frame. The argument selects the serial (0) or the
+// parallel (1) update of the root children.
+static void BM_UpdateQuadtree(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, "wild_mountains");
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	CControl* ctrl = &sim->ctrl;
+	Winsys.resolution = TScreenRes(1280, 720);
+	CourseFields fields = course.Fields;
+	int nx, ny;
+	course.GetDivisions(&nx, &ny);
+	const TVector2d& dim = course.GetDimensions();
+	const TVector2d& start = course.GetStartPoint();
+	const TVector2d& play = course.GetPlayDimensions();
+	bool parallel = state.range(0) != 0;
+
+	TVector3d pos(start.x, course.FindYCoord(start.x, start.y) + 4.0, start.y);
+	SetTestCamera(ctrl, pos, TVector3d(0.0, -0.3, -1.0));
+	SetupViewFrustum(ctrl);
+	InitQuadtree(&fields, course.TerrList.size(), nx, ny, dim.x / (nx - 1.0),
+	             -dim.y / (ny - 1.0), pos, param.course_detail_level);
+
+	std::size_t frame = 0;
+	for (auto _ : state) {
+		double z = start.y - play.y * (frame++ % 2000) / 2000.0;
+		pos = TVector3d(dim.x / 2.0, course.FindYCoord(dim.x / 2.0, z) + 4.0, z);
+		SetTestCamera(ctrl, pos, TVector3d(0.0, -0.3, -1.0));
+		SetupViewFrustum(ctrl);
+		UpdateQuadtree(pos, param.course_detail_level, 0, parallel);
+	}
+	std::size_t nodes, bytes, reserved;
+	GetQuadtreeStats(&nodes, &bytes, &reserved);
+	state.counters["nodes"] = (double)nodes;
+	state.counters["threads"] = parallel ? (double)ParallelThreads() : 1.0;
+	ResetQuadtree();
+}
+BENCHMARK(BM_UpdateQuadtree)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,43 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifndef RACE_SCRIPT_H
+#define RACE_SCRIPT_H
+
+#include "bh.h"
+#include "racing.h"
+#include <cmath>
+
+// A race input for the tests and benchmarks: Tux weaves from side to side,
+// paddles, brakes and jumps now and then. The frame times vary like in the
+// game.
+
+inline TRaceInput ScriptedInput(std::size_t frame) {
+	TRaceInput input;
+	input.turn = (float)std::sin(frame * 0.01);
+	input.paddle = (frame / 100) % 3 == 0;
+	input.brake = (frame / 70) % 5 == 0;
+	input.charge = frame % 400 > 350;
+	input.trick = frame % 400 > 380;
+	return input;
+}
+
+inline float ScriptedTimeStep(std::size_t frame) {
+	return 1.f / 60.f + (frame % 7) * 0.0005f;
+}
+
+#endif
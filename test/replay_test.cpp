@@ -0,0 +1,123 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+// before bh.h, which pulls in X11 macros like None
+#include <gtest/gtest.h>
+#include "bh.h"
+#include "simulate.h"
+#include "replay.h"
+#include "reset.h"
+#include "race_script.h"
+#include <cstdio>
+
+#define RACE_FRAMES 3000
+#define RESET_FRAME 1500
+
+// Races on course with the scripted input and records the race into
+// replay. In the middle Tux is reset like with the reset key.
+static void RecordRace(CSimulation& sim, const std::string& course, bool mirrored, CReplay& replay) {
+	ASSERT_TRUE(sim.Load("default", course, "tux", mirrored));
+	replay.group = "default";
+	replay.course = course;
+	replay.character = "tux";
+	replay.mirrored = mirrored;
+	replay.wind_id = 2;
+	replay.seed = 1234;
+
+	CControl* ctrl = &sim.ctrl;
+	sim.StartRace(replay.wind_id, replay.seed);
+	replay.Record(ctrl);
+	EnterRace(ctrl, true, true);
+	replay.AddEnter(true, true);
+	for (std::size_t i = 0; i < RACE_FRAMES && !ctrl->ctx->finish; i++) {
+		float time_step = ScriptedTimeStep(i);
+		if (i == RESET_FRAME) {
+			StepReset(ctrl, time_step, true);
+			replay.AddReset(time_step, true);
+			EnterRace(ctrl, false, true);
+			replay.AddEnter(false, true);
+		} else {
+			TRaceInput input = ScriptedInput(i);
+			StepRace(ctrl, input, time_step, IsAirborne(ctrl));
+			replay.AddRace(time_step, input);
+		}
+	}
+	replay.Finish(ctrl);
+}
+
+TEST(Replay, MatchesRecordedRace) {
+	CReplay replay;
+	{
+		CSimulation sim;
+		RecordRace(sim, "bunny_hill", false, replay);
+	}
+	ASSERT_GT(replay.frames.size(), 1000u);
+	EXPECT_GT(replay.time, 0.f);
+
+	CSimulation sim;
+	float elapsed;
+	ASSERT_TRUE(PlayReplay(sim, replay, &elapsed));
+	EXPECT_TRUE(replay.Matches(&sim.ctrl));
+}
+
+TEST(Replay, MatchesInReusedSimulation) {
+	CSimulation sim;
+	CReplay first, second;
+	RecordRace(sim, "bunny_hill", false, first);
+	RecordRace(sim, "bumpy_ride", true, second);
+
+	// the simulation keeps its course, wind and character between races
+	float elapsed;
+	for (int i = 0; i < 2; i++) {
+		ASSERT_TRUE(PlayReplay(sim, first, &elapsed));
+		EXPECT_TRUE(first.Matches(&sim.ctrl));
+		ASSERT_TRUE(PlayReplay(sim, second, &elapsed));
+		EXPECT_TRUE(second.Matches(&sim.ctrl));
+	}
+}
+
+TEST(Replay, SurvivesSaveAndLoad) {
+	CSimulation sim;
+	CReplay replay;
+	RecordRace(sim, "bunny_hill", false, replay);
+
+	std::string file = testing::TempDir() + "etr_replay_test.etrr";
+	ASSERT_TRUE(replay.Save(file));
+	CReplay loaded;
+	ASSERT_TRUE(loaded.Load(file));
+	std::remove(file.c_str());
+	EXPECT_EQ(loaded.frames.size(), replay.frames.size());
+
+	float elapsed;
+	ASSERT_TRUE(PlayReplay(sim, loaded, &elapsed));
+	EXPECT_TRUE(loaded.Matches(&sim.ctrl));
+}
+
+TEST(Replay, DetectsChangedInput) {
+	CSimulation sim;
+	CReplay replay;
+	RecordRace(sim, "bunny_hill", false, replay);
+
+	replay.frames[RACE_FRAMES / 3].turn = -replay.frames[RACE_FRAMES / 3].turn;
+	float elapsed;
+	ASSERT_TRUE(PlayReplay(sim, replay, &elapsed));
+	EXPECT_FALSE(replay.Matches(&sim.ctrl));
+}
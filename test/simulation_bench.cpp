@@ -0,0 +1,55 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include <benchmark/benchmark.h>
+#include "bh.h"
+#include "simulate.h"
+#include "race_script.h"
+
+// One frame of the race with the scripted input. The race starts over
+// when Tux has passed the finish line. The argument is the integrator,
+// INTEGRATE_ODE23 or INTEGRATE_RK4.
+static void BM_StepRace(benchmark::State& state) {
+	CSimulation sim;
+	if (!sim.Load("default", "bumpy_ride", "tux", false)) {
+		state.SkipWithError("course not loaded");
+		return;
+	}
+	CControl* ctrl = &sim.ctrl;
+	ctrl->integrator = static_cast<TIntegrator>(state.range(0));
+	state.SetLabel(ctrl->integrator == INTEGRATE_RK4 ? "rk4" : "ode23");
+	std::size_t frame = 0;
+	sim.StartRace(1, 42);
+	EnterRace(ctrl, true, true);
+	for (auto _ : state) {
+		StepRace(ctrl, ScriptedInput(frame), ScriptedTimeStep(frame), IsAirborne(ctrl));
+		frame++;
+		if (ctrl->ctx->finish) {
+			state.PauseTiming();
+			sim.StartRace(1, 42);
+			EnterRace(ctrl, true, true);
+			frame = 0;
+			state.ResumeTiming();
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StepRace)->Arg(INTEGRATE_ODE23)->Arg(INTEGRATE_RK4);
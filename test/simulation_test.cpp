@@ -0,0 +1,106 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+// before bh.h, which pulls in X11 macros like None
+#include <gtest/gtest.h>
+#include "bh.h"
+#include "simulate.h"
+#include "race_script.h"
+#include <cstring>
+#include <thread>
+
+#define SIM_FRAMES 1200
+
+// Steps the race on course with the scripted input
+static void RunRace(CSimulation& sim, const std::string& course) {
+	ASSERT_TRUE(sim.Load("default", course, "tux", false));
+	sim.StartRace(1, 42);
+	CControl* ctrl = &sim.ctrl;
+	EnterRace(ctrl, true, true);
+	for (std::size_t i = 0; i < SIM_FRAMES && !ctrl->ctx->finish; i++)
+		StepRace(ctrl, ScriptedInput(i), ScriptedTimeStep(i), IsAirborne(ctrl));
+}
+
+// Slides down course for frames frames with no input and returns where
+// Tux ends up
+static TVector3d SlidePosition(const std::string& course, TIntegrator integrator, int frames) {
+	CSimulation sim;
+	EXPECT_TRUE(sim.Load("default", course, "tux", false));
+	sim.StartRace(0, 0);
+	CControl* ctrl = &sim.ctrl;
+	ctrl->integrator = integrator;
+	EnterRace(ctrl, true, true);
+	TRaceInput input;
+	for (int i = 0; i < frames && !ctrl->ctx->finish; i++)
+		StepRace(ctrl, input, 1.f / 60.f, IsAirborne(ctrl));
+	return ctrl->cpos;
+}
+
+static bool SameBits(const TVector3d& a, const TVector3d& b) {
+	return std::memcmp(&a, &b, sizeof(TVector3d)) == 0;
+}
+
+TEST(Simulation, SlidesDownTheCourse) {
+	CSimulation sim;
+	ASSERT_TRUE(sim.Load("default", "bunny_hill", "tux", false));
+	sim.StartRace(0, 0);
+	CControl* ctrl = &sim.ctrl;
+	const TVector3d start = ctrl->cpos;
+	EXPECT_EQ(ctrl->ctx, &sim.Context());
+
+	EnterRace(ctrl, true, true);
+	TRaceInput input;
+	for (int i = 0; i < 300; i++)
+		StepRace(ctrl, input, 1.f / 60.f, IsAirborne(ctrl));
+
+	EXPECT_NEAR(sim.Context().time, 5.f, 0.01f);
+	EXPECT_LT(ctrl->cpos.z, start.z - 1.0);		// the course runs along -z
+	EXPECT_LT(ctrl->cpos.y, start.y);
+	const TVector2d& dim = sim.RaceCourse().GetDimensions();
+	EXPECT_GE(ctrl->cpos.x, 0.0);
+	EXPECT_LE(ctrl->cpos.x, dim.x);
+}
+
+TEST(Simulation, ThreadsDoNotInterfere) {
+	// the same race on two threads at once and then alone must end at
+	// the same point
+	CSimulation a, b, alone;
+	std::thread ta(RunRace, std::ref(a), "bumpy_ride");
+	std::thread tb(RunRace, std::ref(b), "bumpy_ride");
+	ta.join();
+	tb.join();
+	RunRace(alone, "bumpy_ride");
+
+	EXPECT_TRUE(SameBits(a.ctrl.cpos, alone.ctrl.cpos));
+	EXPECT_TRUE(SameBits(b.ctrl.cpos, alone.ctrl.cpos));
+	EXPECT_EQ(a.Context().time, alone.Context().time);
+	EXPECT_EQ(a.Context().herring, alone.Context().herring);
+}
+
+TEST(Simulation, IntegratorsAgree) {
+	// RK4 with a fixed step and the adaptive Bogacki-Shampine method must
+	// follow the same trajectory, up to the error ODE23 allows per step,
+	// on the same input
+	const TVector3d ode23 = SlidePosition("bunny_hill", INTEGRATE_ODE23, 600);
+	const TVector3d rk4 = SlidePosition("bunny_hill", INTEGRATE_RK4, 600);
+	// after 10 s and some 70 m they are about 8 cm apart
+	EXPECT_LT((ode23 - rk4).Length(), 0.25);
+}
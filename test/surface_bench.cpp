@@ -0,0 +1,96 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "bench_course.h"
+#include "course.h"
+
+#define NUM_POINTS 4096
+
+// What physics needs of the surface at one point, in one triangle lookup
+static void BM_SampleSurface(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, bench_courses[state.range(0)]);
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	std::vector<TVector2d> points = BenchPoints(course, NUM_POINTS);
+	std::size_t p = 0;
+	for (auto _ : state) {
+		const TVector2d& pos = points[p++ % NUM_POINTS];
+		TSurfaceSample sample = course.SampleSurface(pos.x, pos.y);
+		benchmark::DoNotOptimize(sample);
+		benchmark::DoNotOptimize(sample.TerrainIdx(0.5));
+	}
+}
+BENCHMARK(BM_SampleSurface)->DenseRange(0, NUM_BENCH_COURSES - 1);
+
+// The same with the separate queries, each locating the triangle again
+static void BM_SurfaceQueries(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, bench_courses[state.range(0)]);
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	std::vector<TVector2d> points = BenchPoints(course, NUM_POINTS);
+	std::size_t p = 0;
+	for (auto _ : state) {
+		const TVector2d& pos = points[p++ % NUM_POINTS];
+		benchmark::DoNotOptimize(course.FindYCoord(pos.x, pos.y));
+		benchmark::DoNotOptimize(course.FindCourseNormal(pos.x, pos.y));
+		benchmark::DoNotOptimize(course.GetTerrainIdx(pos.x, pos.y, 0.5));
+	}
+}
+BENCHMARK(BM_SurfaceQueries)->DenseRange(0, NUM_BENCH_COURSES - 1);
+
+// The course height below the points, one FindYCoord call each
+static void BM_FindYCoord(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, bench_courses[state.range(0)]);
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	std::vector<TVector2d> points = BenchPoints(course, NUM_POINTS);
+	std::vector<float> xs(NUM_POINTS), zs(NUM_POINTS), ys(NUM_POINTS);
+	for (std::size_t i = 0; i < NUM_POINTS; i++) {
+		xs[i] = (float)points[i].x;
+		zs[i] = (float)points[i].y;
+	}
+	for (auto _ : state) {
+		for (std::size_t i = 0; i < NUM_POINTS; i++)
+			ys[i] = (float)course.FindYCoord(xs[i], zs[i]);
+		benchmark::DoNotOptimize(ys.data());
+	}
+	state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+BENCHMARK(BM_FindYCoord)->DenseRange(0, NUM_BENCH_COURSES - 1);
+
+// The same with one FindYCoordBatch call
+static void BM_FindYCoordBatch(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, bench_courses[state.range(0)]);
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	std::vector<TVector2d> points = BenchPoints(course, NUM_POINTS);
+	std::vector<float> xs(NUM_POINTS), zs(NUM_POINTS), ys(NUM_POINTS);
+	for (std::size_t i = 0; i < NUM_POINTS; i++) {
+		xs[i] = (float)points[i].x;
+		zs[i] = (float)points[i].y;
+	}
+	for (auto _ : state) {
+		course.FindYCoordBatch(xs.data(), zs.data(), ys.data(), NUM_POINTS);
+		benchmark::DoNotOptimize(ys.data());
+	}
+	state.SetItemsProcessed(state.iterations() * NUM_POINTS);
+}
+BENCHMARK(BM_FindYCoordBatch)->DenseRange(0, NUM_BENCH_COURSES - 1);
@@ -0,0 +1,47 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#ifndef TEST_CAMERA_H
+#define TEST_CAMERA_H
+
+#include "bh.h"
+#include "physics.h"
+
+// Puts the camera of ctrl at pos, looking into dir, and sets up its view
+// matrix like setup_view_matrix does, but without OpenGL
+inline void SetTestCamera(CControl* ctrl, const TVector3d& pos, const TVector3d& dir) {
+	ctrl->viewpos = pos;
+	ctrl->viewdir = dir;
+	ctrl->viewup = TVector3d(0.0, 1.0, 0.0);
+
+	TVector3d view_z = -ctrl->viewdir;
+	TVector3d view_x = CrossProduct(ctrl->viewup, view_z);
+	TVector3d view_y = CrossProduct(view_z, view_x);
+	view_z.Norm();
+	view_x.Norm();
+	view_y.Norm();
+	ctrl->view_mat = TMatrix<4, 4>(view_x, view_y, view_z);
+	ctrl->view_mat[3][0] = pos.x;
+	ctrl->view_mat[3][1] = pos.y;
+	ctrl->view_mat[3][2] = pos.z;
+}
+
+#endif
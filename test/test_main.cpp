@@ -0,0 +1,34 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+// before bh.h, which pulls in X11 macros like None
+#include <gtest/gtest.h>
+#include "bh.h"
+#include "simulate.h"
+
+// The tests race on the courses of the data directory, see CMakeLists.txt
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	InitConfig();
+	if (!LoadSimulationResources())
+		return 1;
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,78 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 1999-2001 Jasmin F. Patry (Tuxracer)
+Copyright (C) 2010 Extreme Tux Racer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "bench_course.h"
+#include "course.h"
+#include "course_render.h"
+#include "physics.h"
+#include "test_camera.h"
+#include "view.h"
+#include "winsys.h"
+#include "game_config.h"
+
+#define FLIGHT_FRAMES 600
+
+// Puts the camera of ctrl at frame of a flight down the middle of the
+// course
+static void FlightCamera(const CCourse& course, CControl* ctrl, int frame) {
+	const TVector2d& dim = course.GetDimensions();
+	const TVector2d& play = course.GetPlayDimensions();
+	double x = dim.x / 2.0 + play.x / 4.0 * std::sin(frame * 0.02);
+	double z = -play.y * frame / FLIGHT_FRAMES;
+	TVector3d pos(x, course.FindYCoord(x, z) + 4.0, z);
+	SetTestCamera(ctrl, pos, TVector3d(0.0, -0.3, -1.0));
+}
+
+// The tree selection of DrawTrees on a flight over the densest stock
+// course: the chunks of the static tree geometry and the single trees of
+// clipped chunks which are drawn, and the billboards of the far trees. The
+// counters are the draw calls for the detailed trees and the number of
+// detailed and billboard trees per frame. The argument is the
+// tree_detail_distance.
+static void BM_TreeFlight(benchmark::State& state) {
+	CSimulation* sim = BenchSimulation(state, "keep_country_tidy");
+	if (sim == nullptr) return;
+	const CCourse& course = sim->RaceCourse();
+	CControl* ctrl = &sim->ctrl;
+	Winsys.resolution = TScreenRes(1280, 720);
+	int detail_distance = param.tree_detail_distance;
+	param.tree_detail_distance = (int)state.range(0);
+
+	std::vector<TTreeDrawList> lists;
+	std::size_t frame = 0;
+	double ranges = 0, detailed = 0, billboards = 0;
+	for (auto _ : state) {
+		FlightCamera(course, ctrl, frame++ % FLIGHT_FRAMES);
+		SetupViewFrustum(ctrl);
+		SelectTrees(course, ctrl, lists);
+		for (std::size_t t = 0; t < lists.size(); t++) {
+			ranges += lists[t].ranges.size();
+			for (std::size_t r = 0; r < lists[t].ranges.size(); r++)
+				detailed += lists[t].ranges[r].count / 8;
+			billboards += lists[t].billboards.size() / 20;
+		}
+	}
+	param.tree_detail_distance = detail_distance;
+	state.counters["calls"] = benchmark::Counter(ranges, benchmark::Counter::kAvgIterations);
+	state.counters["detailed"] = benchmark::Counter(detailed, benchmark::Counter::kAvgIterations);
+	state.counters["billboards"] = benchmark::Counter(billboards, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_TreeFlight)->Arg(0)->Arg(20)->Arg(1000);